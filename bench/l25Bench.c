@@ -0,0 +1,399 @@
+/*
+ * l25Bench.c
+ * 基准测试：对每个工作负载重复编译、执行，统计中位数和 p95，结果写成 JSON 并与基线比较
+ *
+ * 使用方法：
+ * l25bench [-n 次数] [-o 结果.json] [-b 基线.json] [-t 百分比] [-m 毫秒] 目录|文件.l25 ...
+ * 目录中的每个 <名字>.l25 是一个工作负载，<名字>.in 中是它的输入（空白分隔的整数）
+ * 每个工作负载另外用剖析模式执行一次，得到执行的指令数、栈顶最大值和最大调用深度（不计入耗时）
+ * 给出基线时，编译或执行耗时的中位数比基线慢超过阈值（默认 10%）、而且慢了至少 -m 毫秒（默认 0.05，
+ * 低于它的差别是计时的噪声，十几微秒的编译耗时差 10% 只有一两微秒）的工作负载报告为退化，返回 1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "l25.h"
+
+/* 一个工作负载的测量结果 */
+struct workload
+{
+	char name[256];
+	char *src;				/* 源程序 */
+	size_t srclen;
+	int *in;				/* 输入 */
+	int nin;
+	int cx;					/* 指令条数 */
+	int status;				/* 最后一次执行的 enum vmstatus */
+	long long instructions; /* 执行的指令数 */
+	int peakstack;			/* 栈顶指针的最大值 */
+	int maxdepth;			/* 最大调用深度 */
+	double compmed, compp95; /* 编译耗时（毫秒） */
+	double execmed, execp95; /* 执行耗时（毫秒） */
+};
+
+static double now_msec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int cmpdouble(const void *x, const void *y)
+{
+	double a = *(const double *)x, b = *(const double *)y;
+	return (a > b) - (a < b);
+}
+
+static int cmpstr(const void *x, const void *y)
+{
+	return strcmp(*(char *const *)x, *(char *const *)y);
+}
+
+/* 最近秩法求百分位数，v 已升序排列 */
+static double percentile(const double *v, int n, double pct)
+{
+	int r = (int)(pct / 100.0 * n + 0.999999);
+	if (r < 1)
+		r = 1;
+	if (r > n)
+		r = n;
+	return v[r - 1];
+}
+
+static char *readfile(const char *path, size_t *plen)
+{
+	FILE *f = fopen(path, "rb");
+	char *buf;
+	long len;
+
+	if (f == NULL)
+		return NULL;
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	rewind(f);
+	buf = malloc(len + 1);
+	if (fread(buf, 1, len, f) != (size_t)len)
+		len = 0;
+	buf[len] = 0;
+	fclose(f);
+	*plen = len;
+	return buf;
+}
+
+/* 读入 <名字>.in 中的全部整数，文件不存在时没有输入 */
+static int readin(const char *path, int **pv)
+{
+	size_t len;
+	char *text = readfile(path, &len), *q, *end;
+	int n = 0, cap = 0, *v = NULL;
+
+	*pv = NULL;
+	if (text == NULL)
+		return 0;
+	for (q = text;; q = end)
+	{
+		long x = strtol(q, &end, 10);
+		if (end == q)
+			break;
+		if (n == cap)
+		{
+			cap = cap ? cap * 2 : 8;
+			v = realloc(v, sizeof(int) * cap);
+		}
+		v[n++] = (int)x;
+	}
+	free(text);
+	*pv = v;
+	return n;
+}
+
+static void addworkload(struct workload **ws, int *nw, const char *path)
+{
+	struct workload *w;
+	char inpath[4096];
+	const char *base = strrchr(path, '/');
+	size_t len = strlen(path);
+
+	if (len <= 4 || strcmp(path + len - 4, ".l25") != 0)
+	{
+		fprintf(stderr, "%s is not a .l25 file!\n", path);
+		return;
+	}
+	*ws = realloc(*ws, sizeof(struct workload) * (*nw + 1));
+	w = &(*ws)[*nw];
+	memset(w, 0, sizeof(*w));
+	snprintf(w->name, sizeof(w->name), "%s", base ? base + 1 : path);
+	w->name[strlen(w->name) - 4] = 0; /* 去掉 .l25 */
+	if ((w->src = readfile(path, &w->srclen)) == NULL)
+	{
+		fprintf(stderr, "Can't open %s!\n", path);
+		return;
+	}
+	snprintf(inpath, sizeof(inpath), "%.*s.in", (int)(len - 4), path);
+	w->nin = readin(inpath, &w->in);
+	(*nw)++;
+}
+
+static void adddir(struct workload **ws, int *nw, const char *dir)
+{
+	DIR *d = opendir(dir);
+	struct dirent *e;
+	char **names = NULL;
+	int n = 0, i;
+
+	if (d == NULL)
+	{
+		fprintf(stderr, "Can't open directory %s!\n", dir);
+		return;
+	}
+	while ((e = readdir(d)) != NULL)
+	{
+		size_t len = strlen(e->d_name);
+		if (len > 4 && strcmp(e->d_name + len - 4, ".l25") == 0)
+		{
+			names = realloc(names, sizeof(char *) * (n + 1));
+			names[n++] = strdup(e->d_name);
+		}
+	}
+	closedir(d);
+	qsort(names, n, sizeof(char *), cmpstr);
+	for (i = 0; i < n; i++)
+	{
+		char path[4096];
+		snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+		addworkload(ws, nw, path);
+		free(names[i]);
+	}
+	free(names);
+}
+
+static int compilesrc(const struct workload *w, struct compiler *ctx)
+{
+	memset(ctx, 0, offsetof(struct compiler, code)); /* 大数组不必清零 */
+	ctx->src = w->src;
+	ctx->srclen = w->srclen;
+	return compile(ctx);
+}
+
+/*
+ * 测量一个工作负载：runs 个编译样本、runs 次执行，再剖析执行一次
+ */
+static int measure(struct workload *w, int runs, struct compiler *ctx, struct vm *vm)
+{
+	double *comp = malloc(sizeof(double) * runs), *exec = malloc(sizeof(double) * runs);
+	struct profile *prof;
+	int i, j, reps = 1;
+	double start;
+
+	/* 一次编译只要几微秒，每个样本连续编译 reps 次（约 1 毫秒）取平均，减小计时误差 */
+	start = now_msec();
+	if (compilesrc(w, ctx) != 0)
+	{
+		fprintf(stderr, "%s: compile error\n", w->name);
+		free(comp);
+		free(exec);
+		return -1;
+	}
+	w->cx = ctx->cx;
+	if (now_msec() - start < 1.0)
+		reps = (int)(1.0 / (now_msec() - start + 1e-6)) + 1;
+	for (i = 0; i < runs; i++)
+	{
+		start = now_msec();
+		for (j = 0; j < reps; j++)
+			compilesrc(w, ctx);
+		comp[i] = (now_msec() - start) / reps;
+	}
+
+	for (i = 0; i < runs; i++)
+	{
+		vminit(vm, ctx->code);
+		vm->in = w->in ? w->in : (int[]){0};
+		vm->nin = w->nin;
+		start = now_msec();
+		w->status = interpret(vm);
+		exec[i] = now_msec() - start;
+	}
+
+	prof = prof_create(ctx->cx);
+	vminit(vm, ctx->code);
+	vm->in = w->in ? w->in : (int[]){0};
+	vm->nin = w->nin;
+	vm->prof = prof;
+	interpret(vm);
+	w->instructions = 0;
+	for (i = 0; i < ctx->cx; i++)
+		w->instructions += prof->count[i];
+	w->peakstack = prof->maxt;
+	w->maxdepth = prof->maxdepth;
+	prof_destroy(prof);
+
+	qsort(comp, runs, sizeof(double), cmpdouble);
+	qsort(exec, runs, sizeof(double), cmpdouble);
+	w->compmed = percentile(comp, runs, 50);
+	w->compp95 = percentile(comp, runs, 95);
+	w->execmed = percentile(exec, runs, 50);
+	w->execp95 = percentile(exec, runs, 95);
+	free(comp);
+	free(exec);
+	return 0;
+}
+
+static void writejson(FILE *f, const struct workload *ws, int nw, int runs)
+{
+	int i;
+
+	fprintf(f, "{\n  \"runs\": %d,\n  \"workloads\": [\n", runs);
+	for (i = 0; i < nw; i++)
+	{
+		const struct workload *w = &ws[i];
+		fprintf(f, "    {\"name\": \"%s\", \"status\": \"%s\", \"code_size\": %d, "
+				   "\"instructions\": %lld, \"peak_stack\": %d, \"max_call_depth\": %d,\n",
+				w->name, vmstatusname(w->status), w->cx, w->instructions, w->peakstack, w->maxdepth);
+		fprintf(f, "     \"compile_ms\": {\"median\": %.6f, \"p95\": %.6f}, "
+				   "\"exec_ms\": {\"median\": %.6f, \"p95\": %.6f}}%s\n",
+				w->compmed, w->compp95, w->execmed, w->execp95, i + 1 < nw ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+}
+
+/*
+ * 从基线 JSON 中取工作负载 name 的 section（compile_ms/exec_ms）的中位数，找不到时返回 -1
+ * 只认本程序写出的格式
+ */
+static double baseline(const char *json, const char *name, const char *section)
+{
+	char key[300];
+	const char *q, *next;
+
+	snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+	if ((q = strstr(json, key)) == NULL)
+		return -1;
+	next = strstr(q + 1, "\"name\":");
+	snprintf(key, sizeof(key), "\"%s\": {\"median\": ", section);
+	if ((q = strstr(q, key)) == NULL || (next && q > next))
+		return -1;
+	return strtod(q + strlen(key), NULL);
+}
+
+/* 与基线比较，返回退化的项数；慢了不到 mindelta 毫秒的不算退化 */
+static int compare(const struct workload *ws, int nw, const char *json, double threshold, double mindelta)
+{
+	int i, nreg = 0;
+
+	printf("\n%-12s %-10s %12s %12s %9s\n", "workload", "phase", "baseline ms", "current ms", "change");
+	for (i = 0; i < nw; i++)
+	{
+		static const char *sections[2] = {"compile_ms", "exec_ms"};
+		double cur[2] = {ws[i].compmed, ws[i].execmed};
+		int k;
+
+		for (k = 0; k < 2; k++)
+		{
+			double base = baseline(json, ws[i].name, sections[k]);
+			double change;
+			bool reg;
+
+			if (base <= 0)
+				continue;
+			change = (cur[k] - base) / base * 100;
+			reg = change > threshold && cur[k] - base >= mindelta;
+			nreg += reg;
+			printf("%-12s %-10s %12.4f %12.4f %+8.1f%%%s\n", ws[i].name, sections[k], base, cur[k], change,
+				   reg ? "  REGRESSION" : "");
+		}
+	}
+	return nreg;
+}
+
+int main(int argc, char **argv)
+{
+	struct workload *ws = NULL;
+	int nw = 0, runs = 20, i, nreg = 0;
+	const char *outpath = NULL, *basepath = NULL;
+	double threshold = 10;
+	double mindelta = 0.05; /* 毫秒 */
+	struct compiler *ctx = malloc(sizeof(struct compiler));
+	struct vm *vm = malloc(sizeof(struct vm));
+
+	for (i = 1; i < argc; i++)
+	{
+		struct stat st;
+
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			runs = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			outpath = argv[++i];
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+			basepath = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			threshold = atof(argv[++i]);
+		else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+			mindelta = atof(argv[++i]);
+		else if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode))
+			adddir(&ws, &nw, argv[i]);
+		else
+			addworkload(&ws, &nw, argv[i]);
+	}
+	if (nw == 0 || runs < 1)
+	{
+		printf("usage: l25bench [-n runs] [-o results.json] [-b baseline.json] [-t percent] [-m ms] dir|file.l25 ...\n");
+		return 1;
+	}
+
+	printf("%-12s %6s %12s %6s %6s %10s %10s %10s %10s\n", "workload", "code", "instructions", "stack",
+		   "depth", "comp p50", "comp p95", "exec p50", "exec p95");
+	for (i = 0; i < nw; i++)
+	{
+		struct workload *w = &ws[i];
+
+		if (measure(w, runs, ctx, vm) != 0)
+			return 1;
+		printf("%-12s %6d %12lld %6d %6d %10.4f %10.4f %10.4f %10.4f%s%s\n", w->name, w->cx, w->instructions,
+			   w->peakstack, w->maxdepth, w->compmed, w->compp95, w->execmed, w->execp95,
+			   w->status != vm_ok ? "  " : "", w->status != vm_ok ? vmstatusname(w->status) : "");
+	}
+
+	if (outpath)
+	{
+		FILE *f = fopen(outpath, "w");
+		if (f == NULL)
+		{
+			fprintf(stderr, "Can't open %s!\n", outpath);
+			return 1;
+		}
+		writejson(f, ws, nw, runs);
+		fclose(f);
+		printf("\nresults written to %s\n", outpath);
+	}
+	if (basepath)
+	{
+		size_t len;
+		char *json = readfile(basepath, &len);
+
+		if (json == NULL)
+			printf("\nno baseline at %s, nothing to compare\n", basepath);
+		else
+		{
+			nreg = compare(ws, nw, json, threshold, mindelta);
+			printf("%d regressions (threshold %.1f%%, at least %.3f ms)\n", nreg, threshold, mindelta);
+			free(json);
+		}
+	}
+
+	for (i = 0; i < nw; i++)
+	{
+		free(ws[i].src);
+		free(ws[i].in);
+	}
+	free(ws);
+	free(ctx);
+	free(vm);
+	return nreg == 0 ? 0 : 1;
+}
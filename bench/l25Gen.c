@@ -0,0 +1,669 @@
+/*
+ * l25Gen.c
+ * 合成 L25 程序生成器，以及编译时间、内存随程序规模增长的报告
+ *
+ * 使用方法：
+ * l25gen [-f 函数数] [-s 语句数] [-e 表达式深度] [-n 嵌套深度] [-r 递归深度] [-i 标识符数] [-z 种子] [-o 输出.l25]
+ * l25gen -S f|s|e|n|i [-k 步数] [-c 结果.csv] [其他参数同上]
+ * 第一种形式把生成的程序写到文件或标准输出。
+ * 第二种形式从给定参数出发，每一步把 -S 指定的参数加倍，生成程序并在内存中编译，
+ * 报告词法分析（getsym）、语法分析（statement/expression 等，除去其他三部分）、position() 和 gen()
+ * 各自的耗时和每个符号的平均耗时，以及源程序、符号表、代码占用的内存。
+ * 每符号耗时随规模增长说明该部分是超线性的，报告最后给出各部分耗时对符号数的增长指数。
+ * 程序超出编译器的容量时报告在哪一步、因何失败。
+ *
+ * 生成的程序：
+ * 每个函数 f<k>(n, x) 有 -i 个局部变量，-s 条顶层语句（赋值、调用、if/else、while、try/catch），
+ * 复合语句向内嵌套到 -n 层，表达式的括号嵌套到 -e 层；
+ * 函数只在 n > 0 时以 n - 1 调用自己和前面的函数，主程序以 -r 给出的 n 调用最后一个函数，
+ * 循环都有上界，所以程序总会结束（运行时间随递归深度指数增长）。
+ * 每行不超过 72 个字符，标识符不超过 al 个字符。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "l25.h"
+
+#define GENWIDTH 72 /* 生成的每行最多字符数 */
+
+/* 生成参数 */
+struct genparams
+{
+	int funcs;	/* 函数个数（不含 main） */
+	int stmts;	/* 每个函数的顶层语句数 */
+	int depth;	/* 表达式的括号嵌套深度 */
+	int nest;	/* if/while/try 的嵌套深度 */
+	int recur;	/* 递归深度 */
+	int idents; /* 每个函数的局部变量数 */
+	unsigned seed;
+};
+
+/* 生成结果：自动增长的字符串 */
+struct genbuf
+{
+	char *s;
+	size_t len, cap;
+	int col;	/* 当前行已有的字符数 */
+	int indent; /* 当前缩进的层数 */
+	unsigned rng;
+	int loops;	/* 当前函数中已用的循环变量数 */
+	const struct genparams *gp;
+};
+
+static double now_msec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* xorshift32，同一种子总是生成同一个程序 */
+static int rnd(struct genbuf *gb, int n)
+{
+	gb->rng ^= gb->rng << 13;
+	gb->rng ^= gb->rng >> 17;
+	gb->rng ^= gb->rng << 5;
+	return (int)(gb->rng % (unsigned)n);
+}
+
+static void putraw(struct genbuf *gb, const char *t, size_t n)
+{
+	if (gb->len + n + 1 > gb->cap)
+	{
+		gb->cap = gb->cap ? gb->cap * 2 : 4096;
+		while (gb->cap < gb->len + n + 1)
+			gb->cap *= 2;
+		gb->s = realloc(gb->s, gb->cap);
+	}
+	memcpy(gb->s + gb->len, t, n);
+	gb->len += n;
+	gb->s[gb->len] = 0;
+}
+
+/* 另起一行并缩进 */
+static void newline(struct genbuf *gb)
+{
+	int i;
+
+	putraw(gb, "\n", 1);
+	gb->col = 0;
+	for (i = 0; i < gb->indent && i < 16; i++)
+	{
+		putraw(gb, "    ", 4);
+		gb->col += 4;
+	}
+}
+
+/* 输出一个符号，除左括号后和 ; , ) 前以外都用空格隔开；本行放不下时折到下一行 */
+static void tok(struct genbuf *gb, const char *t)
+{
+	size_t n = strlen(t);
+
+	if (gb->col > 0 && gb->col + 1 + (int)n > GENWIDTH)
+	{
+		gb->indent++;
+		newline(gb);
+		gb->indent--;
+	}
+	if (gb->col > 0 && gb->s[gb->len - 1] != ' ' && gb->s[gb->len - 1] != '(' && strchr(";,)", t[0]) == NULL)
+	{
+		putraw(gb, " ", 1);
+		gb->col++;
+	}
+	putraw(gb, t, n);
+	gb->col += (int)n;
+}
+
+static void tokf(struct genbuf *gb, const char *fmt, int v)
+{
+	char t[32];
+	snprintf(t, sizeof(t), fmt, v);
+	tok(gb, t);
+}
+
+/* 叶子：局部变量、形参或小常数 */
+static void genleaf(struct genbuf *gb)
+{
+	int r = rnd(gb, gb->gp->idents + 3);
+
+	if (r < gb->gp->idents)
+		tokf(gb, "v%d", r);
+	else if (r == gb->gp->idents)
+		tok(gb, "x");
+	else if (r == gb->gp->idents + 1)
+		tok(gb, "n");
+	else
+		tokf(gb, "%d", 1 + rnd(gb, 9));
+}
+
+/* 括号嵌套 d 层的表达式，每层一个运算符，长度与 d 成正比 */
+static void genexpr(struct genbuf *gb, int d)
+{
+	static const char *ops[] = {"+", "-", "*", "+", "-"};
+
+	if (d <= 0)
+	{
+		genleaf(gb);
+		return;
+	}
+	if (rnd(gb, 2))
+	{
+		tok(gb, "(");
+		genexpr(gb, d - 1);
+		tok(gb, ")");
+		tok(gb, ops[rnd(gb, 5)]);
+		genleaf(gb);
+	}
+	else
+	{
+		genleaf(gb);
+		tok(gb, ops[rnd(gb, 5)]);
+		tok(gb, "(");
+		genexpr(gb, d - 1);
+		tok(gb, ")");
+	}
+}
+
+static void gencond(struct genbuf *gb)
+{
+	static const char *rel[] = {"==", "!=", "<", "<=", ">", ">="};
+
+	genexpr(gb, 1);
+	tok(gb, rel[rnd(gb, 6)]);
+	genexpr(gb, 1);
+}
+
+static void genassign(struct genbuf *gb)
+{
+	tokf(gb, "v%d", rnd(gb, gb->gp->idents));
+	tok(gb, "=");
+	genexpr(gb, gb->gp->depth);
+	tok(gb, ";");
+}
+
+/* 调用自己或前面的函数，n 每次减一 */
+static void gencall(struct genbuf *gb, int self)
+{
+	tok(gb, "if");
+	tok(gb, "(");
+	tok(gb, "n");
+	tok(gb, ">");
+	tok(gb, "0");
+	tok(gb, ")");
+	tok(gb, "{");
+	gb->indent++;
+	newline(gb);
+	tokf(gb, "v%d", rnd(gb, gb->gp->idents));
+	tok(gb, "=");
+	tokf(gb, "f%d(", rnd(gb, self + 1));
+	tok(gb, "n");
+	tok(gb, "-");
+	tok(gb, "1");
+	tok(gb, ",");
+	genexpr(gb, 1);
+	tok(gb, ")");
+	tok(gb, ";");
+	gb->indent--;
+	newline(gb);
+	tok(gb, "}");
+	tok(gb, ";");
+}
+
+static void genstmt(struct genbuf *gb, int self, int level);
+
+/* 复合语句的语句体：一条赋值，再加一条向内嵌套一层的语句 */
+static void genbody(struct genbuf *gb, int self, int level)
+{
+	tok(gb, "{");
+	gb->indent++;
+	newline(gb);
+	genassign(gb);
+	newline(gb);
+	genstmt(gb, self, level + 1);
+	gb->indent--;
+	newline(gb);
+	tok(gb, "}");
+}
+
+/* level 层的一条语句，level 达到嵌套深度后只生成赋值和调用 */
+static void genstmt(struct genbuf *gb, int self, int level)
+{
+	int kind = rnd(gb, 10);
+
+	if (level >= gb->gp->nest && kind >= 5)
+		kind = 0;
+	if (kind <= 3)
+	{
+		genassign(gb);
+	}
+	else if (kind == 4)
+	{
+		gencall(gb, self);
+	}
+	else if (kind <= 6)
+	{
+		tok(gb, "if");
+		tok(gb, "(");
+		gencond(gb);
+		tok(gb, ")");
+		genbody(gb, self, level);
+		tok(gb, "else");
+		genbody(gb, self, level);
+		tok(gb, ";");
+	}
+	else if (kind <= 8)
+	{
+		int w = gb->loops++;
+
+		tokf(gb, "let w%d", w);
+		tok(gb, "=");
+		tok(gb, "0");
+		tok(gb, ";");
+		newline(gb);
+		tok(gb, "while");
+		tok(gb, "(");
+		tokf(gb, "w%d", w);
+		tok(gb, "<");
+		tok(gb, "2");
+		tok(gb, ")");
+		tok(gb, "{");
+		gb->indent++;
+		newline(gb);
+		tokf(gb, "w%d", w);
+		tok(gb, "=");
+		tokf(gb, "w%d", w);
+		tok(gb, "+");
+		tok(gb, "1");
+		tok(gb, ";");
+		newline(gb);
+		genassign(gb);
+		newline(gb);
+		genstmt(gb, self, level + 1);
+		gb->indent--;
+		newline(gb);
+		tok(gb, "}");
+		tok(gb, ";");
+	}
+	else
+	{
+		tok(gb, "try");
+		genbody(gb, self, level);
+		tok(gb, "catch");
+		genbody(gb, self, level);
+	}
+}
+
+static void genfunc(struct genbuf *gb, int k)
+{
+	int i;
+
+	tokf(gb, "func f%d(n, x)", k);
+	tok(gb, "{");
+	gb->indent++;
+	gb->loops = 0;
+	for (i = 0; i < gb->gp->idents; i++)
+	{
+		newline(gb);
+		tokf(gb, "let v%d", i);
+		tok(gb, "=");
+		tok(gb, "x");
+		tok(gb, "+");
+		tokf(gb, "%d", i);
+		tok(gb, ";");
+	}
+	for (i = 0; i < gb->gp->stmts; i++)
+	{
+		newline(gb);
+		genstmt(gb, k, 0);
+	}
+	newline(gb);
+	tok(gb, "return");
+	tok(gb, "v0");
+	tok(gb, ";");
+	gb->indent--;
+	newline(gb);
+	tok(gb, "}");
+}
+
+/*
+ * 按参数生成一个完整的程序，返回以 0 结尾的字符串，长度存入 *plen
+ */
+static char *generate(const struct genparams *gp, size_t *plen)
+{
+	struct genbuf gb;
+	int k;
+
+	memset(&gb, 0, sizeof(gb));
+	gb.gp = gp;
+	gb.rng = gp->seed ? gp->seed : 1;
+	tok(&gb, "program Gen {");
+	gb.indent++;
+	for (k = 0; k < gp->funcs; k++)
+	{
+		newline(&gb);
+		genfunc(&gb, k);
+	}
+	newline(&gb);
+	tok(&gb, "main {");
+	gb.indent++;
+	newline(&gb);
+	tok(&gb, "let r = 0;");
+	if (gp->funcs > 0)
+	{
+		newline(&gb);
+		tok(&gb, "r =");
+		tokf(&gb, "f%d(", gp->funcs - 1);
+		tokf(&gb, "%d,", gp->recur);
+		tok(&gb, "1);");
+	}
+	newline(&gb);
+	tok(&gb, "output(r);");
+	gb.indent--;
+	newline(&gb);
+	tok(&gb, "}");
+	gb.indent--;
+	newline(&gb);
+	tok(&gb, "}");
+	putraw(&gb, "\n", 1);
+	*plen = gb.len;
+	return gb.s;
+}
+
+/* 一个规模的测量结果 */
+struct scalepoint
+{
+	size_t bytes;
+	int lines;
+	struct compstats st;
+	int cx, tx;
+	double msec;				  /* 不统计时编译一次的最短耗时 */
+	double lexms, parsems, lookupms, genms; /* 按统计中的时钟比例分摊 msec */
+	long maxrss;				  /* 进程内存的高水位（KB） */
+};
+
+/*
+ * 编译 src 若干次（至少 3 次、合计至少约 50 毫秒），取最短耗时；再打开统计编译一次分摊到各部分
+ */
+static int measure(struct compiler *ctx, const char *src, size_t len, struct scalepoint *pt)
+{
+	double best = -1, spent = 0;
+	unsigned long long start, total;
+	struct rusage ru;
+	int i, err;
+
+	for (i = 0; i < 3 || spent < 50; i++)
+	{
+		double t0 = now_msec(), dt;
+
+		memset(ctx, 0, offsetof(struct compiler, code)); /* 大数组不必清零 */
+		ctx->src = src;
+		ctx->srclen = len;
+		if ((err = compile(ctx)) != 0)
+			return err;
+		dt = now_msec() - t0;
+		spent += dt;
+		if (best < 0 || dt < best)
+			best = dt;
+	}
+
+	memset(ctx, 0, offsetof(struct compiler, code));
+	memset(&pt->st, 0, sizeof(pt->st));
+	ctx->src = src;
+	ctx->srclen = len;
+	ctx->stats = &pt->st;
+	start = profclock();
+	compile(ctx);
+	total = profclock() - start;
+	if (total == 0)
+		total = 1;
+
+	pt->msec = best;
+	pt->lexms = best * pt->st.lexclock / total;
+	pt->lookupms = best * pt->st.lookupclock / total;
+	pt->genms = best * pt->st.genclock / total;
+	pt->parsems = best - pt->lexms - pt->lookupms - pt->genms;
+	if (pt->parsems < 0)
+		pt->parsems = 0;
+	pt->cx = ctx->cx;
+	pt->tx = ctx->tx;
+	pt->bytes = len;
+	pt->lines = ctx->lineno;
+	getrusage(RUSAGE_SELF, &ru);
+	pt->maxrss = ru.ru_maxrss;
+	return 0;
+}
+
+/* 最小二乘拟合 log(y) = a + k log(x) 的斜率 k */
+static double slope(const double *x, const double *y, int n)
+{
+	double sx = 0, sy = 0, sxx = 0, sxy = 0;
+	int i, m = 0;
+
+	for (i = 0; i < n; i++)
+	{
+		if (x[i] <= 0 || y[i] <= 0)
+			continue;
+		sx += log(x[i]);
+		sy += log(y[i]);
+		sxx += log(x[i]) * log(x[i]);
+		sxy += log(x[i]) * log(y[i]);
+		m++;
+	}
+	if (m < 2 || m * sxx - sx * sx == 0)
+		return 0;
+	return (m * sxy - sx * sy) / (m * sxx - sx * sx);
+}
+
+static int *dimof(struct genparams *gp, char dim)
+{
+	switch (dim)
+	{
+	case 'f':
+		return &gp->funcs;
+	case 's':
+		return &gp->stmts;
+	case 'e':
+		return &gp->depth;
+	case 'n':
+		return &gp->nest;
+	case 'i':
+		return &gp->idents;
+	}
+	return NULL;
+}
+
+/*
+ * 规模报告：每一步把 dim 指定的参数加倍
+ */
+static int scaling(struct genparams gp, char dim, int steps, const char *csvpath)
+{
+	static const char *phases[] = {"lexer", "parser", "position", "gen", "total"};
+	struct compiler *ctx = malloc(sizeof(struct compiler));
+	struct scalepoint *pts = calloc(steps, sizeof(struct scalepoint));
+	int *param = dimof(&gp, dim), n = 0, i, k;
+	FILE *csv = NULL;
+
+	if (csvpath && (csv = fopen(csvpath, "w")) == NULL)
+	{
+		fprintf(stderr, "Can't open %s!\n", csvpath);
+		free(ctx);
+		free(pts);
+		return 1;
+	}
+	if (*param < 1)
+		*param = 1;
+	if (csv)
+		fprintf(csv, "%c,bytes,lines,tokens,symbols,instructions,lookups,probes,statements,expressions,"
+					 "total_ms,lexer_ms,parser_ms,position_ms,gen_ms,src_bytes,table_bytes,code_bytes,maxrss_kb\n",
+				dim);
+	printf("%6s %9s %8s %6s %6s %9s %8s | %8s %8s %8s %8s | %8s %8s %8s %8s | %8s %8s %8s\n", (char[]){'-', dim, 0},
+		   "bytes", "tokens", "syms", "code", "probes", "ms", "lex", "parse", "pos", "gen", "ns/lex", "ns/parse",
+		   "ns/pos", "ns/gen", "tableKB", "codeKB", "rssKB");
+	for (i = 0; i < steps; i++, *param *= 2)
+	{
+		struct scalepoint *pt = &pts[n];
+		size_t len;
+		char *src = generate(&gp, &len);
+		int err = measure(ctx, src, len, pt);
+		double tok;
+
+		free(src);
+		if (err != 0)
+		{
+			if (err < 0 && ctx->fatalmsg)
+				printf("%6d %9zu  breaks down: %s (%d instructions, %d symbols)\n", *param, len, ctx->fatalmsg,
+					   ctx->cx, ctx->tx);
+			else
+				printf("%6d %9zu  breaks down: %d errors, first: error %d at line %d\n", *param, len, err,
+					   ctx->errcode, ctx->errline);
+			break;
+		}
+		tok = pt->st.tokens ? (double)pt->st.tokens : 1;
+		printf("%6d %9zu %8lld %6d %6d %9lld %8.3f | %8.3f %8.3f %8.3f %8.3f | %8.1f %8.1f %8.1f %8.1f | %8.1f %8.1f %8ld\n",
+			   *param, pt->bytes, pt->st.tokens, pt->tx, pt->cx, pt->st.probes, pt->msec, pt->lexms, pt->parsems,
+			   pt->lookupms, pt->genms, pt->lexms * 1e6 / tok, pt->parsems * 1e6 / tok, pt->lookupms * 1e6 / tok,
+			   pt->genms * 1e6 / tok, (pt->tx + 1) * sizeof(struct tablestruct) / 1024.0,
+			   pt->cx * (sizeof(struct instruction) + sizeof(int)) / 1024.0, pt->maxrss);
+		if (csv)
+			fprintf(csv, "%d,%zu,%d,%lld,%d,%d,%lld,%lld,%lld,%lld,%.6f,%.6f,%.6f,%.6f,%.6f,%zu,%zu,%zu,%ld\n",
+					*param, pt->bytes, pt->lines, pt->st.tokens, pt->tx, pt->cx, pt->st.lookups, pt->st.probes,
+					pt->st.statements, pt->st.expressions, pt->msec, pt->lexms, pt->parsems, pt->lookupms, pt->genms,
+					pt->bytes, (pt->tx + 1) * sizeof(struct tablestruct),
+					pt->cx * (sizeof(struct instruction) + sizeof(int)), pt->maxrss);
+		n++;
+	}
+	printf("(ns/xxx: nanoseconds per token; sizeof(struct compiler) = %zu KB)\n",
+		   sizeof(struct compiler) / 1024);
+
+	if (n >= 2)
+	{
+		double *x = malloc(sizeof(double) * n), *y = malloc(sizeof(double) * n);
+
+		printf("\ngrowth exponent of time against tokens (1 = linear):\n");
+		for (k = 0; k < 5; k++)
+		{
+			double e;
+
+			for (i = 0; i < n; i++)
+			{
+				x[i] = (double)pts[i].st.tokens;
+				y[i] = k == 0 ? pts[i].lexms : k == 1 ? pts[i].parsems : k == 2 ? pts[i].lookupms
+																		  : k == 3	? pts[i].genms
+																					: pts[i].msec;
+			}
+			e = slope(x, y, n);
+			printf("%-9s %5.2f%s\n", phases[k], e, e > 1.3 ? "  super-linear" : "");
+		}
+		for (i = 0; i < n; i++)
+			y[i] = (double)pts[i].st.probes;
+		printf("%-9s %5.2f  (symbol table entries compared)\n", "probes", slope(x, y, n));
+		free(x);
+		free(y);
+	}
+	if (csv)
+	{
+		fclose(csv);
+		printf("\nresults written to %s\n", csvpath);
+	}
+	free(ctx);
+	free(pts);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct genparams gp = {4, 8, 3, 2, 3, 4, 1};
+	const char *outpath = NULL, *csvpath = NULL;
+	char dim = 0;
+	int steps = 8, i;
+	bool bad = false;
+
+	for (i = 1; i < argc; i++)
+	{
+		int *opt = NULL;
+
+		if (argv[i][0] == '-' && argv[i][1] && !argv[i][2] && i + 1 < argc)
+		{
+			switch (argv[i][1])
+			{
+			case 'f':
+				opt = &gp.funcs;
+				break;
+			case 's':
+				opt = &gp.stmts;
+				break;
+			case 'e':
+				opt = &gp.depth;
+				break;
+			case 'n':
+				opt = &gp.nest;
+				break;
+			case 'r':
+				opt = &gp.recur;
+				break;
+			case 'i':
+				opt = &gp.idents;
+				break;
+			case 'k':
+				opt = &steps;
+				break;
+			case 'z':
+				gp.seed = (unsigned)strtoul(argv[++i], NULL, 10);
+				continue;
+			case 'o':
+				outpath = argv[++i];
+				continue;
+			case 'c':
+				csvpath = argv[++i];
+				continue;
+			case 'S':
+				dim = argv[++i][0];
+				continue;
+			}
+		}
+		if (opt == NULL)
+		{
+			bad = true;
+			break;
+		}
+		*opt = atoi(argv[++i]);
+		if (*opt < 0)
+			bad = true;
+	}
+	if (gp.idents < 1)
+		gp.idents = 1;
+	if (bad || (dim && dimof(&gp, dim) == NULL) || steps < 1)
+	{
+		fprintf(stderr, "usage: l25gen [-f funcs] [-s stmts] [-e expr-depth] [-n nest] [-r recursion] [-i idents] "
+						"[-z seed] [-o out.l25]\n"
+						"       l25gen -S f|s|e|n|i [-k steps] [-c results.csv] [generator options]\n");
+		return 1;
+	}
+
+	if (dim)
+		return scaling(gp, dim, steps, csvpath);
+	else
+	{
+		size_t len;
+		char *src = generate(&gp, &len);
+		FILE *f = outpath ? fopen(outpath, "w") : stdout;
+
+		if (f == NULL)
+		{
+			fprintf(stderr, "Can't open %s!\n", outpath);
+			free(src);
+			return 1;
+		}
+		fwrite(src, 1, len, f);
+		if (outpath)
+			fclose(f);
+		free(src);
+	}
+	return 0;
+}
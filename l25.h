@@ -0,0 +1,700 @@
+/*
+ * l25.h
+ * L25 编译器与虚拟机共用的定义：符号、指令、符号表以及编译器/虚拟机上下文
+ */
+
+#ifndef L25_H
+#define L25_H
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdatomic.h>
+
+#define bool int
+#define true 1
+#define false 0
+
+#define norw 18			 /* 保留字个数 */
+#define txmax 16384	 /* 符号表容量 */
+#define nmax 14			 /* 数字的最大位数 */
+#define al 10			 /* 标识符的最大长度 */
+#define maxerr 30		 /* 允许的最多错误数 */
+#define amax 0xfffffffff /* 地址上界*/
+#define cxmax 65536	 /* 最多的虚拟机代码数 */
+#define stacksize 500	 /* 运行时数据栈元素最多为500个 */
+#define stackslack 32	 /* 进入函数时为表达式求值预留的栈单元数，不够的部分记在 ini 中 */
+#define timeslice 10000	 /* 时间片的默认指令数 */
+#define trymax 4096		 /* 最多的 try 语句数 */
+#define forkmax 8		 /* 一个表达式中最多登记的兄弟调用数 */
+#define groupmax 4096	 /* 最多登记的兄弟调用组数 */
+#define forkdepth 10	 /* 默认只在调用深度不超过此值时分叉 */
+#define spawnmax 4096	 /* 最多登记的 spawn 数 */
+#define arraymax 4096	 /* 一个函数中最多登记的数组声明和数组访问数，供范围分析用 */
+#define listmax 65536	 /* 最多的语句序列数，供范围分析用 */
+#define heapmax (1 << 24) /* 数组堆最多的单元数 */
+
+/* 符号 */
+enum symbol
+{
+	nul,	   // 空
+	ident,	   // 标识符
+	number,	   // 数字
+	plus,	   // 加法 +
+	minus,	   // 减法 -
+	times,	   // 乘法 *
+	slash,	   // 除法 /
+	eql,	   // 等于 ==
+	neq,	   // 不等于 !=
+	lss,	   // 小于 <
+	leq,	   // 小于等于 <=
+	gtr,	   // 大于 >
+	geq,	   // 大于等于 >=
+	lparen,	   // 左括号 (
+	rparen,	   // 右括号 )
+	lbrace,	   // 左大括号 {
+	rbrace,	   // 右大括号 }
+	lbracket,  // 左方括号 [
+	rbracket,  // 右方括号 ]
+	comma,	   // 逗号 ,
+	semicolon, // 分号 ;
+	period,	   // 结束符 .
+	becomes,   // 赋值 =
+	elsesym,   // 否则 "else"
+	funcsym,   // 函数 "function"
+	ifsym,	   // 判断 "if"
+	inputsym,  // 输入 "input"
+	letsym,	   // 声明 "let"
+	mainsym,   // 函数 "main"
+	outputsym, // 输出 "output"
+	progsym,   // 程序 "program"
+	returnsym, // 返回 "return"
+	whilesym,  // 循环 "while"
+	trysym,	   // 异常处理 "try"
+	catchsym,  // 异常处理 "catch"
+	spawnsym,  // 启动任务 "spawn"
+	joinsym,   // 等待任务 "join"
+	parforsym, // 并行循环 "parfor"
+	gensym,	   // 生成器 "generator"
+	nextsym,   // 取生成器的下一个值 "next"
+	yieldsym   // 交出一个值 "yield"
+};
+#define symnum 41
+
+/* 符号集合：每个符号占 64 位掩码中的一位，集合运算化为按位运算 */
+typedef unsigned long long symset;
+#define SYMBIT(e) (1ULL << (e))
+_Static_assert(symnum <= 64, "symset 只能容纳 64 个符号");
+
+/* 符号表中的类型 */
+enum object
+{
+	variable,
+	param,
+	function,
+};
+
+/* 虚拟机代码指令 */
+enum fct
+{
+	lit,
+	opr,
+	lod,
+	sto,
+	cal,
+	ini,
+	jmp,
+	jpc,
+	ldx,  /* 取数组元素：变量 a 是句柄，栈顶的下标换成元素 */
+	stx,  /* 存数组元素：次栈顶是下标，栈顶是值 */
+	ldxu, /* 同 ldx，范围分析已证明下标在界内，不检查 */
+	stxu, /* 同 stx，不检查 */
+};
+#define fctnum 12
+
+/* ini 的操作数：低 16 位是栈帧大小，高位是函数中表达式求值比 stackslack 多用的栈单元数 */
+#define iniframe(a) ((a) & 0xffff)
+#define iniextra(a) ((a) >> 16)
+
+/* 虚拟机代码结构 */
+struct instruction
+{
+	enum fct f; /* 虚拟机代码指令 */
+	int a;		/* 根据f的不同而不同 */
+};
+
+/* 符号表结构 */
+struct tablestruct
+{
+	char name[al];	  /* 名字 */
+	enum object kind; /* 类型：const，var或procedure */
+	int adr;		  /* 地址，仅const不使用 */
+	int size;		  /* 需要分配的数据区空间, 仅procedure使用 */
+	int paramCnt;	  /* 函数形参个数           */
+	unsigned attr;	  /* 位标志：bit0=isParam…  */
+};
+
+/* 异常表的一项：地址在 [start, end) 中的指令出错时转到 handler，栈顶由 ini 指令给出的栈帧大小恢复 */
+struct tryregion
+{
+	int start, end;
+	int handler;
+	int ini;
+};
+
+/* 同一表达式中直接作为因子、结果在最后一次调用返回之前都不被运算取用的几次函数调用：cal 指令的地址和实参个数 */
+struct forkgroup
+{
+	int n;
+	int cal[forkmax];
+	int nargs[forkmax];
+};
+
+/* let a[n] 声明的数组：长度是常数，或是声明之前不再赋值的变量时，while 循环可以据此省去下标检查 */
+struct arraydecl
+{
+	int adr;	/* 数组变量的地址 */
+	int sto;	/* 声明中 sto 指令的地址 */
+	int list;	/* 声明所在的语句序列 */
+	int lenadr; /* 长度是一个变量时为它的地址，否则为 0 */
+	int len;	/* 长度是常数时为它，否则为 -1 */
+};
+
+/* 下标是单个变量的数组访问：ldx 或 stx 指令的地址、数组变量和下标变量的地址 */
+struct arrayaccess
+{
+	int pc;
+	int adr;
+	int idx;
+};
+
+/* 编译各部分的调用次数和耗时（profclock() 的单位），用于观察编译时间随程序规模的增长 */
+struct compstats
+{
+	long long tokens;				/* getsym() 读出的符号数 */
+	unsigned long long lexclock;	/* getsym() 的耗时，含 getch() */
+	long long lookups;				/* position() 调用次数 */
+	long long probes;				/* position() 比较的符号表项数 */
+	unsigned long long lookupclock;
+	long long gens;					/* gen() 生成的指令数 */
+	unsigned long long genclock;
+	long long statements;			/* statement() 调用次数 */
+	long long expressions;			/* expression() 调用次数 */
+	long long symbols;				/* enter() 登记的符号数 */
+	unsigned long long clock;		/* 整个 compile() 的耗时 */
+};
+
+/* 硬件性能计数器：周期数、指令数、分支预测失败数、L1d 缺失数 */
+#define perfevents 4
+struct perfctr
+{
+	int fd[perfevents]; /* 打不开的事件为 -1 */
+	const char *why;	/* 第一个打不开的事件的原因 */
+};
+
+/* 一个阶段累计的墙钟时间和进程 CPU 时间（毫秒） */
+struct phasetime
+{
+	double wall;
+	double cpu;
+};
+
+/*
+ * 一次作业（编译、列出代码、执行）的统计，由 stats_write() 写成 JSON
+ * 词法分析、语法分析和代码生成在 program() 中交错进行，按 compstats 中各部分的时钟比例分摊编译的耗时
+ */
+struct jobstats
+{
+	struct phasetime compile;		/* 整个 compile() */
+	struct phasetime lex, parse, codegen; /* 由 compile 分摊 */
+	struct phasetime list;			/* listall() */
+	struct phasetime exec;			/* interpret()，多次运行时累计 */
+	struct compstats comp;			/* 编译时由 ctx->stats 指向 */
+	int errors;						/* 编译错误数，-1 表示无法继续编译 */
+	int instructions;				/* 生成的指令数 */
+	int symbols;					/* 符号表的最终项数 */
+	int runs;						/* 执行次数 */
+	int status;						/* 最后一次执行的 enum vmstatus */
+	long long steps;				/* 执行的指令数，多次运行时累计 */
+	int maxt, maxdepth;				/* 虚拟机的高水位，多次运行时取最大 */
+	long compilerss, maxrss;		/* 编译后和作业结束时进程常驻内存的高水位（KB） */
+};
+
+/*
+ * 编译器上下文：一次编译所需的全部状态
+ * 各次编译互不共享，可以在多个线程中同时编译不同的程序
+ */
+struct compiler
+{
+	bool listswitch;				 /* 显示虚拟机代码与否 */
+	bool tableswitch;				 /* 显示符号表与否 */
+	bool echo;						 /* 是否同时在屏幕上回显源程序、错误和清单 */
+	char ch;						 /* 存放当前读取的字符，getch 使用 */
+	enum symbol sym;				 /* 当前的符号 */
+	char id[al + 1];				 /* 当前ident，多出的一个字节用于存放0 */
+	int num;						 /* 当前number */
+	int cc, ll;						 /* getch使用的计数器，cc表示当前字符(ch)的位置 */
+	int cx;							 /* 虚拟机代码指针, 取值范围[0, cxmax-1]*/
+	int tx;							 /* 当前符号表尾，0 表示仅有哨兵 */
+	int dx;
+	int curFuncIdx;
+	int err;						 /* 错误计数器 */
+	char line[81];					 /* 读取行缓冲区 */
+	char a[al + 1];					 /* 临时符号，多出的一个字节用于存放0 */
+	FILE *fin;						 /* 输入源文件 */
+	FILE *ftable;					 /* 输出符号表，为 NULL 时不输出 */
+	FILE *fcode;					 /* 输出虚拟机代码，为 NULL 时不输出 */
+	FILE *foutput;					 /* 输出文件及出错示意（如有错）、各行对应的生成代码首地址（如无错） */
+	const char *src;				 /* 源程序字符串，为 NULL 时从 fin 读取 */
+	size_t srclen;					 /* 源程序字符串的长度 */
+	size_t srcpos;					 /* 下一个要读的字符下标 */
+	bool srcend;					 /* 源程序字符串已读完 */
+	int lineno;						 /* 当前行号，从 1 开始 */
+	int symline;					 /* 当前符号所在的行 */
+	int prevline;					 /* 上一个符号所在的行，生成的指令记在这一行上 */
+	int errline, errcol, errcode;	 /* 第一个错误的行号、列号和错误编码 */
+	const char *fatalmsg;			 /* 无法继续编译的原因 */
+	jmp_buf fatal;					 /* 无法继续编译时（程序过长、符号表溢出、错误过多）跳回 compile() */
+	int inipos;						 /* 当前函数（或主程序）的 ini 指令地址 */
+	int ntries;						 /* 异常表的项数 */
+	struct forkgroup *group;		 /* 正在编译的表达式中的兄弟调用，不在表达式中时为 NULL */
+	int ngroups;					 /* 登记的兄弟调用组数 */
+	int nspawns;					 /* 登记的 spawn 数 */
+	int loopfloor;					 /* 在 parfor 的循环体中时为循环体之前的 dx，低于它的变量不能赋值；否则为 0 */
+	bool ingen;						 /* 正在编译生成器函数，可以 yield */
+	int curlist;					 /* 正在编译的语句序列，listparent[] 中的下标 */
+	int nlists;
+	int ndecls, naccesses, nsafe;	 /* 本函数的数组声明、数组访问和已证明在界内的访问数 */
+	int opdepth, opmax, opk;		 /* 本函数中栈帧之上的操作数个数、表达式求值用到的最多单元数和 opr 17 的参数位置 */
+	struct compstats *stats;		 /* 编译统计，为 NULL 时不统计 */
+	/* 大数组放在最后：重置上下文时只需把 code 之前的部分清零 */
+	struct instruction code[cxmax];	 /* 存放虚拟机代码的数组 */
+	int codeline[cxmax];			 /* 每条虚拟机代码对应的源程序行号 */
+	struct tablestruct table[txmax]; /* 符号表 */
+	struct tryregion tries[trymax];	 /* 异常表，编译结束时生成到主程序之后 */
+	struct forkgroup groups[groupmax]; /* 兄弟调用组，编译结束时只把纯函数的组生成到异常表之后 */
+	int spawns[spawnmax];			 /* spawn 的 opr 19 指令地址，编译结束时只把纯函数的生成到分叉表中 */
+	int listparent[listmax];		 /* 每个语句序列所在的语句序列，函数体和主程序为 -1 */
+	struct arraydecl decls[arraymax];
+	struct arrayaccess accesses[arraymax];
+	struct arrayaccess safe[arraymax]; /* while 循环证明下标在界内的访问，函数结束时确认数组和长度没有再赋值 */
+};
+
+/* 虚拟机执行结果 */
+/* 剖析时每个活动函数的记录 */
+struct profframe
+{
+	int entry;					/* 函数入口地址 */
+	unsigned long long start;	/* 进入时的时钟 */
+	unsigned long long child;	/* 被调函数的包含时间之和 */
+};
+
+/* 剖析数据，以 code[] 下标为索引，可以在多次运行之间累计 */
+struct profile
+{
+	int cx;
+	long long *count;			/* 每条指令的执行次数 */
+	long long *calls;			/* 以该地址为入口的调用次数 */
+	unsigned long long *incl;	/* 以该地址为入口的函数的包含时间 */
+	unsigned long long *excl;	/* 同上，不含被调函数的时间 */
+	int *active;				/* 正在执行的层数，递归时只计最外层的包含时间 */
+	struct profframe frames[stacksize];
+	int depth;
+	int maxdepth;				/* 最大调用深度 */
+	int maxt;					/* 栈顶指针 t 的最大值 */
+};
+
+/* 采样剖析器 */
+struct sampler
+{
+	volatile sig_atomic_t pending; /* 定时信号到达，在下一个安全点采样 */
+	int cx;
+	int *funcof;				   /* 每条指令所属的函数编号 */
+	int nfunc;
+	char **names;				   /* 函数名，0 号为 main */
+	int *buf;					   /* 样本：调用深度，随后从最内层到 main 的函数编号 */
+	int nbuf, capbuf;
+	int nsamples;
+};
+
+/*
+ * 执行轨迹文件（.l25t）：64 字节的文件头，随后是 capacity 条定长记录组成的环形缓冲区
+ * 第 n 条记录（从 0 起）存放在 n % capacity 处，只保留最后 capacity 条
+ */
+#define L25T_MAGIC 0x5435324c /* "L25T" */
+#define L25T_VERSION 1
+
+struct traceheader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned long long capacity; /* 记录条数，2 的幂；没有回绕时截为实际条数 */
+	unsigned long long count;	 /* 已写入的记录总数，可能超过 capacity */
+	unsigned long long codehash; /* 被跟踪程序的 codehash() */
+	int cx;						 /* 被跟踪程序的指令条数 */
+	int recsize;				 /* sizeof(struct tracerec) */
+	char pad[24];
+};
+
+/* 一条轨迹记录：执行一条指令之前的状态 */
+struct tracerec
+{
+	int pc;	 /* 指令地址 */
+	int f;	 /* enum fct */
+	int a;	 /* 操作数 */
+	int t;	 /* 栈顶指针 */
+	int b;	 /* 基址 */
+	int tos; /* 栈顶的值 s[t] */
+};
+
+/* 正在写的轨迹，文件映射到内存中 */
+struct tracer
+{
+	struct traceheader *hdr;
+	struct tracerec *ring;
+	unsigned long long mask; /* capacity - 1 */
+	unsigned long long n;	 /* 已写入的记录数，每次 vmrun() 结束时写回 hdr->count */
+	size_t size;			 /* 映射的字节数 */
+	int fd;
+};
+
+/*
+ * 虚拟机快照文件（.l25s）：64 字节的文件头，随后是 s[0..ncells-1]，每个单元一个 32 位整数
+ * 只能用同一份代码（codehash() 相同）恢复
+ */
+#define L25S_MAGIC 0x5335324c /* "L25S" */
+#define L25S_VERSION 1
+
+struct snapheader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned long long codehash; /* 程序的 codehash() */
+	int cx;						 /* 程序的指令条数 */
+	int p, b, t, k;				 /* 寄存器 */
+	int depth;					 /* 调用深度 */
+	long long steps;			 /* 已执行的指令数 */
+	int inpos;					 /* 已读的输入个数 */
+	int nout;					 /* 已输出的数据个数 */
+	int ncells;					 /* 保存的栈单元数，停在函数入口时包括 t 之上的实参 */
+	char pad[4];
+};
+
+/*
+ * 纯函数兄弟调用的并行执行（l25Fork.c）
+ * 分叉表中一组调用除最后一次以外，在调用深度不超过 cutoff 时交给线程池，在自己的栈上执行，
+ * 父任务先在结果的位置压入 0 接着往下执行，最后一次调用返回时取回结果
+ */
+struct forksite
+{
+	int nargs;	  /* 可以分叉的 cal 指令：实参个数，否则为 -1 */
+	int join;	  /* 可以分叉的 cal 指令：取回结果的地址 */
+	bool collect; /* 一组中最后一次调用的返回地址，在这里取回结果 */
+	bool spawn;	  /* 启动纯函数的 opr 19，可以立即交给线程池 */
+};
+
+struct parallel
+{
+	struct wspool *pool;
+	struct forksite *site;	/* 以 code[] 下标为索引 */
+	int cutoff;				/* 调用深度不超过此值时才分叉 */
+	atomic_llong forks;		/* 分叉的调用数 */
+	atomic_llong redone;	/* 子任务出错、改为顺序重新执行的调用数 */
+	atomic_llong spawned;	/* 交给线程池的 spawn 数 */
+	atomic_llong chunks;	/* parfor 交给线程池的分段数 */
+};
+
+/*
+ * 生成器（l25Coro.c）：调用生成器函数时在自己的栈段上建立栈帧，返回句柄；
+ * next(句柄) 把寄存器切换到它的栈段上执行到下一次 yield 或 return，再切换回来
+ */
+struct coroutine
+{
+	int *s;							/* 自己的栈段，结束后释放 */
+	int p, b, t;					/* 挂起时的寄存器，挂起处只有生成器自己的栈帧 */
+	int fn;							/* 生成器函数的入口，剖析用 */
+	int *rs;						/* 执行 next 的一方：栈、寄存器和调用深度 */
+	int rp, rb, rt, rk, rdepth;
+	struct coroutine *resumer;		/* 执行 next 的协程，在主栈上时为 NULL */
+	bool running;					/* 在 next 的链上，不能再被 next */
+	bool done;						/* 已 return 或因出错结束，之后的 next 都得到 value */
+	int value;
+};
+
+enum vmstatus
+{
+	vm_ok,		 /* 正常结束 */
+	vm_divzero,	 /* 除零且没有 catch 可以处理 */
+	vm_noinput,	 /* 输入已读完，p 停在 opr 16 上 */
+	vm_overflow, /* 数据栈溢出 */
+	vm_yield,	 /* 本次执行的指令预算已用完，可以继续执行 */
+	vm_nofuel,	 /* 超出整个运行的指令数上限 */
+	vm_timeout,	 /* 超出整个运行的墙钟时间上限 */
+	vm_badjoin,	 /* join 的句柄无效或已经 join 过 */
+	vm_badnext,	 /* next 的句柄无效，或生成器正在执行 */
+	vm_bounds,	 /* 数组下标越界，或不是数组 */
+	vm_heap,	 /* 数组长度为负，或数组堆已满 */
+};
+
+/* 数组的描述符：元素在堆中的起始位置和个数，句柄是描述符的下标加 1 */
+struct arraydesc
+{
+	int base;
+	int len;
+};
+
+/* 栈帧的区域：基址为 b 的栈帧第一次新建数组时，之前已有 mark 个数组；返回时释放之后新建的数组 */
+struct region
+{
+	int b;
+	int mark;
+};
+
+/*
+ * 虚拟机上下文：一次执行所需的全部状态
+ * code[] 只读，可被多个虚拟机同时执行
+ */
+struct vm
+{
+	const struct instruction *code; /* 待执行的虚拟机代码 */
+	int p;							/* 指令指针 */
+	int b;							/* 指令基址 */
+	int t;							/* 栈顶指针 */
+	int k;							/* 参数位置 */
+	int s[stacksize];				/* 栈 */
+	bool stackswitch;				/* 每条指令执行后输出整个栈与否 */
+	bool echo;						/* 是否同时在屏幕上输出执行结果 */
+	FILE *fresult;					/* 输出执行结果，为 NULL 时不输出 */
+	const int *in;					/* 输入缓冲区，为 NULL 时从标准输入读取 */
+	int nin;						/* 输入缓冲区中的数据个数 */
+	int inpos;						/* 已读的输入个数，也是下一个要读的输入缓冲区下标 */
+	int *out;						/* 输出缓冲区，为 NULL 时不保存输出 */
+	int outcap;						/* 输出缓冲区容量，超出部分只计数不保存 */
+	int nout;						/* 已输出的数据个数 */
+	int (*input)(void *user, int *value); /* 输入回调，in 为 NULL 时使用，返回 0 表示读到 */
+	void (*output)(void *user, int value); /* 输出回调 */
+	void (*newline)(void *user);	/* 输出换行的回调 */
+	void *iouser;					/* 传给回调的参数 */
+	struct profile *prof;			/* 剖析数据，为 NULL 时不剖析 */
+	struct sampler *sampler;		/* 采样剖析器，为 NULL 时不采样 */
+	struct tracer *trace;			/* 执行轨迹，为 NULL 时不记录 */
+	long long steps;				/* 已执行的指令数，在跳转、调用和返回处按顺序执行段累计 */
+	int maxt;						/* 栈顶指针 t 的最大值 */
+	int depth, maxdepth;			/* 当前和最大的调用深度，主程序为 1 */
+	struct parallel *par;			/* 不为 NULL 时纯函数的兄弟调用并行执行，只在 interpret() 中分叉 */
+	struct forktask *forks;			/* 已分叉、还没有取回结果的调用，最近分叉的在前 */
+	struct spawntask **spawned;		/* spawn 得到的任务，句柄是下标加 1，join 之后置为 NULL */
+	int nspawned, capspawned;
+	int loopb, loopend;				/* parfor 的分段：循环所在栈帧的基址和循环末尾 opr 22 的地址，否则为 0 和 -1 */
+	struct coroutine *co;			/* 寄存器所在的生成器，在主栈 s 上时为 NULL */
+	struct coroutine **coros;		/* 建立的生成器，句柄是下标加 1 */
+	int ncoros, capcoros;
+	struct arraydesc *arrays;		/* 数组的描述符 */
+	int narrays, caparrays;
+	int *heap;						/* 数组的元素，连续存放 */
+	int heaptop, heapcap;
+	bool sharedheap;				/* 数组属于父任务（parfor 的分段），只能读写元素，不能新建 */
+	int *undo;						/* sharedheap 时改写的元素的下标和原值，成对存放 */
+	int nundo, capundo;
+	struct region *regions;			/* 主栈上新建过数组的栈帧，按基址递增 */
+	int nregions, capregions;
+	int pin, pinbase;				/* 句柄存入了更早的数组：前 pin 个数组要保留到第 pinbase 个数组释放，pin 为 0 时没有 */
+	int keep;						/* 生成器或 spawn 的任务持有句柄：前 keep 个数组不再释放 */
+};
+
+/*
+ * 同一程序的 lanes 次运行按 SIMD 道同步执行（l25Lanes.c）
+ * 栈按单元交错存放，s[i][l] 是第 l 道的第 i 个单元；p、b、t、k 都相同的道组成一组，
+ * 一条指令对整组做一次向量运算，条件跳转各道不同时分组，到达相同的状态时重新合并
+ */
+#define lanes 8
+/* 对齐要写明：不带 -mavx 编译时 GCC 只按 16 字节对齐，而 AVX2 版本按 32 字节访问 */
+typedef int lanevec __attribute__((vector_size(lanes * sizeof(int)), aligned(lanes * sizeof(int))));
+
+struct lanevm
+{
+	lanevec s[stacksize];			 /* 栈，放在开头以便按向量对齐 */
+	const struct instruction *code;
+	const struct vm *start;			 /* 各道的初始状态 */
+	int p[lanes], b[lanes], t[lanes], k[lanes]; /* 各道的寄存器，只在分组时更新 */
+	const int *in[lanes];			 /* 各道的输入缓冲区 */
+	int nin[lanes], inpos[lanes];
+	int *out[lanes];				 /* 各道的输出缓冲区 */
+	int outcap[lanes], nout[lanes];
+	long long steps[lanes];			 /* 各道执行的指令数 */
+	int status[lanes];				 /* enum vmstatus，还没结束时为 vm_yield */
+	int n;							 /* 使用的道数 */
+};
+
+/* 只读的已编译程序，可被多个虚拟机同时执行 */
+struct program
+{
+	struct instruction *code;
+	int cx;
+	struct vm *prefix; /* 执行到第一次 input() 的虚拟机，不为 NULL 时每次运行从它的副本开始 */
+};
+
+/* 执行服务中的一次独立运行 */
+struct execjob
+{
+	const struct program *prog; /* 要执行的程序 */
+	const int *in;				/* 本次运行的输入 */
+	int nin;
+	int *out;					/* 本次运行的输出缓冲区 */
+	int outcap;
+	int nout;					/* 输出个数，可能超过 outcap */
+	int status;					/* enum vmstatus */
+	double msec;				/* 执行耗时（毫秒） */
+	long long fuel;				/* 指令数上限，<= 0 表示不限 */
+	double timeout;				/* 墙钟时间上限（毫秒），<= 0 表示不限 */
+	struct execservice *svc;	/* 由 exec_submit() 填写 */
+	int nlanes;					/* 与其后的几次运行按道同步执行，由 exec_submitlanes() 填写 */
+};
+
+/* 时间片调度器中的一个虚拟机 */
+struct schedjob
+{
+	struct vm *vm;	/* 已由 vminit() 准备好 */
+	long long fuel; /* 指令数上限，<= 0 表示不限 */
+	double timeout; /* 墙钟时间上限（毫秒），从调度开始计算，<= 0 表示不限 */
+	int status;		/* enum vmstatus */
+	double msec;	/* 从调度开始到运行结束的墙钟时间（毫秒） */
+};
+
+/* 目标文件（.l25o）格式：魔数、版本、指令条数，随后每条指令两个 32 位整数 f、a
+ * 版本 2：code[1] 给出异常表的地址，不再有 opr 19/20
+ * 版本 3：异常表之后是分叉表
+ * 版本 4：分叉表末尾是纯函数的 spawn，opr 19～22 为 spawn、join 和 parfor
+ * 版本 5：opr 23～25 为生成器
+ * 版本 6：f 增加 ldx、stx、ldxu、stxu（数组元素的存取），opr 26 新建数组
+ * 版本 7：opr 27～31 为数组的整体操作 sum、dot、fill、scale、copy
+ * 版本 8：ini 的操作数高位是表达式求值比 stackslack 多用的栈单元数（见 iniframe()、iniextra()） */
+#define L25O_MAGIC 0x4f35324c /* "L25O" */
+#define L25O_VERSION 8
+
+/* 录制的输入文件：魔数、版本，随后每个输入值按 zigzag 编码为 LEB128 变长整数 */
+#define L25I_MAGIC 0x4935324c /* "L25I" */
+#define L25I_VERSION 1
+
+extern const char mnemonic[fctnum][5];
+
+int compile(struct compiler *ctx);
+int writeobject(FILE *fobj, const struct instruction *code, int cx);
+int readobject(FILE *fobj, struct instruction **pcode, int *pcx);
+unsigned long long codehash(const struct instruction *code, int cx);
+int findhandler(const struct instruction *code, const int *s, int stride, int pc, int *pb);
+int batch_main(int argc, char **argv);
+
+struct wspool *wspool_create(int n);
+int wspool_size(const struct wspool *pool);
+void wspool_submit(struct wspool *pool, void (*fn)(void *arg, int worker), void *arg);
+void wspool_wait(struct wspool *pool);
+void wspool_join(struct wspool *pool, atomic_int *done);
+void wspool_destroy(struct wspool *pool);
+
+int loadprogram(struct program *prog, const char *path);
+int prefix_create(struct program *prog, int outcap, long long fuel);
+void lanes_start(struct lanevm *lv, const struct vm *start);
+int lanes_add(struct lanevm *lv, const int *in, int nin, int *out, int outcap);
+int lanes_run(struct lanevm *lv, long long fuel, double deadline);
+void lanes_extract(const struct lanevm *lv, int l, struct vm *vm);
+void freeprogram(struct program *prog);
+struct execservice *exec_create(int nthreads);
+void exec_submit(struct execservice *svc, struct execjob *job);
+void exec_submitlanes(struct execservice *svc, struct execjob *jobs, int n);
+void exec_wait(struct execservice *svc);
+void exec_destroy(struct execservice *svc);
+const char *vmstatusname(int status);
+int vmslice(struct vm *vm, long long slice, long long fuel, double deadline);
+void schedule(struct schedjob *jobs, int njobs, long long slice);
+int readinputs(const char *path, int ***pinputs, int **pninputs);
+int exec_main(int argc, char **argv);
+int cli_main(int argc, char **argv);
+
+struct profile *prof_create(int cx);
+void prof_destroy(struct profile *prof);
+unsigned long long profclock(void);
+extern const char *const perfname[perfevents];
+int perf_open(struct perfctr *pc);
+void perf_close(struct perfctr *pc);
+void perf_start(struct perfctr *pc);
+void perf_stop(struct perfctr *pc, long long v[perfevents]);
+void perf_add(long long sum[perfevents], const long long v[perfevents]);
+void perf_report(FILE *f, const char *label, const long long v[perfevents], long long ops);
+void phase_begin(struct phasetime *pt);
+void phase_end(struct phasetime *pt);
+void stats_compiled(struct jobstats *js, const struct compiler *ctx, int err);
+void stats_ran(struct jobstats *js, const struct vm *vm, int status);
+int stats_write(const char *path, const struct jobstats *js);
+void prof_start(struct profile *prof, int entry);
+void prof_enter(struct profile *prof, int entry);
+void prof_leave(struct profile *prof);
+void prof_report(FILE *f, const struct compiler *ctx, const struct profile *prof, const char *srcpath);
+
+struct sampler *sampler_create(const struct compiler *ctx);
+void sampler_destroy(struct sampler *smp);
+int sampler_start(struct sampler *smp, int hz);
+void sampler_stop(struct sampler *smp);
+void sampler_take(struct sampler *smp, int p, int b, const int *s);
+void sampler_write(FILE *f, const struct sampler *smp);
+
+struct tracer *trace_create(const char *path, long long capacity, const struct instruction *code, int cx);
+void trace_close(struct tracer *tr);
+struct parallel *par_create(const struct instruction *code, int cx, struct wspool *pool, int cutoff);
+void par_destroy(struct parallel *par);
+void fork_spawn(struct vm *vm, int entry, int pc, int b, int t, int depth);
+int fork_join(struct vm *vm, int p, int b);
+int fork_flush(struct vm *vm);
+int spawn_start(struct vm *vm, const int *s, int pc, int entry, int nargs, int t, int depth);
+int spawn_join(struct vm *vm, int *s, int h, int t, int *value);
+void spawn_release(struct vm *vm);
+int par_loop(struct vm *vm, int pc, int b, int t, int depth);
+int coro_create(struct vm *vm, const int *s, int b, int entry);
+struct coroutine *coro_get(struct vm *vm, int h);
+void coro_finish(struct coroutine *co, int value);
+void coro_release(struct vm *vm);
+int array_new(struct vm *vm, int len);
+const struct arraydesc *array_get(const struct vm *vm, int h);
+int region_enter(struct vm *vm, int b);
+int region_leave(struct vm *vm, int value);
+int region_unwind(struct vm *vm, int b);
+void region_pin(struct vm *vm, int container, int value);
+void region_keep(struct vm *vm, const int *v, int n);
+void array_log(struct vm *vm, int at, int n);
+void array_undo(struct vm *vm);
+void array_logmerge(struct vm *vm, const struct vm *cv);
+void array_release(struct vm *vm);
+int bulk_sum(const int *a, int n);
+int bulk_dot(const int *a, const int *b, int n);
+void bulk_fill(int *a, int n, int v);
+void bulk_scale(int *a, int n, int k);
+void bulk_copy(int *dst, const int *src, int n);
+void vmwrite(struct vm *vm, int value);
+void vmwriteln(struct vm *vm);
+int snap_save(const char *path, const struct vm *vm, int cx);
+int snap_load(const char *path, struct vm *vm, int cx);
+void error(struct compiler *ctx, int n);
+void getsym(struct compiler *ctx);
+void getch(struct compiler *ctx);
+void init(struct compiler *ctx);
+void gen(struct compiler *ctx, enum fct x, int z);
+void test(struct compiler *ctx, symset s1, symset s2, int n);
+void program(struct compiler *ctx, symset fsys); /* 顶层 */
+void parse_function_header(struct compiler *ctx, symset fsys);
+void block(struct compiler *ctx, int *ptx, symset fsys, int isFunc, int *retParamCnt);
+void vminit(struct vm *vm, const struct instruction *code);
+void vmrelease(struct vm *vm);
+int interpret(struct vm *vm);
+int vmrun(struct vm *vm, long long budget);
+void factor(struct compiler *ctx, symset fsys, int *ptx);
+void term(struct compiler *ctx, symset fsys, int *ptx);
+void condition(struct compiler *ctx, symset fsys, int *ptx);
+void expression(struct compiler *ctx, symset fsys, int *ptx);
+void call_handle(struct compiler *ctx, int pos);
+void statement(struct compiler *ctx, symset fsys, int *ptx, int *pdx);
+void listcode(struct compiler *ctx, int cx0);
+void listall(struct compiler *ctx);
+int position(struct compiler *ctx, char *idt, int tx);
+int enter(struct compiler *ctx, enum object k, int *ptx, int *pdx);
+
+#endif /* L25_H */
@@ -0,0 +1,165 @@
+/*
+ * l25Api.c
+ * 嵌入用的库接口，见 l25api.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "l25.h"
+#include "l25api.h"
+
+_Static_assert(L25_OK == vm_ok && L25_EDIVZERO == vm_divzero && L25_ENOINPUT == vm_noinput &&
+				   L25_EOVERFLOW == vm_overflow && L25_ENOFUEL == vm_nofuel,
+			   "l25api.h return codes must match enum vmstatus");
+
+struct l25_program
+{
+	int cx;						/* 指令条数 */
+	struct instruction code[];	/* 虚拟机代码 */
+};
+
+int l25_compile(const char *src, size_t len, struct l25_program **prog, struct l25_diag *diag)
+{
+	struct compiler *ctx;
+	struct l25_program *p;
+	int err;
+
+	if (diag)
+		memset(diag, 0, sizeof(*diag));
+	if (prog == NULL || (src == NULL && len > 0))
+		return L25_EINVAL;
+	*prog = NULL;
+	if (len == 0)
+	{
+		if (diag)
+		{
+			diag->count = -1;
+			snprintf(diag->message, sizeof(diag->message), "The input file is empty!");
+		}
+		return L25_ECOMPILE;
+	}
+	if ((ctx = calloc(1, sizeof(struct compiler))) == NULL)
+		return L25_ENOMEM;
+	ctx->src = src;
+	ctx->srclen = len;
+
+	err = compile(ctx);
+	if (err != 0)
+	{
+		if (diag)
+		{
+			diag->count = err;
+			diag->line = ctx->errline;
+			diag->column = ctx->errcol;
+			diag->code = ctx->errcode;
+			if (err < 0 && ctx->fatalmsg)
+				snprintf(diag->message, sizeof(diag->message), "%s", ctx->fatalmsg);
+			else
+				snprintf(diag->message, sizeof(diag->message), "%d errors, first: error %d at line %d column %d",
+						 err, ctx->errcode, ctx->errline, ctx->errcol);
+		}
+		free(ctx);
+		return L25_ECOMPILE;
+	}
+
+	p = malloc(sizeof(struct l25_program) + sizeof(struct instruction) * ctx->cx);
+	if (p == NULL)
+	{
+		free(ctx);
+		return L25_ENOMEM;
+	}
+	p->cx = ctx->cx;
+	memcpy(p->code, ctx->code, sizeof(struct instruction) * ctx->cx);
+	free(ctx);
+	*prog = p;
+	return L25_OK;
+}
+
+/* 没有输入回调时，任何输入都读不到 */
+static int noinput(void *user, int *value)
+{
+	(void)user;
+	(void)value;
+	return -1;
+}
+
+int l25_run(const struct l25_program *prog, const struct l25_io *io, long long fuel)
+{
+	struct vm vm;
+	int status;
+
+	if (prog == NULL)
+		return L25_EINVAL;
+	vminit(&vm, prog->code);
+	vm.input = noinput;
+	if (io)
+	{
+		if (io->input)
+			vm.input = io->input;
+		vm.output = io->output;
+		vm.newline = io->newline;
+		vm.iouser = io->user;
+	}
+	if (fuel > 0)
+		status = vmslice(&vm, -1, fuel, 0);
+	else
+		status = interpret(&vm);
+	vmrelease(&vm); /* 输入不够或超出指令数上限时停在中途，执行中分配的数组等还没有释放 */
+	return status;
+}
+
+int l25_size(const struct l25_program *prog)
+{
+	return prog ? prog->cx : 0;
+}
+
+void l25_free(struct l25_program *prog)
+{
+	free(prog);
+}
+
+const char *vmstatusname(int status)
+{
+	switch (status)
+	{
+	case vm_ok:
+		return "ok";
+	case vm_divzero:
+		return "division by zero";
+	case vm_noinput:
+		return "input exhausted";
+	case vm_overflow:
+		return "stack overflow";
+	case vm_yield:
+		return "preempted";
+	case vm_nofuel:
+		return "instruction limit exceeded";
+	case vm_timeout:
+		return "time limit exceeded";
+	case vm_badjoin:
+		return "invalid join handle";
+	case vm_badnext:
+		return "invalid generator handle";
+	case vm_bounds:
+		return "array index out of bounds";
+	case vm_heap:
+		return "invalid array length or array heap exhausted";
+	}
+	return "unknown error";
+}
+
+const char *l25_strerror(int status)
+{
+	switch (status)
+	{
+	case L25_ECOMPILE:
+		return "compile error";
+	case L25_ENOMEM:
+		return "out of memory";
+	case L25_EINVAL:
+		return "invalid argument";
+	}
+	return vmstatusname(status);
+}
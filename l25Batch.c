@@ -0,0 +1,376 @@
+/*
+ * l25Batch.c
+ * 批量编译：在固定大小的线程池上并行编译大量 l25 源程序
+ *
+ * 使用方法：
+ * l25 -b [-j 线程数] [-o 输出目录] [-t] [-v] 文件|目录|@列表文件 ...
+ * 目录会被递归展开为其中所有的 .l25 文件，@列表文件中每行一个源文件名
+ *
+ * 每个源文件在输出目录下得到各自独立的一组文件，文件名由源文件路径把 '/' 换成 '_' 得到：
+ * <名字>.out.txt    源文件、出错示意和各行对应的生成代码首地址（即 foutput.txt）
+ * <名字>.table.txt  符号表（仅 -t 时有内容，即 ftable.txt）
+ * <名字>.code.txt   虚拟机代码清单（仅编译成功时生成，即 fcode.txt）
+ * <名字>.l25o       二进制目标文件（仅编译成功时生成）
+ * 各文件的输出只取决于其源程序，与线程数和调度顺序无关
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#include "l25.h"
+
+/* 一个待编译的源文件 */
+struct batchjob
+{
+	char *path;	 /* 源文件路径 */
+	int err;	 /* 错误个数，-1 表示无法继续编译，-2 表示无法打开文件 */
+	int cx;		 /* 生成的指令条数 */
+	double msec; /* 编译耗时（毫秒） */
+};
+
+/* 整个批次共享的状态，除 next 外只读 */
+struct batch
+{
+	struct batchjob *jobs;
+	int njobs;
+	atomic_int next; /* 下一个待领取的任务下标 */
+	const char *outdir;
+	bool tableswitch;
+};
+
+static double now_msec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void addjob(struct batchjob **jobs, int *njobs, int *cap, const char *path)
+{
+	if (*njobs == *cap)
+	{
+		*cap = *cap ? *cap * 2 : 64;
+		*jobs = realloc(*jobs, sizeof(struct batchjob) * *cap);
+		if (*jobs == NULL)
+		{
+			printf("Out of memory!\n");
+			exit(1);
+		}
+	}
+	memset(&(*jobs)[*njobs], 0, sizeof(struct batchjob));
+	(*jobs)[*njobs].path = strdup(path);
+	(*njobs)++;
+}
+
+static int cmpstr(const void *x, const void *y)
+{
+	return strcmp(*(char *const *)x, *(char *const *)y);
+}
+
+/*
+ * 递归收集目录中的 .l25 文件，同一目录内按名字排序，保证任务顺序确定
+ */
+static void adddir(struct batchjob **jobs, int *njobs, int *cap, const char *dir)
+{
+	DIR *d = opendir(dir);
+	struct dirent *e;
+	char **names = NULL;
+	int n = 0, ncap = 0, i;
+
+	if (d == NULL)
+	{
+		printf("Can't open directory %s!\n", dir);
+		return;
+	}
+	while ((e = readdir(d)) != NULL)
+	{
+		if (e->d_name[0] == '.')
+			continue;
+		if (n == ncap)
+		{
+			ncap = ncap ? ncap * 2 : 16;
+			names = realloc(names, sizeof(char *) * ncap);
+		}
+		names[n++] = strdup(e->d_name);
+	}
+	closedir(d);
+	qsort(names, n, sizeof(char *), cmpstr);
+
+	for (i = 0; i < n; i++)
+	{
+		char path[4096];
+		struct stat st;
+		size_t len = strlen(names[i]);
+
+		snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+		if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+			adddir(jobs, njobs, cap, path);
+		else if (len > 4 && strcmp(names[i] + len - 4, ".l25") == 0)
+			addjob(jobs, njobs, cap, path);
+		free(names[i]);
+	}
+	free(names);
+}
+
+static void addlist(struct batchjob **jobs, int *njobs, int *cap, const char *list)
+{
+	FILE *f = fopen(list, "r");
+	char line[4096];
+
+	if (f == NULL)
+	{
+		printf("Can't open list file %s!\n", list);
+		return;
+	}
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		line[strcspn(line, "\r\n")] = 0;
+		if (line[0] != 0)
+			addjob(jobs, njobs, cap, line);
+	}
+	fclose(f);
+}
+
+/* 建立输出目录，中间各级目录不存在时一并建立 */
+static int makedirs(const char *dir)
+{
+	char path[4096];
+	char *q;
+
+	snprintf(path, sizeof(path), "%s", dir);
+	for (q = path + 1; *q; q++)
+	{
+		if (*q == '/')
+		{
+			*q = 0;
+			if (mkdir(path, 0777) != 0 && errno != EEXIST)
+				return -1;
+			*q = '/';
+		}
+	}
+	if (mkdir(path, 0777) != 0 && errno != EEXIST)
+		return -1;
+	return 0;
+}
+
+/* 输出文件名：输出目录 + 源文件路径（'/' 换成 '_'）+ 后缀 */
+static void outname(char *buf, size_t size, const struct batch *bt, const char *path, const char *suffix)
+{
+	int n;
+	char *q;
+
+	while (strncmp(path, "./", 2) == 0)
+		path += 2;
+	n = snprintf(buf, size, "%s/", bt->outdir);
+	snprintf(buf + n, size - n, "%s%s", path, suffix);
+	for (q = buf + n; *q; q++)
+	{
+		if (*q == '/')
+			*q = '_';
+	}
+}
+
+/*
+ * 编译一个源文件，所有状态都在本线程的 ctx 中
+ */
+static void compileone(const struct batch *bt, struct batchjob *job, struct compiler *ctx)
+{
+	char name[4096];
+	double start = now_msec();
+
+	memset(ctx, 0, offsetof(struct compiler, code)); /* 大数组不必清零 */
+	ctx->tableswitch = bt->tableswitch;
+	ctx->listswitch = true;
+
+	if ((ctx->fin = fopen(job->path, "r")) == NULL)
+	{
+		job->err = -2;
+		return;
+	}
+	outname(name, sizeof(name), bt, job->path, ".out.txt");
+	ctx->foutput = fopen(name, "w");
+	outname(name, sizeof(name), bt, job->path, ".table.txt");
+	ctx->ftable = fopen(name, "w");
+	if (ctx->foutput == NULL || ctx->ftable == NULL)
+	{
+		job->err = -2;
+		goto done;
+	}
+
+	if (fgetc(ctx->fin) == EOF)
+	{
+		fprintf(ctx->foutput, "The input file is empty!\n");
+		job->err = -1;
+		goto done;
+	}
+	rewind(ctx->fin);
+
+	job->err = compile(ctx);
+	job->cx = ctx->cx;
+	if (job->err == 0)
+	{
+		FILE *fobj;
+
+		fprintf(ctx->foutput, "\n===Parsing success!===\n");
+		outname(name, sizeof(name), bt, job->path, ".code.txt");
+		if ((ctx->fcode = fopen(name, "w")) != NULL)
+		{
+			listall(ctx);
+			fclose(ctx->fcode);
+		}
+		outname(name, sizeof(name), bt, job->path, ".l25o");
+		if ((fobj = fopen(name, "wb")) != NULL)
+		{
+			writeobject(fobj, ctx->code, ctx->cx);
+			fclose(fobj);
+		}
+	}
+	else if (job->err > 0)
+	{
+		fprintf(ctx->foutput, "\n%d errors in l25 program!\n", job->err);
+	}
+
+done:
+	if (ctx->foutput)
+		fclose(ctx->foutput);
+	if (ctx->ftable)
+		fclose(ctx->ftable);
+	fclose(ctx->fin);
+	job->msec = now_msec() - start;
+}
+
+static void *worker(void *arg)
+{
+	struct batch *bt = arg;
+	struct compiler *ctx = malloc(sizeof(struct compiler));
+	int i;
+
+	if (ctx == NULL)
+		return NULL;
+	while ((i = atomic_fetch_add(&bt->next, 1)) < bt->njobs)
+	{
+		compileone(bt, &bt->jobs[i], ctx);
+	}
+	free(ctx);
+	return NULL;
+}
+
+static int cmpdouble(const void *x, const void *y)
+{
+	double a = *(const double *)x, b = *(const double *)y;
+	return (a > b) - (a < b);
+}
+
+/* 最近秩法求百分位数，v 已升序排列 */
+static double percentile(const double *v, int n, double pct)
+{
+	int r = (int)(pct / 100.0 * n + 0.999999);
+	if (r < 1)
+		r = 1;
+	if (r > n)
+		r = n;
+	return v[r - 1];
+}
+
+int batch_main(int argc, char **argv)
+{
+	struct batch bt;
+	struct batchjob *jobs = NULL;
+	int njobs = 0, cap = 0;
+	int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	bool verbose = false;
+	pthread_t *tids;
+	double start, wall, *lat;
+	int i, nok = 0;
+
+	memset(&bt, 0, sizeof(bt));
+	bt.outdir = "l25out";
+
+	for (i = 1; i < argc; i++)
+	{
+		struct stat st;
+
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			nthreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			bt.outdir = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0)
+			bt.tableswitch = true;
+		else if (strcmp(argv[i], "-v") == 0)
+			verbose = true;
+		else if (argv[i][0] == '@')
+			addlist(&jobs, &njobs, &cap, argv[i] + 1);
+		else if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode))
+			adddir(&jobs, &njobs, &cap, argv[i]);
+		else
+			addjob(&jobs, &njobs, &cap, argv[i]);
+	}
+	if (njobs == 0)
+	{
+		printf("usage: l25 -b [-j threads] [-o outdir] [-t] [-v] file|dir|@list ...\n");
+		return 1;
+	}
+	if (nthreads < 1)
+		nthreads = 1;
+	if (nthreads > njobs)
+		nthreads = njobs;
+	if (makedirs(bt.outdir) != 0)
+	{
+		printf("Can't create output directory %s!\n", bt.outdir);
+		return 1;
+	}
+
+	bt.jobs = jobs;
+	bt.njobs = njobs;
+	atomic_init(&bt.next, 0);
+	tids = malloc(sizeof(pthread_t) * nthreads);
+
+	start = now_msec();
+	for (i = 0; i < nthreads; i++)
+		pthread_create(&tids[i], NULL, worker, &bt);
+	for (i = 0; i < nthreads; i++)
+		pthread_join(tids[i], NULL);
+	wall = now_msec() - start;
+
+	/* 按输入顺序报告结果 */
+	lat = malloc(sizeof(double) * njobs);
+	for (i = 0; i < njobs; i++)
+	{
+		struct batchjob *job = &jobs[i];
+
+		lat[i] = job->msec;
+		if (job->err == 0)
+			nok++;
+		if (job->err == -2)
+			printf("FAIL %s: can't open file\n", job->path);
+		else if (job->err == -1)
+			printf("FAIL %s: compilation aborted\n", job->path);
+		else if (job->err > 0)
+			printf("FAIL %s: %d errors\n", job->path, job->err);
+		else if (verbose)
+			printf("OK   %s: %d instructions, %.3f ms\n", job->path, job->cx, job->msec);
+	}
+	qsort(lat, njobs, sizeof(double), cmpdouble);
+
+	printf("\n%d files, %d ok, %d failed, %d threads\n", njobs, nok, njobs - nok, nthreads);
+	printf("wall %.3f ms, %.1f files/sec\n", wall, njobs / (wall / 1e3));
+	printf("latency ms: p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+		   percentile(lat, njobs, 50), percentile(lat, njobs, 90),
+		   percentile(lat, njobs, 99), lat[njobs - 1]);
+
+	for (i = 0; i < njobs; i++)
+		free(jobs[i].path);
+	free(jobs);
+	free(lat);
+	free(tids);
+	return nok == njobs ? 0 : 1;
+}
@@ -0,0 +1,528 @@
+/*
+ * l25Cli.c
+ * 非交互的命令行前端：所有选项都由命令行参数给出，不提示、不读 Y/N
+ *
+ * 使用方法：
+ * l25 [-l] [-t] [-d] [-p] [-i 输入文件] 源程序   编译并执行一次
+ * l25 [-l] [-t] [-p] -r 输入向量文件 源程序      编译一次，对每行输入各执行一次
+ * -l 在标准输出上列出虚拟机代码，-t 列出符号表，-d 每条指令执行后把栈输出到标准错误
+ * -p 剖析执行过程，结束后把各函数、各行和各条指令的统计输出到标准错误（-r 时累计所有运行）
+ * -P 文件 以 -F 给出的频率（默认每秒 1000 次）采样调用栈，按 folded-stack 格式写入文件
+ * -c 用 perf_event_open 统计前端（编译）和每次执行的周期数、指令数、分支预测失败数和 L1d 缺失数，
+ *    输出到标准错误，并给出平均每条虚拟机指令的值；计数器不可用时给出原因后照常运行
+ * -T 文件 把每条指令执行前的 pc、指令、t、b 和栈顶值写入二进制轨迹文件，只保留最后 -N 百万条（默认 1），
+ *    用 l25dump 解码
+ * -R 文件 把 input() 读到的每个值录制成二进制文件（不能与 -r 同用）；-i 给出录制的文件时按录制的顺序重放
+ * -s 文件 结束时把各阶段的墙钟/CPU 时间、符号数、指令数和虚拟机高水位等统计写成 JSON（编译出错时也写）
+ * -C 文件 收到 SIGINT/SIGTERM 时把虚拟机快照写入文件后停止，有 -E 时每执行 -E 百万条指令也写一次（不能与 -r 同用）
+ * -L 文件 从快照继续执行，跳过输入中快照之前已读的部分；-r 时每次运行都从同一个快照开始
+ * -J 线程数 同一表达式中对纯函数的几次调用在线程池中并行执行，只在调用深度不超过 -G（默认 forkdepth）时分叉；
+ *    spawn 的纯函数和 parfor 循环也在线程池中执行。与 -p、-P、-T、-d、-C 同用时顺序执行
+ * -i 的输入文件中是空白分隔的整数，没有 -i 时从标准输入读取
+ * -r 时每次运行前重置虚拟机，每次运行的输出占一行，耗时和指令数输出到标准错误
+ * 编译出错时把源程序清单和出错示意输出到标准错误
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+#include <signal.h>
+
+#include "l25.h"
+
+#define snapslice 1000000 /* 保存快照时每段执行的指令数 */
+
+/* 收到 SIGINT 或 SIGTERM 时置位，执行到下一个让出点时保存快照后停止 */
+static volatile sig_atomic_t stopping;
+
+/* 输入输出回调的状态 */
+struct printer
+{
+	int col;		/* 本行已输出的数据个数 */
+	FILE *record;	/* 录制输入的文件 */
+	const int *in;	/* 录制时的输入来源，为 NULL 时从标准输入读取 */
+	int nin, inpos;
+	int nrec;		/* 已录制的个数 */
+};
+
+static double now_msec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void printvalue(void *user, int value)
+{
+	struct printer *pr = user;
+	printf(pr->col++ ? " %d" : "%d", value);
+}
+
+static void printnewline(void *user)
+{
+	struct printer *pr = user;
+	printf("\n");
+	pr->col = 0;
+}
+
+/* 把一个输入值按 zigzag + LEB128 写入录制文件 */
+static void putvarint(FILE *f, int value)
+{
+	unsigned int u = ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+
+	while (u >= 0x80)
+	{
+		putc((int)(u & 0x7f) | 0x80, f);
+		u >>= 7;
+	}
+	putc((int)u, f);
+}
+
+/* 录制时的输入回调：照常取得输入，同时写入录制文件 */
+static int recordinput(void *user, int *value)
+{
+	struct printer *pr = user;
+
+	if (pr->in)
+	{
+		if (pr->inpos >= pr->nin)
+			return -1;
+		*value = pr->in[pr->inpos++];
+	}
+	else if (scanf("%d", value) != 1)
+		return -1;
+	putvarint(pr->record, *value);
+	pr->nrec++;
+	return 0;
+}
+
+static int cmpdouble(const void *x, const void *y)
+{
+	double a = *(const double *)x, b = *(const double *)y;
+	return (a > b) - (a < b);
+}
+
+static void onstop(int sig)
+{
+	(void)sig;
+	stopping = 1;
+}
+
+/*
+ * 分段执行，每执行 every 条指令（<= 0 表示不定期保存）和收到停止信号时把快照写入 path
+ * 因停止信号保存快照后返回 vm_yield
+ */
+static int runsnapshot(struct vm *vm, int cx, const char *path, long long every)
+{
+	long long next = every > 0 ? vm->steps + every : LLONG_MAX;
+	int status;
+
+	signal(SIGINT, onstop);
+	signal(SIGTERM, onstop);
+	while ((status = vmrun(vm, snapslice)) == vm_yield)
+	{
+		if (!stopping && vm->steps < next)
+			continue;
+		if (snap_save(path, vm, cx) != 0)
+			fprintf(stderr, "Can't write the snapshot %s!\n", path);
+		else
+			fprintf(stderr, "snapshot after %lld instructions written to %s\n", vm->steps, path);
+		if (stopping)
+			break;
+		next = vm->steps + every;
+	}
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	return status;
+}
+
+/* 编译出错时把 foutput 中的清单转到标准错误 */
+static void copyout(FILE *f)
+{
+	char buf[4096];
+	size_t n;
+
+	rewind(f);
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		fwrite(buf, 1, n, stderr);
+}
+
+/*
+ * 编译一次，对 inputs 中的每个输入向量各执行一次；start 不为 NULL 时每次都从这个恢复好的虚拟机开始
+ */
+static int runrepeat(const struct instruction *code, const struct vm *start, struct profile *prof,
+					 struct sampler *smp, struct tracer *trace, struct parallel *par, struct jobstats *js,
+					 struct perfctr *pc, int **inputs, int *ninputs, int nlines)
+{
+	static struct vm vm;
+	struct printer pr;
+	double *lat = malloc(sizeof(double) * (nlines > 0 ? nlines : 1));
+	double total = 0;
+	long long ctr[perfevents], sum[perfevents] = {0}, steps = 0;
+	int i, nfail = 0;
+
+	for (i = 0; i < nlines; i++)
+	{
+		double t0;
+		int status;
+		long long ran; /* 这次运行执行的指令数，不含快照之前的部分 */
+
+		if (start)
+			memcpy(&vm, start, sizeof(vm)); /* 复制快照，不必重新执行快照之前的部分 */
+		else
+			vminit(&vm, code); /* 每次运行前重置虚拟机 */
+		vm.in = inputs[i];
+		vm.nin = ninputs[i];
+		vm.output = printvalue;
+		vm.iouser = &pr;
+		vm.prof = prof;
+		vm.sampler = smp;
+		vm.trace = trace;
+		vm.par = par;
+		pr.col = 0;
+		if (js)
+			phase_begin(&js->exec);
+		if (pc)
+			perf_start(pc);
+		t0 = now_msec();
+		status = interpret(&vm);
+		lat[i] = now_msec() - t0;
+		ran = vm.steps - (start ? start->steps : 0);
+		if (pc)
+			perf_stop(pc, ctr);
+		if (js)
+		{
+			phase_end(&js->exec);
+			stats_ran(js, &vm, status);
+		}
+		total += lat[i];
+		if (status != vm_ok)
+		{
+			printf("%s[%s]", pr.col ? " " : "", vmstatusname(status));
+			nfail++;
+		}
+		printf("\n");
+		fprintf(stderr, "run %d: %.4f ms, %lld instructions%s%s\n", i + 1, lat[i], ran,
+				status != vm_ok ? ", " : "", status != vm_ok ? vmstatusname(status) : "");
+		if (pc)
+		{
+			perf_report(stderr, "  counters", ctr, ran);
+			perf_add(sum, ctr);
+			steps += ran;
+		}
+	}
+	if (nlines > 0)
+	{
+		qsort(lat, nlines, sizeof(double), cmpdouble);
+		fprintf(stderr, "%d runs, %d failed, total %.3f ms, mean %.4f ms\n",
+				nlines, nfail, total, total / nlines);
+		fprintf(stderr, "latency ms: min %.4f  p50 %.4f  p99 %.4f  max %.4f\n",
+				lat[0], lat[nlines / 2], lat[(int)(nlines * 0.99)], lat[nlines - 1]);
+		if (pc)
+			perf_report(stderr, "all runs", sum, steps);
+	}
+	free(lat);
+	return nfail == 0 ? 0 : 1;
+}
+
+int cli_main(int argc, char **argv)
+{
+	static struct compiler ctx; /* 上下文较大，不放在栈上 */
+	static struct vm vm;
+	const char *srcpath = NULL, *inpath = NULL, *vecpath = NULL, *foldpath = NULL, *statspath = NULL;
+	const char *tracepath = NULL, *recpath = NULL, *snappath = NULL, *resumepath = NULL;
+	double tracemillions = 1, snapmillions = 0;
+	static struct vm start; /* 从快照恢复的虚拟机 */
+	struct tracer *trace = NULL;
+	static struct jobstats js;
+	struct perfctr perf, *pc = NULL;
+	long long ctr[perfevents];
+	bool listing = false, table = false, dump = false, profiling = false, counters = false, bad = false;
+	struct profile *prof = NULL;
+	struct sampler *smp = NULL;
+	struct wspool *pool = NULL;
+	struct parallel *par = NULL;
+	int hz = 1000, threads = 1, cutoff = forkdepth;
+	int **inputs = NULL, *ninputs = NULL, nlines = 0;
+	int i, err, status, ret;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-l") == 0)
+			listing = true;
+		else if (strcmp(argv[i], "-t") == 0)
+			table = true;
+		else if (strcmp(argv[i], "-d") == 0)
+			dump = true;
+		else if (strcmp(argv[i], "-p") == 0)
+			profiling = true;
+		else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc)
+			foldpath = argv[++i];
+		else if (strcmp(argv[i], "-c") == 0)
+			counters = true;
+		else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc)
+			tracepath = argv[++i];
+		else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc)
+			tracemillions = atof(argv[++i]);
+		else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc)
+			recpath = argv[++i];
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			statspath = argv[++i];
+		else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc)
+			snappath = argv[++i];
+		else if (strcmp(argv[i], "-E") == 0 && i + 1 < argc)
+			snapmillions = atof(argv[++i]);
+		else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc)
+			resumepath = argv[++i];
+		else if (strcmp(argv[i], "-J") == 0 && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-G") == 0 && i + 1 < argc)
+			cutoff = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc)
+			hz = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+			inpath = argv[++i];
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			vecpath = argv[++i];
+		else if (argv[i][0] != '-' && srcpath == NULL)
+			srcpath = argv[i];
+		else
+			bad = true;
+	}
+	if (bad || srcpath == NULL || (inpath && vecpath) || (recpath && vecpath) || (snappath && vecpath))
+	{
+		fprintf(stderr, "usage: l25 [-l] [-t] [-d] [-p] [-c] [-P folded-out [-F hz]] [-T trace [-N millions]] [-s stats.json] [-R record] [-C snapshot [-E millions]] [-L snapshot] [-J threads [-G depth]] [-i inputs | -r input-vectors] program.l25\n");
+		return 1;
+	}
+	if (inpath || vecpath)
+	{
+		if ((nlines = readinputs(inpath ? inpath : vecpath, &inputs, &ninputs)) < 0)
+		{
+			fprintf(stderr, "Can't open the input file %s!\n", inpath ? inpath : vecpath);
+			return 1;
+		}
+	}
+
+	if ((ctx.fin = fopen(srcpath, "r")) == NULL)
+	{
+		fprintf(stderr, "Can't open the source file %s!\n", srcpath);
+		return 1;
+	}
+	if (fgetc(ctx.fin) == EOF)
+	{
+		fprintf(stderr, "The input file is empty!\n");
+		fclose(ctx.fin);
+		return 1;
+	}
+	rewind(ctx.fin);
+	ctx.listswitch = listing;
+	ctx.tableswitch = table;
+	ctx.foutput = tmpfile(); /* 只在出错时输出 */
+	ctx.ftable = table ? stdout : NULL;
+	if (counters)
+	{
+		if (perf_open(&perf) < 0)
+			fprintf(stderr, "Hardware counters unavailable: %s\n", perf.why);
+		else
+			pc = &perf;
+	}
+	ctx.stats = statspath ? &js.comp : NULL;
+	phase_begin(&js.compile);
+	if (pc)
+		perf_start(pc);
+	err = compile(&ctx);
+	if (pc)
+	{
+		perf_stop(pc, ctr);
+		perf_report(stderr, "front end", ctr, 0);
+	}
+	phase_end(&js.compile);
+	stats_compiled(&js, &ctx, err);
+	fclose(ctx.fin);
+	if (err != 0)
+	{
+		if (ctx.foutput)
+		{
+			copyout(ctx.foutput);
+			fclose(ctx.foutput);
+		}
+		if (err > 0)
+			fprintf(stderr, "\n%d errors in l25 program!\n", err);
+		ret = 1;
+		goto done;
+	}
+	if (ctx.foutput)
+		fclose(ctx.foutput);
+	if (listing)
+	{
+		ctx.fcode = stdout;
+		phase_begin(&js.list);
+		listall(&ctx);
+		phase_end(&js.list);
+	}
+
+	if (resumepath)
+	{
+		vminit(&start, ctx.code);
+		if ((err = snap_load(resumepath, &start, ctx.cx)) != 0)
+		{
+			fprintf(stderr, err == -2 ? "%s was not saved from %s (code image differs)!\n" : "%s is not a snapshot!\n",
+					resumepath, srcpath);
+			ret = 1;
+			goto done;
+		}
+	}
+	if (profiling)
+		prof = prof_create(ctx.cx);
+	if (foldpath)
+	{
+		smp = sampler_create(&ctx);
+		if (sampler_start(smp, hz) != 0)
+			fprintf(stderr, "Can't start the profiling timer!\n");
+	}
+	if (tracepath)
+	{
+		long long cap = (long long)(tracemillions * 1e6);
+		if ((trace = trace_create(tracepath, cap > 0 ? cap : 1, ctx.code, ctx.cx)) == NULL)
+			fprintf(stderr, "Can't create the trace file %s!\n", tracepath);
+	}
+	if (threads > 1)
+	{ /* 调用 interpret() 的线程也执行子任务 */
+		pool = wspool_create(threads - 1);
+		par = par_create(ctx.code, ctx.cx, pool, cutoff);
+	}
+	if (vecpath)
+	{
+		ret = runrepeat(ctx.code, resumepath ? &start : NULL, prof, smp, trace, par, statspath ? &js : NULL, pc,
+						inputs, ninputs, nlines);
+	}
+	else
+	{
+		struct printer pr = {0};
+		int *in = NULL, nin = 0;
+
+		/* -i 的输入文件中所有行的整数连成一个输入序列 */
+		for (i = 0; i < nlines; i++)
+		{
+			in = realloc(in, sizeof(int) * (nin + ninputs[i] + 1));
+			memcpy(in + nin, inputs[i], sizeof(int) * ninputs[i]);
+			nin += ninputs[i];
+		}
+		if (resumepath)
+			memcpy(&vm, &start, sizeof(vm));
+		else
+			vminit(&vm, ctx.code);
+		if (inpath)
+		{
+			vm.in = in ? in : (int[]){0};
+			vm.nin = nin;
+		}
+		if (recpath)
+		{
+			unsigned int head[2] = {L25I_MAGIC, L25I_VERSION};
+
+			if ((pr.record = fopen(recpath, "wb")) == NULL)
+			{
+				fprintf(stderr, "Can't open %s!\n", recpath);
+				ret = 1;
+				free(in);
+				goto done;
+			}
+			fwrite(head, sizeof(unsigned int), 2, pr.record);
+			pr.in = vm.in;
+			pr.nin = vm.nin;
+			pr.inpos = vm.inpos;
+			vm.in = NULL;
+			vm.input = recordinput;
+		}
+		if (resumepath && vm.in == NULL && pr.in == NULL)
+		{ /* 从标准输入读时丢弃快照之前已读的输入 */
+			for (i = 0; i < vm.inpos && scanf("%*d") != EOF; i++)
+				;
+		}
+		vm.output = printvalue;
+		vm.newline = printnewline;
+		vm.iouser = &pr;
+		vm.prof = prof;
+		vm.sampler = smp;
+		vm.trace = trace;
+		vm.par = par;
+		if (dump)
+		{
+			vm.stackswitch = true;
+			vm.fresult = stderr;
+		}
+		phase_begin(&js.exec);
+		if (pc)
+			perf_start(pc);
+		status = snappath ? runsnapshot(&vm, ctx.cx, snappath, (long long)(snapmillions * 1e6)) : interpret(&vm);
+		if (pc)
+			perf_stop(pc, ctr);
+		phase_end(&js.exec);
+		stats_ran(&js, &vm, status);
+		if (pr.col > 0)
+			printf("\n");
+		if (status == vm_yield)
+			fprintf(stderr, "Stopped after %lld instructions, continue with -L %s\n", vm.steps, snappath);
+		else if (status != vm_ok)
+			fprintf(stderr, "Runtime error: %s at instruction %d\n", vmstatusname(status), vm.p);
+		if (pc)
+		{
+			fflush(stdout);
+			perf_report(stderr, "exec", ctr, vm.steps - (resumepath ? start.steps : 0)); /* 计数器只统计这个进程 */
+		}
+		ret = status == vm_ok ? 0 : 1;
+		if (pr.record)
+		{
+			fprintf(stderr, "%d inputs recorded to %s\n", pr.nrec, recpath);
+			fclose(pr.record);
+		}
+		free(in);
+	}
+	if (par)
+	{
+		fprintf(stderr, "%lld calls forked, %lld spawned, %lld parfor chunks on %d threads, %lld redone sequentially\n",
+				(long long)par->forks, (long long)par->spawned, (long long)par->chunks, threads, (long long)par->redone);
+		par_destroy(par);
+		wspool_destroy(pool);
+	}
+	if (trace)
+	{
+		fprintf(stderr, "%llu instructions traced to %s\n", trace->n, tracepath);
+		trace_close(trace);
+	}
+	if (smp)
+	{
+		FILE *ffold;
+
+		sampler_stop(smp);
+		if ((ffold = fopen(foldpath, "w")) != NULL)
+		{
+			sampler_write(ffold, smp);
+			fclose(ffold);
+		}
+		else
+			fprintf(stderr, "Can't open %s!\n", foldpath);
+		fprintf(stderr, "%d samples written to %s\n", smp->nsamples, foldpath);
+		sampler_destroy(smp);
+	}
+	if (prof)
+	{
+		fflush(stdout);
+		prof_report(stderr, &ctx, prof, srcpath);
+		prof_destroy(prof);
+	}
+
+done:
+	if (pc)
+		perf_close(pc);
+	if (statspath && stats_write(statspath, &js) != 0)
+		fprintf(stderr, "Can't write %s!\n", statspath);
+	for (i = 0; i < nlines; i++)
+		free(inputs[i]);
+	free(inputs);
+	free(ninputs);
+	return ret;
+}
@@ -1,1765 +1,2946 @@
-/*
- * l25 complier program implemented in C
- * PL/0编译器（完整版本）
- * The program has been tested on Visual Studio 2022
- *
- * 使用方法：
- * 运行后输入l25源程序文件名
- * 回答是否输出虚拟机代码
- * 回答是否输出符号表
- * fcode.txt输出虚拟机代码
- * foutput.txt输出源文件、出错示意（如有错）和各行对应的生成代码首地址（如无错）
- * fresult.txt输出运行结果
- * ftable.txt输出符号表
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-#define bool int
-#define true 1
-#define false 0
-
-#define norw 12			 /* 保留字个数 */
-#define txmax 100		 /* 符号表容量 */
-#define nmax 14			 /* 数字的最大位数 */
-#define al 10			 /* 标识符的最大长度 */
-#define maxerr 30		 /* 允许的最多错误数 */
-#define amax 0xfffffffff /* 地址上界*/
-#define cxmax 200		 /* 最多的虚拟机代码数 */
-#define stacksize 500	 /* 运行时数据栈元素最多为500个 */
-
-/* 符号 */
-enum symbol
-{
-	nul,	   // 空
-	ident,	   // 标识符
-	number,	   // 数字
-	plus,	   // 加法 +
-	minus,	   // 减法 -
-	times,	   // 乘法 *
-	slash,	   // 除法 /
-	eql,	   // 等于 ==
-	neq,	   // 不等于 !=
-	lss,	   // 小于 <
-	leq,	   // 小于等于 <=
-	gtr,	   // 大于 >
-	geq,	   // 大于等于 >=
-	lparen,	   // 左括号 (
-	rparen,	   // 右括号 )
-	lbrace,	   // 左大括号 {
-	rbrace,	   // 右大括号 }
-	comma,	   // 逗号 ,
-	semicolon, // 分号 ;
-	period,	   // 结束符 .
-	becomes,   // 赋值 =
-	elsesym,   // 否则 "else"
-	funcsym,   // 函数 "function"
-	ifsym,	   // 判断 "if"
-	inputsym,  // 输入 "input"
-	letsym,	   // 声明 "let"
-	mainsym,   // 函数 "main"
-	outputsym, // 输出 "output"
-	progsym,   // 程序 "program"
-	returnsym, // 返回 "return"
-	whilesym,  // 循环 "while"
-	trysym,	   // 异常处理 "try"
-	catchsym   // 异常处理 "catch"
-};
-#define symnum 33
-
-/* 符号表中的类型 */
-enum object
-{
-	variable,
-	param,
-	function,
-};
-
-/* 虚拟机代码指令 */
-enum fct
-{
-	lit,
-	opr,
-	lod,
-	sto,
-	cal,
-	ini,
-	jmp,
-	jpc,
-};
-#define fctnum 8
-
-/* 虚拟机代码结构 */
-struct instruction
-{
-	enum fct f; /* 虚拟机代码指令 */
-	int a;		/* 根据f的不同而不同 */
-};
-
-bool listswitch;  /* 显示虚拟机代码与否 */
-bool tableswitch; /* 显示符号表与否 */
-char ch;		  /* 存放当前读取的字符，getch 使用 */
-enum symbol sym;  /* 当前的符号 */
-char id[al + 1];  /* 当前ident，多出的一个字节用于存放0 */
-int num;		  /* 当前number */
-int cc, ll;		  /* getch使用的计数器，cc表示当前字符(ch)的位置 */
-int cx;			  /* 虚拟机代码指针, 取值范围[0, cxmax-1]*/
-int tx;			  /* 当前符号表尾，0 表示仅有哨兵 */
-int dx;
-int curFuncIdx = -1;
-char line[81];					/* 读取行缓冲区 */
-char a[al + 1];					/* 临时符号，多出的一个字节用于存放0 */
-struct instruction code[cxmax]; /* 存放虚拟机代码的数组 */
-char word[norw][al];			/* 保留字 */
-enum symbol wsym[norw];			/* 保留字对应的符号值 */
-enum symbol ssym[256];			/* 单字符的符号值 */
-char mnemonic[fctnum][5];		/* 虚拟机代码指令名称 */
-bool declbegsys[symnum];		/* 表示声明开始的符号集合 */
-bool statbegsys[symnum];		/* 表示语句开始的符号集合 */
-bool facbegsys[symnum];			/* 表示因子开始的符号集合 */
-
-/* 符号表结构 */
-struct tablestruct
-{
-	char name[al];	  /* 名字 */
-	enum object kind; /* 类型：const，var或procedure */
-	int adr;		  /* 地址，仅const不使用 */
-	int size;		  /* 需要分配的数据区空间, 仅procedure使用 */
-	int paramCnt;	  /* 函数形参个数           */
-	unsigned attr;	  /* 位标志：bit0=isParam…  */
-};
-
-struct tablestruct table[txmax]; /* 符号表 */
-
-FILE *fin;	   /* 输入源文件 */
-FILE *ftable;  /* 输出符号表 */
-FILE *fcode;   /* 输出虚拟机代码 */
-FILE *foutput; /* 输出文件及出错示意（如有错）、各行对应的生成代码首地址（如无错） */
-FILE *fresult; /* 输出执行结果 */
-char fname[al];
-int err; /* 错误计数器 */
-
-void error(int n);
-void getsym();
-void getch();
-void init();
-void gen(enum fct x, int z);
-void test(bool *s1, bool *s2, int n);
-int inset(int e, bool *s);
-int addset(bool *sr, bool *s1, bool *s2, int n);
-int subset(bool *sr, bool *s1, bool *s2, int n);
-int mulset(bool *sr, bool *s1, bool *s2, int n);
-void program(bool *fsys); /* 顶层 */
-void parse_function_header(bool *fsys);
-void block(int *ptx, bool *fsys, int isFunc, int *retParamCnt);
-void interpret();
-void factor(bool *fsys, int *ptx);
-void term(bool *fsys, int *ptx);
-void condition(bool *fsys, int *ptx);
-void expression(bool *fsys, int *ptx);
-void call_handle(int pos);
-void statement(bool *fsys, int *ptx, int *pdx);
-void listcode(int cx0);
-void listall();
-int position(char *idt, int tx);
-int enter(enum object k, int *ptx, int *pdx);
-
-/* 主程序开始 */
-int main()
-{
-	bool nxtlev[symnum];
-
-	printf("Input l25 file?   ");
-	scanf("%s", fname); /* 输入文件名 */
-
-	if ((fin = fopen(fname, "r")) == NULL)
-	{
-		printf("Can't open the input file!\n");
-		exit(1);
-	}
-
-	ch = fgetc(fin);
-	if (ch == EOF)
-	{
-		printf("The input file is empty!\n");
-		fclose(fin);
-		exit(1);
-	}
-	rewind(fin);
-
-	if ((foutput = fopen("foutput.txt", "w")) == NULL)
-	{
-		printf("Can't open the output file!\n");
-		exit(1);
-	}
-
-	if ((ftable = fopen("ftable.txt", "w")) == NULL)
-	{
-		printf("Can't open ftable.txt file!\n");
-		exit(1);
-	}
-
-	printf("List object codes?(Y/N)"); /* 是否输出虚拟机代码 */
-	scanf("%s", fname);
-	listswitch = (fname[0] == 'y' || fname[0] == 'Y');
-
-	printf("List symbol table?(Y/N)"); /* 是否输出符号表 */
-	scanf("%s", fname);
-	tableswitch = (fname[0] == 'y' || fname[0] == 'Y');
-
-	init(); /* 初始化 */
-	err = 0;
-	cc = ll = cx = 0;
-	ch = ' ';
-	tx = 0;
-	cx = 0; /* 代码计数器 */
-
-	getsym();
-
-	addset(nxtlev, declbegsys, statbegsys, symnum);
-	program(nxtlev); /* ← 取代原 block(...) */
-
-	if (err == 0)
-	{
-		printf("\n===Parsing success!===\n");
-		fprintf(foutput, "\n===Parsing success!===\n");
-
-		if ((fcode = fopen("fcode.txt", "w")) == NULL)
-		{
-			printf("Can't open fcode.txt file!\n");
-			exit(1);
-		}
-
-		if ((fresult = fopen("fresult.txt", "w")) == NULL)
-		{
-			printf("Can't open fresult.txt file!\n");
-			exit(1);
-		}
-
-		listall(); /* 输出所有代码 */
-		fclose(fcode);
-
-		interpret(); /* 调用解释执行程序 */
-		fclose(fresult);
-	}
-	else
-	{
-		printf("\n%d errors in l25 program!\n", err);
-		fprintf(foutput, "\n%d errors in l25 program!\n", err);
-	}
-
-	fclose(ftable);
-	fclose(foutput);
-	fclose(fin);
-
-	return 0;
-}
-
-/*
- * 初始化
- */
-void init()
-{
-	int i;
-
-	/* 设置单字符符号 */
-	for (i = 0; i <= 255; i++)
-	{
-		ssym[i] = nul;
-	}
-	ssym['+'] = plus;
-	ssym['-'] = minus;
-	ssym['*'] = times;
-	ssym['/'] = slash;
-	ssym['('] = lparen;
-	ssym[')'] = rparen;
-	ssym['{'] = lbrace;
-	ssym['}'] = rbrace;
-	ssym[','] = comma;
-	ssym['.'] = period;
-	ssym[';'] = semicolon;
-
-	/* 设置保留字名字,按照字母顺序，便于二分查找 */
-	strcpy(word[0], "catch");
-	wsym[0] = catchsym;
-	strcpy(word[1], "else");
-	wsym[1] = elsesym;
-	strcpy(word[2], "func");
-	wsym[2] = funcsym;
-	strcpy(word[3], "if");
-	wsym[3] = ifsym;
-	strcpy(word[4], "input");
-	wsym[4] = inputsym;
-	strcpy(word[5], "let");
-	wsym[5] = letsym;
-	strcpy(word[6], "main");
-	wsym[6] = mainsym;
-	strcpy(word[7], "output");
-	wsym[7] = outputsym;
-	strcpy(word[8], "program");
-	wsym[8] = progsym;
-	strcpy(word[9], "return");
-	wsym[9] = returnsym;
-	strcpy(word[10], "try");
-	wsym[10] = trysym;
-	strcpy(word[11], "while");
-	wsym[11] = whilesym;
-
-	/* 设置指令名称 */
-	strcpy(&(mnemonic[lit][0]), "lit");
-	strcpy(&(mnemonic[opr][0]), "opr");
-	strcpy(&(mnemonic[lod][0]), "lod");
-	strcpy(&(mnemonic[sto][0]), "sto");
-	strcpy(&(mnemonic[cal][0]), "cal");
-	strcpy(&(mnemonic[ini][0]), "int");
-	strcpy(&(mnemonic[jmp][0]), "jmp");
-	strcpy(&(mnemonic[jpc][0]), "jpc");
-
-	/* 设置符号集 */
-	for (i = 0; i < symnum; i++)
-	{
-		declbegsys[i] = false;
-		statbegsys[i] = false;
-		facbegsys[i] = false;
-	}
-
-	/* 设置声明开始符号集 */
-	declbegsys[funcsym] = true;
-
-	/* 设置语句开始符号集 */
-	statbegsys[inputsym] = true;
-	statbegsys[outputsym] = true;
-	statbegsys[ifsym] = true;
-	statbegsys[whilesym] = true;
-	statbegsys[letsym] = true;
-	statbegsys[ident] = true;
-	statbegsys[trysym] = true;
-
-	/* 设置因子开始符号集 */
-	facbegsys[ident] = true;
-	facbegsys[number] = true;
-	facbegsys[lparen] = true;
-}
-
-/*
- * 用数组实现集合的集合运算
- */
-int inset(int e, bool *s)
-{
-	return s[e];
-}
-
-int addset(bool *sr, bool *s1, bool *s2, int n)
-{
-	int i;
-	for (i = 0; i < n; i++)
-	{
-		sr[i] = s1[i] || s2[i];
-	}
-	return 0;
-}
-
-int subset(bool *sr, bool *s1, bool *s2, int n)
-{
-	int i;
-	for (i = 0; i < n; i++)
-	{
-		sr[i] = s1[i] && (!s2[i]);
-	}
-	return 0;
-}
-
-int mulset(bool *sr, bool *s1, bool *s2, int n)
-{
-	int i;
-	for (i = 0; i < n; i++)
-	{
-		sr[i] = s1[i] && s2[i];
-	}
-	return 0;
-}
-
-/*
- *	出错处理，打印出错位置和错误编码
- */
-void error(int n)
-{
-	char space[81];
-	memset(space, 32, 81);
-
-	space[cc - 1] = 0; /* 出错时当前符号已经读完，所以cc-1 */
-
-	printf("**%s^%d\n", space, n);
-	fprintf(foutput, "**%s^%d\n", space, n);
-
-	err = err + 1;
-	if (err > maxerr)
-	{
-		exit(1);
-	}
-}
-
-/*
- * 过滤空格，读取一个字符
- * 每次读一行，存入line缓冲区，line被getsym取空后再读一行
- * 被函数getsym调用
- */
-void getch()
-{
-	if (cc == ll) /* 判断缓冲区中是否有字符，若无字符，则读入下一行字符到缓冲区中 */
-	{
-		if (feof(fin))
-		{
-			ch = EOF; /* 交由 getsym() 把 sym 设成 nul */
-			return;
-		}
-		ll = 0;
-		cc = 0;
-		printf("%d ", cx);
-		fprintf(foutput, "%d ", cx);
-		ch = ' ';
-		while (ch != 10)
-		{
-			if (EOF == fscanf(fin, "%c", &ch))
-			{
-				line[ll] = 0;
-				break;
-			}
-
-			printf("%c", ch);
-			fprintf(foutput, "%c", ch);
-			line[ll] = ch;
-			ll++;
-		}
-	}
-	ch = line[cc];
-	cc++;
-}
-
-/*
- * 词法分析，获取一个符号
- */
-void getsym()
-{
-	int i, j, k;
-
-	while (ch == ' ' || ch == 10 || ch == 9) /* 过滤空格、换行和制表符 */
-	{
-		getch();
-	}
-	if (ch == EOF)
-	{
-		sym = nul;
-		return;
-	}
-	if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z')) /* 当前的单词是标识符或是保留字 */
-	{
-		k = 0;
-		do
-		{
-			if (k < al)
-			{
-				a[k] = ch;
-				k++;
-			}
-			getch();
-		} while ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9'));
-		a[k] = 0;
-		strcpy(id, a);
-		i = 0;
-		j = norw - 1;
-		do
-		{ /* 搜索当前单词是否为保留字，使用二分法查找 */
-			k = (i + j) / 2;
-			if (strcmp(id, word[k]) <= 0)
-			{
-				j = k - 1;
-			}
-			if (strcmp(id, word[k]) >= 0)
-			{
-				i = k + 1;
-			}
-		} while (i <= j);
-		if (i - 1 > j) /* 当前的单词是保留字 */
-		{
-			sym = wsym[k];
-		}
-		else /* 当前的单词是标识符 */
-		{
-			sym = ident;
-		}
-	}
-	else
-	{
-		if (ch >= '0' && ch <= '9') /* 当前的单词是数字 */
-		{
-			k = 0;
-			num = 0;
-			sym = number;
-			do
-			{
-				num = 10 * num + ch - '0';
-				k++;
-				getch();
-				;
-			} while (ch >= '0' && ch <= '9'); /* 获取数字的值 */
-			k--;
-			if (k > nmax) /* 数字位数太多 */
-			{
-				error(30);
-			}
-		}
-		else
-		{
-			if (ch == '=') /* 检测赋值符号 */
-			{
-				getch();
-				if (ch == '=')
-				{
-					sym = eql;
-					getch();
-				}
-				else
-				{
-					sym = becomes; /* 赋值符号 */
-				}
-			}
-			else
-			{
-				if (ch == '<') /* 检测小于或小于等于符号 */
-				{
-					getch();
-					if (ch == '=')
-					{
-						sym = leq;
-						getch();
-					}
-					else
-					{
-						sym = lss;
-					}
-				}
-				else
-				{
-					if (ch == '>') /* 检测大于或大于等于符号 */
-					{
-						getch();
-						if (ch == '=')
-						{
-							sym = geq;
-							getch();
-						}
-						else
-						{
-							sym = gtr;
-						}
-					}
-					else
-					{
-						if (ch == '!') /* 检测不等于符号 */
-						{
-							getch();
-							if (ch == '=')
-							{
-								sym = neq;
-								getch();
-							}
-							else
-							{
-								sym = nul;
-								error(30);
-							}
-						}
-						else
-						{
-							sym = ssym[ch]; /* 当符号不满足上述条件时，全部按照单字符符号处理 */
-							if (sym != nul)
-							{
-								getch();
-							}
-						}
-					}
-				}
-			}
-		}
-	}
-}
-
-/*
- * 生成虚拟机代码
- *
- * x: instruction.f;
- * z: instruction.a;
- */
-void gen(enum fct x, int z)
-{
-	if (cx >= cxmax)
-	{
-		printf("Program is too long!\n"); /* 生成的虚拟机代码程序过长 */
-		exit(1);
-	}
-	if (z >= amax)
-	{
-		printf("Displacement address is too big!\n"); /* 地址偏移越界 */
-		exit(1);
-	}
-	code[cx].f = x;
-	code[cx].a = z;
-	cx++;
-}
-
-/*
- * 测试当前符号是否合法
- *
- * 在语法分析程序的入口和出口处调用测试函数test，
- * 检查当前单词进入和退出该语法单位的合法性
- *
- * s1:	需要的单词集合
- * s2:	如果不是需要的单词，在某一出错状态时，
- *      可恢复语法分析继续正常工作的补充单词符号集合
- * n:  	错误号
- */
-void test(bool *s1, bool *s2, int n)
-{
-	if (!inset(sym, s1))
-	{
-		error(n);
-		/* 当检测不通过时，不停获取符号，直到它属于需要的集合或补救的集合 */
-		while ((!inset(sym, s1)) && (!inset(sym, s2)))
-		{
-			getsym();
-		}
-	}
-}
-
-/* <program> ::= program ident '{' { <func_def> } <main_block> '}' '.' */
-void program(bool *fsys)
-{
-	/* program <ident> '{' {function-def} main-block '}' '.' */
-	int cx0;
-	dx = 3;
-
-	if (sym != progsym)
-		error(40);
-	getsym();
-
-	if (sym != ident)
-		error(1); /* 程序名 */
-	getsym();
-
-	if (sym != lbrace)
-		error(23);
-	getsym();
-
-	cx0 = cx;	 /* 保存当前 code 索引 */
-	gen(jmp, 0); /* 先生成一条 jmp 占位，后面回填 */
-
-	/* ---------- 0~多条 function 定义 ---------- */
-	while (sym == funcsym)
-	{
-		bool funcFollow[symnum] = {0};
-		funcFollow[funcsym] = funcFollow[mainsym] = funcFollow[rbrace] = funcFollow[semicolon] = true;
-		parse_function_header(funcFollow); /* ↓ 见第 2 节 */
-	}
-	code[cx0].a = cx;
-
-	/* ---------- main { stmt_list } ---------- */
-	if (sym != mainsym)
-		error(41);
-	getsym();
-	bool topFollow[symnum] = {0};
-	topFollow[rbrace] = topFollow[period] = topFollow[semicolon] = true;
-	block(
-		/* ptx      */ &tx,
-		/* fsys     */ topFollow, /* FOLLOW(program)，含 rbrace/period 即可 */
-		/* isFunc   */ 0,		  /* ★ 不解析 return，不开返回槽 */
-		/* retParamCnt */ NULL);
-
-	if (sym != rbrace)
-		error(24);
-	getsym();
-	if (sym == nul && feof(fin))
-	{
-		/* 什么也不做——正常结束 */}
-		else
-		{
-			error(9);
-		}
-		if (tableswitch) /* 输出符号表 */
-		{
-			for (int i = 1; i <= tx; i++)
-			{
-				switch (table[i].kind)
-				{
-				case param:
-					printf("    %d param %s ", i, table[i].name);
-					printf("adr=%d\n", table[i].adr);
-					fprintf(ftable, "    %d param %s ", i, table[i].name);
-					fprintf(ftable, "adr=%d\n", table[i].adr);
-					break;
-				case variable:
-					printf("    %d var   %s ", i, table[i].name);
-					printf("addr=%d\n", table[i].adr);
-					fprintf(ftable, "    %d var   %s ", i, table[i].name);
-					fprintf(ftable, "ddr=%d\n", table[i].adr);
-					break;
-				case function:
-					printf("    %d func  %s ", i, table[i].name);
-					printf("addr=%d size=%d\n", table[i].adr, table[i].size);
-					fprintf(ftable, "    %d func  %s ", i, table[i].name);
-					fprintf(ftable, "addr=%d size=%d\n", table[i].adr, table[i].size);
-					break;
-				}
-			}
-		}
-		printf("\n");
-		fprintf(ftable, "\n");
-}
-
-/* 已读取到关键字 function */
-void parse_function_header(bool *fsys)
-{
-	getsym(); /* 跳过 'function' */
-
-	if (sym != ident)
-		error(1);
-	curFuncIdx = enter(function, &tx, &dx);
-	getsym(); /* 跳过函数名 */
-
-	table[curFuncIdx].adr = cx + 1;
-
-	/* 保存进入本函数前的 dx 值 */
-	int savedDx = dx;
-	/* 重置 dx 为 3，让函数在自己的作用域内从 3 开始分配 SL/RA/ret-slot */
-	dx = 3;
-
-	int paramCnt = 0; /* ← 只在这里声明一次 */
-
-	/* 直接把 '(' 及后续全部交给 block() */
-	block(&tx, fsys, 1, /* isFunc = 1 → 要解析形参和唯一 return */ &paramCnt); /* 回传形参个数 */
-
-	/* block() 结束后：形参个数和入口地址已准备好 */
-	table[curFuncIdx].paramCnt = paramCnt; /* 写入符号表 */
-	dx = savedDx;
-}
-
-/*
- * 编译程序主体
- *
- * lev:    当前分程序所在层
- * tx:     符号表当前尾指针
- * fsys:   当前模块后继符号集合
- */
-void block(int *ptx, bool *fsys,
-		   int isFunc,		 /* 1 = 函数体, 0 = main/普通块 */
-		   int *retParamCnt) /* 仅 isFunc==1 时才用来回传形参个数 */
-{
-	int tx0 = *ptx; /* 记录本层符号表基准 */
-
-	/* ---------- 1. 只有函数体才预留入口 jmp ---------- */
-	int cx0 = -1; /* 非函数体保持 -1 */
-	if (isFunc)
-	{
-		cx0 = cx;	 /* 记录 jmp 指令下标，稍后回填 */
-		gen(jmp, 0); /* 先占个坑 */
-	}
-
-	/* ---------- 2. 解析形参 (仅 isFunc==1) ---------- */
-	if (isFunc && retParamCnt)
-	{
-		*retParamCnt = 0;
-		if (sym == lparen)
-		{
-			do
-			{
-				getsym(); /* 读标识符 */
-				if (sym != ident)
-					error(1);
-
-				enter(param, ptx, &dx); /* adr = dx++ */
-				(*retParamCnt)++;
-
-				getsym(); /* 读下一个符号 */
-			} while (sym == comma);
-
-			if (sym != rparen)
-				error(22);
-			getsym(); /* 越过 ')' */
-		}
-	}
-
-	/* ---------- 3. 进入 { stmt_list } ---------- */
-	if (sym != lbrace)
-		error(34);
-	getsym(); /* 越过 '{' */
-
-	int ini_pos = cx; /* 记录下这条 ini 指令所在的 code[] 下标 */
-	gen(ini, 0);	  /* 暂时填 0，后续在第 6 步回填成正确的 dx */
-	bool inside[symnum];
-	addset(inside, statbegsys, fsys, symnum);
-	inside[rbrace] = true;	  /* 块结束符 */
-	inside[semicolon] = true; /* 语句间分号 */
-
-	while (inset(sym, statbegsys))
-	{
-		statement(inside, ptx, &dx);
-		if (sym == semicolon)
-			getsym(); /* 可选分号 */
-	}
-
-	/* ---------- 4. 解析唯一 return (仅函数体) ---------- */
-	if (isFunc)
-	{
-		if (sym != returnsym)
-			error(50);
-		getsym();
-
-		bool exprFollow[symnum];
-		addset(exprFollow, facbegsys, fsys, symnum);
-		exprFollow[semicolon] = true; /* ; 跟在表达式后 */
-		expression(exprFollow, ptx);
-		gen(sto, 2);
-		if (sym != semicolon)
-			error(10);
-
-		getsym();
-	}
-
-	/* ---------- 5. 读块结束 '}' ---------- */
-	if (sym != rbrace)
-		error(24);
-	getsym();
-
-	/* ---------- 6. 回填入口 & 生成退出指令 ---------- */
-	if (isFunc)
-	{
-		code[cx0].a = ini_pos; /* jmp 跳到正文首指令 */
-		code[ini_pos].a = dx;  /* +1 给返回值槽 */
-		gen(opr, 18);		   /* return */
-		table[curFuncIdx].size = dx - 3 + 1;
-	}
-	else
-	{
-		code[ini_pos].a = dx;
-		gen(opr, 0); /* 程序或块结束 */
-	}
-}
-
-/*
- * 在符号表中加入一项
- *
- * k:      标识符的种类为const，var或procedure
- * ptx:    符号表尾指针的指针，为了可以改变符号表尾指针的值
- * lev:    标识符所在的层次
- * pdx:    dx为当前应分配的变量的相对地址，分配后要增加1
- *
- */
-int enter(enum object k, int *ptx, int *pdx)
-{
-	if (*ptx + 1 >= txmax)
-	{
-		printf("Symbol table overflow!\n");
-		exit(1);
-	}
-
-	++(*ptx);
-	strcpy(table[*ptx].name, id);
-	table[*ptx].kind = k;
-	table[*ptx].size = 0;
-	table[*ptx].paramCnt = 0;
-	table[*ptx].attr = 0;
-
-	switch (k)
-	{
-	case variable:					/* let 声明 */
-		table[*ptx].adr = (*pdx)++; /* 从 dx 开始递增 */
-		break;
-
-	case param:						/* 形参 */
-		table[*ptx].adr = (*pdx)++; /* 与变量共用地址系 */
-		table[*ptx].attr = 1;		/* bit0 = isParam  */
-		break;
-
-	case function: /* function / main */
-		/* 入口地址稍后在 block() 中回填 */
-		table[*ptx].adr = 0;
-		break;
-	}
-	return *ptx;
-}
-
-/*
- * 查找标识符在符号表中的位置，从tx开始倒序查找标识符
- * 找到则返回在符号表中的位置，否则返回0
- *
- * id:    要查找的名字
- * tx:    当前符号表尾指针
- */
-int position(char *id, int tx)
-{
-	int i;
-	strcpy(table[0].name, id);
-	i = tx;
-	while (strcmp(table[i].name, id) != 0)
-	{
-		i--;
-	}
-	return i;
-}
-
-/*
- * 输出目标代码清单
- */
-void listcode(int cx0)
-{
-	int i;
-	if (listswitch)
-	{
-		printf("\n");
-		for (i = cx0; i < cx; i++)
-		{
-			printf("%d %s %d\n", i, mnemonic[code[i].f], code[i].a);
-		}
-	}
-}
-
-/*
- * 输出所有目标代码
- */
-void listall()
-{
-	int i;
-	if (listswitch)
-	{
-		for (i = 0; i < cx; i++)
-		{
-			printf("%d %s %d\n", i, mnemonic[code[i].f], code[i].a);
-			fprintf(fcode, "%d %s %d\n", i, mnemonic[code[i].f], code[i].a);
-		}
-	}
-}
-
-void call_handle(int pos)
-{
-	if (table[pos].kind != function)
-		error(70); /* 70: 尝试调用非函数 */
-
-	int argCnt = 0;
-
-	getsym(); /* 跳过 '(' */
-	if (sym != rparen)
-	{ /* 非空实参表 */
-		while (1)
-		{
-			bool nxtlev[symnum];
-			addset(nxtlev, facbegsys, NULL, symnum);
-			nxtlev[comma] = true;
-			nxtlev[rparen] = true;
-
-			expression(nxtlev, &tx); /* 实参表达式求值，结果在栈顶 */
-			argCnt++;
-
-			gen(opr, 17);
-
-			if (sym == comma)
-			{
-				getsym(); /* 继续下一实参 */
-				continue;
-			}
-			else if (sym == rparen)
-			{
-				break; /* 实参列表结束 */
-			}
-			else
-			{
-				error(22); /* 缺少 ')' */
-				break;
-			}
-		}
-	}
-
-	if (sym != rparen)
-		error(22); /* 确保 ')' */
-	getsym();	   /* 跳过 ')' */
-
-	/* 形参与实参个数核对 */
-	if (argCnt != table[pos].paramCnt)
-		error(60); /* 60: 参数个数不符 */
-
-	/* 生成调用指令 */
-	gen(cal, table[pos].adr);
-
-	if (sym != semicolon)
-		error(10); /* 缺少分号 */
-	getsym();	   /* 跳过 ';' */
-}
-
-/*
- * 语句处理
- */
-void statement(bool *fsys, int *ptx, int *pdx)
-{
-	bool nxtlev[symnum]; /* FOLLOW 集合 */
-
-	/* ---------- let 声明 ---------- */
-	if (sym == letsym)
-	{
-		getsym(); /* 读取 ident */
-		if (sym != ident)
-			error(1);
-
-		enter(variable, ptx, pdx); /* 建符号，adr = dx++ */
-		int varIdx = *ptx;		   /* 记录下标 */
-
-		getsym(); /* 看是否有初始化 */
-
-		if (sym == becomes) /* let x = expr; */
-		{
-			getsym();
-			addset(nxtlev, facbegsys, fsys, symnum);
-			expression(nxtlev, ptx);
-			gen(sto, table[varIdx].adr);
-		}
-
-		if (sym != semicolon)
-			error(10);
-		getsym();
-	}
-
-	/* ---------- 赋值 / 函数调用 ---------- */
-	else if (sym == ident)
-	{
-		int i = position(id, *ptx);
-		getsym();
-		if (sym == becomes)
-		{ /* ident 后面直接跟 '=' */
-			if (table[i].kind == function)
-				error(61); /* 函数名不能出现在赋值左边 */
-			getsym();	   /* 跳过 '=' */
-			bool nxtlev[symnum];
-			addset(nxtlev, facbegsys, fsys, symnum);
-			nxtlev[semicolon] = true; /* ; 可跟在表达式后 */
-			expression(nxtlev, ptx);
-			gen(sto, table[i].adr); /* 把值写回变量 */
-			if (sym != semicolon)
-				error(10);
-			getsym(); /* 跳过 ';' */
-		}
-		else if (sym == lparen)
-		{ /* ---- 函数调用 ---- */
-			call_handle(i);
-		}
-		else
-			error(33);
-	}
-
-	/* ---------- if 语句 ---------- */
-	else if (sym == ifsym)
-	{
-		getsym();
-		if (sym != lparen)
-			error(23); /* 23：缺少 '(' */
-		getsym();	   /* 吃掉 '(' */
-
-		/* --- 解析 condition --- */
-		addset(nxtlev, statbegsys, fsys, symnum);
-		nxtlev[rparen] = true;
-		condition(nxtlev, ptx);
-
-		/* --- 强制检测右括号 --- */
-		if (sym != rparen)
-			error(22); /* 22：缺少 ')' */
-		getsym();	   /* 吃掉 ')' */
-
-		int cx1 = cx;
-		gen(jpc, 0); /* 条件假跳转 */
-
-		if (sym != lbrace)
-			error(34);
-		getsym();
-		bool bodyFollow[symnum];
-		addset(bodyFollow, statbegsys, fsys, symnum);
-		bodyFollow[rbrace] = true;	  /* 右花括号算作语句结束 */
-		bodyFollow[semicolon] = true; /* 语句之后可选分号 */
-
-		/* 循环消化块内所有语句 */
-		while (inset(sym, statbegsys))
-		{
-			statement(bodyFollow, ptx, pdx);
-			if (sym == semicolon)
-				getsym(); /* 如果当前符号是分号，就先把它吞掉 */
-		}
-		if (sym != rbrace)
-			error(24); /* 块没有以 '}' 结束 */
-		getsym();	   /* 吃掉 '}' */
-
-		if (sym == elsesym) /* 可选 else */
-		{
-			int cx2 = cx;
-			gen(jmp, 0);	  /* if 真分支跳过 else */
-			code[cx1].a = cx; /* 回填 jpc */
-
-			getsym(); /* 读 else */
-			if (sym != lbrace)
-				error(34);
-			getsym();
-			bool bodyFollow[symnum];
-			addset(bodyFollow, statbegsys, fsys, symnum);
-			bodyFollow[rbrace] = true;	  /* 右花括号算作语句结束 */
-			bodyFollow[semicolon] = true; /* 语句之后可选分号 */
-
-			/* 循环消化块内所有语句 */
-			while (inset(sym, statbegsys))
-			{
-				statement(bodyFollow, ptx, pdx);
-				if (sym == semicolon)
-					getsym(); /* 如果当前符号是分号，就先把它吞掉 */
-			}
-			if (sym != rbrace)
-				error(24);	  /* 块没有以 '}' 结束 */
-			getsym();		  /* 吃掉 '}' */
-			code[cx2].a = cx; /* 回填 jmp */
-		}
-		else
-			code[cx1].a = cx; /* 无 else，直接回填 */
-	}
-
-	/* ---------- while 语句 ---------- */
-	else if (sym == whilesym)
-	{
-		int cx0 = cx; /* 循环开头 */
-		getsym();
-		if (sym != lparen)
-			error(23); /* 23：缺少 '(' */
-		getsym();	   /* 吃掉 '(' */
-
-		/* --- 解析 condition --- */
-		addset(nxtlev, statbegsys, fsys, symnum);
-		nxtlev[rparen] = true;
-		condition(nxtlev, ptx);
-
-		/* --- 强制检测右括号 --- */
-		if (sym != rparen)
-			error(22); /* 22：缺少 ')' */
-		getsym();	   /* 吃掉 ')' */
-
-		int cx1 = cx;
-		gen(jpc, 0);
-
-		if (sym != lbrace)
-			error(34);
-		getsym();
-		bool bodyFollow[symnum];
-		addset(bodyFollow, statbegsys, fsys, symnum);
-		bodyFollow[rbrace] = true;	  /* 右花括号算作语句结束 */
-		bodyFollow[semicolon] = true; /* 语句之后可选分号 */
-
-		/* 循环消化块内所有语句 */
-		while (inset(sym, statbegsys))
-		{
-			statement(bodyFollow, ptx, pdx);
-			if (sym == semicolon)
-				getsym(); /* 如果当前符号是分号，就先把它吞掉 */
-		}
-		if (sym != rbrace)
-			error(24); /* 块没有以 '}' 结束 */
-		getsym();	   /* 吃掉 '}' */
-
-		gen(jmp, cx0);
-		code[cx1].a = cx; /* 回填假跳转 */
-	}
-
-	/* ---------- input 语句 ---------- */
-	else if (sym == inputsym)
-	{
-		getsym();
-		if (sym != lparen)
-			error(26);
-		getsym();
-		while (1)
-		{
-			if (sym != ident)
-				error(1); /* 缺少标识符 */
-			int i = position(id, *ptx);
-			if (i == -1)
-				error(11); /* 未声明的标识符 */
-
-			/* 先生成 OPR 16 指令：读入一个整数到栈顶 */
-			gen(opr, 16);
-
-			/* 然后把栈顶的值存到该变量的地址 */
-			gen(sto, table[i].adr);
-
-			/* 读下一个符号，看是逗号还是右括号 */
-			getsym();
-
-			if (sym == comma)
-			{
-				getsym(); /* 吃掉 ','，处理下一个变量 */
-				continue;
-			}
-			break; /* 不是逗号，就退出循环 */
-		}
-
-		if (sym != rparen)
-			error(22);
-		getsym();
-
-		if (sym != semicolon)
-			error(10);
-		getsym();
-	}
-
-	/* ---------- output 语句 ---------- */
-	else if (sym == outputsym)
-	{
-		getsym();
-		if (sym != lparen)
-			error(34);
-		getsym();
-
-		while (1)
-		{
-			bool exprFollow[symnum];
-			addset(exprFollow, facbegsys, fsys, symnum);
-			/* 在表达式后允许看到 ',' 或 ')' */
-			exprFollow[comma] = true;
-			exprFollow[rparen] = true;
-
-			expression(exprFollow, ptx);
-			/* 每解析完一个表达式，就生成一次“打印栈顶”指令 */
-			gen(opr, 14); /* 14: 输出栈顶整数 */
-
-			if (sym == comma)
-			{
-				getsym(); /* 逗号分隔，继续下一个表达式 */
-				continue;
-			}
-			break; /* 没有逗号，就退出循环，准备读右括号 */
-		}
-
-		if (sym != rparen)
-			error(22);
-		getsym();
-
-		if (sym != semicolon)
-			error(10);
-		getsym();
-	}
-
-	/* ---------- return 语句（仅函数体允许） ---------- */
-	else if (sym == returnsym)
-	{
-		getsym();
-		addset(nxtlev, facbegsys, fsys, symnum);
-		expression(nxtlev, ptx); /* 返回值压栈 */
-
-		gen(sto, 3);  /* 写到 b-1 处 (约定的返回槽) */
-		gen(opr, 18); /* 操作 0 0 = 返回 */
-
-		if (sym != semicolon)
-			error(10);
-		getsym();
-	}
-	/* ---------- try-catch 语句 ---------- */
-	else if (sym == trysym)
-	{
-		getsym(); /* 跳过 try */
-
-		/* ===== 1. 生成 “pushC” 占位 ===== */
-		int litIdx = cx;
-		gen(lit, 0);
-		gen(opr, 19); /* 19: pushC，把 catchAddr 压入运行期 catch-栈 */
-
-		/* ===== 2. 解析 try { … } ===== */
-		if (sym != lbrace)
-			error(34); /* 缺少 '{' */
-		getsym();	   /* 吞掉 '{' */
-
-		bool tryFollow[symnum];
-		addset(tryFollow, statbegsys, fsys, symnum);
-		tryFollow[rbrace] = true;
-
-		while (inset(sym, statbegsys))
-		{
-			statement(tryFollow, ptx, pdx);
-			if (sym == semicolon)
-				getsym();
-		}
-		if (sym != rbrace)
-			error(24); /* 缺少 '}' */
-		getsym();	   /* 吞掉 '}' */
-
-		/* try 正常走完，需要跳过 catch */
-		gen(opr, 20); /* ★ 正常走完也要 popC */
-		int jmpIdx = cx;
-		gen(jmp, 0); /* 稍后回填到 catch 之后 */
-
-		/* ===== 3. 解析 catch { … } ===== */
-		if (sym != catchsym)
-			error(88); /* 缺少 catch */
-		getsym();
-
-		if (sym != lbrace)
-			error(34);
-		getsym();
-
-		int catchStart = cx;		 /* catch 起始地址，回填到 lit */
-		code[litIdx].a = catchStart; /* 把 lit 0 改成真正地址 */
-
-		bool catchFollow[symnum];
-		addset(catchFollow, statbegsys, fsys, symnum);
-		catchFollow[rbrace] = true;
-
-		while (inset(sym, statbegsys))
-		{
-			statement(catchFollow, ptx, pdx);
-			if (sym == semicolon)
-				getsym();
-		}
-		if (sym != rbrace)
-			error(24);
-		getsym();
-
-		gen(opr, 20); /* 20: popC，catch 执行完弹栈 */
-
-		/* ===== 4. 回填 “跳过 catch” ===== */
-		code[jmpIdx].a = cx;
-	}
-
-	else
-	{
-		/* 空语句或非法开头：交给上层 test() 处理 */
-	}
-}
-
-/*
- * 表达式处理
- */
-void expression(bool *fsys, int *ptx)
-{
-	enum symbol addop; /* 用于保存正负号 */
-	bool nxtlev[symnum];
-
-	if (sym == plus || sym == minus) /* 表达式开头有正负号，此时当前表达式被看作一个正的或负的项 */
-	{
-		addop = sym; /* 保存开头的正负号 */
-		getsym();
-		memcpy(nxtlev, fsys, sizeof(bool) * symnum);
-		nxtlev[plus] = true;
-		nxtlev[minus] = true;
-		term(nxtlev, ptx); /* 处理项 */
-		if (addop == minus)
-		{
-			gen(opr, 1); /* 如果开头为负号生成取负指令 */
-		}
-	}
-	else /* 此时表达式被看作项的加减 */
-	{
-		memcpy(nxtlev, fsys, sizeof(bool) * symnum);
-		nxtlev[plus] = true;
-		nxtlev[minus] = true;
-		term(nxtlev, ptx); /* 处理项 */
-	}
-	while (sym == plus || sym == minus)
-	{
-		addop = sym;
-		getsym();
-		memcpy(nxtlev, fsys, sizeof(bool) * symnum);
-		nxtlev[plus] = true;
-		nxtlev[minus] = true;
-		term(nxtlev, ptx); /* 处理项 */
-		if (addop == plus)
-		{
-			gen(opr, 2); /* 生成加法指令 */
-		}
-		else
-		{
-			gen(opr, 3); /* 生成减法指令 */
-		}
-	}
-}
-
-/*
- * 项处理
- */
-void term(bool *fsys, int *ptx)
-{
-	enum symbol mulop; /* 用于保存乘除法符号 */
-	bool nxtlev[symnum];
-
-	memcpy(nxtlev, fsys, sizeof(bool) * symnum);
-	nxtlev[times] = true;
-	nxtlev[slash] = true;
-	factor(nxtlev, ptx); /* 处理因子 */
-	while (sym == times || sym == slash)
-	{
-		mulop = sym;
-		getsym();
-		factor(nxtlev, ptx);
-		if (mulop == times)
-		{
-			gen(opr, 4); /* 生成乘法指令 */
-		}
-		else
-		{
-			gen(opr, 5); /* 生成除法指令 */
-		}
-	}
-}
-
-/*
- * 因子处理
- */
-/* factor() —— 解析因子，支持函数调用、变量、数字和括号表达式 */
-/* factor() —— 解析因子，支持函数调用、变量、数字和括号表达式 */
-void factor(bool *fsys, int *ptx)
-{
-	int i, argCnt;
-	bool nxtlev[symnum];
-
-	/* 检测因子的开始符号 */
-	facbegsys[rparen] = true;
-	test(facbegsys, fsys, 77);
-
-	while (inset(sym, facbegsys)) /* 循环处理一个完整的因子 */
-	{
-		if (sym == ident)
-		{
-			/* 标识符：要么是函数调用，要么是普通变量或形参 */
-			i = position(id, *ptx);
-			if (i == -1)
-				error(11); /* 未声明标识符 */
-			getsym();
-
-			/* --------- 如果紧跟 '('，视为函数调用 --------- */
-			if (sym == lparen)
-			{
-				/* 1. 初始化 nxtlev = facbegsys ∪ fsys */
-				memset(nxtlev, 0, sizeof(nxtlev));
-				addset(nxtlev, facbegsys, fsys, symnum);
-				nxtlev[comma] = true;  /* ← 一定要允许逗号 */
-				nxtlev[rparen] = true; /* ← 一定要允许右括号 */
-
-				/* 2. 解析实参列表，每个 expression 都把值压栈 */
-				argCnt = 0;
-				getsym();		   /* 已读到 '(', 现在取下一个符号 */
-				if (sym != rparen) /* 允许空实参 */
-				{
-					do
-					{
-						/* 传入已初始化的 nxtlev，保证 expression() 能正确停到逗号或右括号 */
-						expression(nxtlev, ptx);
-						argCnt++;
-						gen(opr, 17); /* 参数传递指令 */
-						if (sym == comma)
-							getsym();
-					} while (sym != rparen);
-
-					if (sym != rparen)
-						error(22); /* 缺少右括号 ')' */
-				}
-				getsym(); /* 越过 ')' */
-
-				/* 3. 检查实参个数是否与表中记录一致 */
-				// if (argCnt != table[i].paramCnt)
-				// error(60);
-
-				/* 4. 生成函数调用指令，返回值留在栈顶 */
-				gen(cal, table[i].adr);
-			}
-			/* --------- 否则视为普通变量或形参 --------- */
-			else
-			{
-				if (table[i].kind == function)
-					error(61); /* 函数名不能直接作为值 */
-				gen(lod, table[i].adr);
-			}
-		}
-		else if (sym == number)
-		{
-			/* 因子是数字常量 */
-			if (num > amax)
-			{
-				error(31); /* 数字越界 */
-				num = 0;
-			}
-			gen(lit, num);
-			getsym();
-		}
-		else if (sym == lparen)
-		{
-			/* 因子是括号内表达式 "( ... )" */
-			/* 1. 初始化 nxtlev = facbegsys ∪ fsys */
-			memset(nxtlev, 0, sizeof(nxtlev));
-			addset(nxtlev, facbegsys, fsys, symnum);
-
-			getsym(); /* 吃掉 '(' */
-			/* 2. 设置子表达式的 FOLLOW 集 = fsys ∪ { ')' } */
-			memcpy(nxtlev, fsys, sizeof(bool) * symnum);
-			nxtlev[rparen] = true;
-			expression(nxtlev, ptx);
-			if (sym == rparen)
-				getsym();
-			else
-				error(22); /* 缺少右括号 ')' */
-		}
-		else
-		{
-			/* 不合法的因子开头，退出循环 */
-			break;
-		}
-
-		/* 因子处理结束后，检查下一个符号是否合法 */
-		memset(nxtlev, 0, sizeof(nxtlev));
-		nxtlev[lparen] = true;
-		fsys[comma] = true;
-		test(fsys, nxtlev, 77);
-	}
-}
-
-/*
- * 条件处理
- */
-void condition(bool *fsys, int *ptx)
-{
-	enum symbol relop;
-	bool nxtlev[symnum];
-
-	/* 逻辑表达式处理 */
-	memcpy(nxtlev, fsys, sizeof(bool) * symnum);
-	nxtlev[eql] = true;
-	nxtlev[neq] = true;
-	nxtlev[lss] = true;
-	nxtlev[leq] = true;
-	nxtlev[gtr] = true;
-	nxtlev[geq] = true;
-	expression(nxtlev, ptx);
-	if (sym != eql && sym != neq && sym != lss && sym != leq && sym != gtr && sym != geq)
-	{
-		error(20); /* 应该为关系运算符 */
-	}
-	else
-	{
-		relop = sym;
-		getsym();
-		expression(fsys, ptx);
-		switch (relop)
-		{
-		case eql:
-			gen(opr, 8);
-			break;
-		case neq:
-			gen(opr, 9);
-			break;
-		case lss:
-			gen(opr, 10);
-			break;
-		case geq:
-			gen(opr, 11);
-			break;
-		case gtr:
-			gen(opr, 12);
-			break;
-		case leq:
-			gen(opr, 13);
-			break;
-		}
-	}
-}
-
-/*
- * 解释程序
- */
-void interpret()
-{
-	int p = 0;			  /* 指令指针 */
-	int b = 1;			  /* 指令基址 */
-	int t = 0;			  /* 栈顶指针 */
-	int k = 3;			  // 参数位置
-	struct instruction i; /* 存放当前指令 */
-	int s[stacksize];	  /* 栈 */
-	int catchStack[stacksize];
-	int cTop = 0;
-
-	printf("Start l25\n");
-	fprintf(fresult, "Start l25\n");
-	s[0] = 0; /* s[0]不用 */
-	s[1] = 0; /* 主程序的三个联系单元均置为0 */
-	s[2] = 0;
-	s[3] = 0;
-	do
-	{
-		i = code[p]; /* 读当前指令 */
-		p = p + 1;
-		switch (i.f)
-		{
-		case lit: /* 将常量a的值取到栈顶 */
-			t = t + 1;
-			s[t] = i.a;
-			break;
-		case opr: /* 数学、逻辑运算 */
-			switch (i.a)
-			{
-			case 0: /* 函数调用结束后返回 */
-				t = b - 1;
-				p = s[t + 3];
-				b = s[t + 2];
-				break;
-			case 1: /* 栈顶元素取反 */
-				s[t] = -s[t];
-				break;
-			case 2: /* 次栈顶项加上栈顶项，退两个栈元素，相加值进栈 */
-				t = t - 1;
-				s[t] = s[t] + s[t + 1];
-				break;
-			case 3: /* 次栈顶项减去栈顶项 */
-				t = t - 1;
-				s[t] = s[t] - s[t + 1];
-				break;
-			case 4: /* 次栈顶项乘以栈顶项 */
-				t = t - 1;
-				s[t] = s[t] * s[t + 1];
-				break;
-			case 5: /* 次栈顶项除以栈顶项 */
-			{		/* 次栈顶 ÷ 栈顶 */
-				if (s[t] == 0)
-				{
-					printf("** Runtime Error: Division by zero at instruction %d\n", p - 1);
-					fprintf(fresult, "** Runtime Error: Division by zero at instruction %d\n", p - 1);
-
-					if (cTop > 0)
-					{						  /* ① 最近的 catch 存在 */
-						p = catchStack[cTop]; /* ② 跳转到 catchStart —— 不弹栈！ */
-						t--;				  /* ③ 丢掉 try 内部残留表达式 */
-					}
-					else
-					{ /* 没任何 catch 可以处理 */
-						exit(1);
-					}
-				}
-				else
-				{ /* 正常除法 */
-					t--;
-					s[t] = s[t] / s[t + 1];
-				}
-				break;
-			}
-			case 6: /* 栈顶元素的奇偶判断 */
-				s[t] = s[t] % 2;
-				break;
-			case 8: /* 次栈顶项与栈顶项是否相等 */
-				t = t - 1;
-				s[t] = (s[t] == s[t + 1]);
-				break;
-			case 9: /* 次栈顶项与栈顶项是否不等 */
-				t = t - 1;
-				s[t] = (s[t] != s[t + 1]);
-				break;
-			case 10: /* 次栈顶项是否小于栈顶项 */
-				t = t - 1;
-				s[t] = (s[t] < s[t + 1]);
-				break;
-			case 11: /* 次栈顶项是否大于等于栈顶项 */
-				t = t - 1;
-				s[t] = (s[t] >= s[t + 1]);
-				break;
-			case 12: /* 次栈顶项是否大于栈顶项 */
-				t = t - 1;
-				s[t] = (s[t] > s[t + 1]);
-				break;
-			case 13: /* 次栈顶项是否小于等于栈顶项 */
-				t = t - 1;
-				s[t] = (s[t] <= s[t + 1]);
-				break;
-			case 14: /* 栈顶值输出 */
-				printf("%d ", s[t]);
-				fprintf(fresult, "%d ", s[t]);
-				t = t - 1;
-				break;
-			case 15: /* 输出换行符 */
-				printf("\n");
-				fprintf(fresult, "\n");
-				break;
-			case 16: /* 读入一个输入置于栈顶 */
-				t = t + 1;
-				printf("?");
-				fprintf(fresult, "?");
-				scanf("%d", &(s[t]));
-				fprintf(fresult, "%d\n", s[t]);
-				break;
-			case 17: /* 参数传入 */
-				s[t + k] = s[t];
-				k++;
-				t--;
-				break;
-			case 18:
-			{
-				int retVal = s[b + 2]; /* 从 s[b+2] 中取出 testfunc 真正写好的返回值 */
-				int oldB = s[b + 0];   /* 从 s[b+0] 中取出上一层的基址 (SL) */
-				int oldP = s[b + 1];   /* 从 s[b+1] 中取出上一层的返回地址 (RA) */
-
-				t = b - 1;	   /* 恢复栈顶到 cal 之前的状态 */
-				t = t + 1;	   /* 先把 t 再往上拨 1，改写为 8 */
-				s[t] = retVal; /* 把 21 写到 s[8] */
-				// 上面做法让 “返回值” → 直接留在 s[8] 上
-				// 之后再恢复 b、p：
-				b = oldB;
-				p = oldP;
-				break;
-			}
-			case 19:					   // pushC
-				catchStack[++cTop] = s[t]; // t 保存的是 catchStart
-				t--;
-				break;
-
-			case 20: // popC
-				cTop--;
-				break;
-			}
-			break;
-		case lod: /* 取相对当前过程的数据基地址为a的内存的值到栈顶 */
-			t = t + 1;
-			s[t] = s[b + i.a];
-			break;
-		case sto: /* 栈顶的值存到相对当前过程的数据基地址为a的内存 */
-			s[b + i.a] = s[t];
-			t = t - 1;
-			break;
-		case cal:		  /* 调用子过程 */
-			s[t + 1] = b; /* 将本过程基地址入栈，即建立动态链 */
-			s[t + 2] = p; /* 将当前指令指针入栈，即保存返回地址 */
-			s[t + 3] = 0; /* 留出一个格子给返回值（初始化为0） */
-			b = t + 1;	  /* 更新基地址 */
-			p = i.a;	  /* 跳转到函数入口 */
-			k = 3;		  /* ← 初始化参数搬运偏移量为4 */
-			break;
-		case ini: /* 在数据栈中为被调用的过程开辟a个单元的数据区 */
-			t = t + i.a;
-			break;
-		case jmp: /* 直接跳转 */
-			p = i.a;
-			break;
-		case jpc: /* 条件跳转 */
-			if (s[t] == 0)
-				p = i.a;
-			t = t - 1;
-			break;
-		}
-		{
-			printf("  [after %s %d]  stack (t=%d, b=%d):", mnemonic[i.f], i.a, t, b);
-			fprintf(fresult, "  [after %s %d]  stack (t=%d, b=%d):", mnemonic[i.f], i.a, t, b);
-			for (int i = 1; i <= t; i++)
-			{
-				printf(" %d", s[i]);
-				fprintf(fresult, " %d", s[i]);
-			}
-			printf("\n");
-			fprintf(fresult, "\n");
-		} /*输出所有栈*/
-	} while (p != 0);
-	printf("\nEnd l25\n");
-	fprintf(fresult, "\nEnd l25\n");
+/*
+ * l25 complier program implemented in C
+ * PL/0编译器（完整版本）
+ * The program has been tested on Visual Studio 2022
+ *
+ * 编译器与虚拟机本身，不做文件以外的输入输出，也不调用 exit()
+ * 命令行入口见 l25Main.c，嵌入用的库接口见 l25api.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "l25.h"
+
+/* 保留字，按照字母顺序，便于二分查找 */
+const char word[norw][al] = {
+	"catch", "else", "func", "generator", "if", "input", "join", "let",
+	"main", "next", "output", "parfor", "program", "return", "spawn", "try", "while", "yield"};
+/* 保留字对应的符号值 */
+const enum symbol wsym[norw] = {
+	catchsym, elsesym, funcsym, gensym, ifsym, inputsym, joinsym, letsym,
+	mainsym, nextsym, outputsym, parforsym, progsym, returnsym, spawnsym, trysym, whilesym, yieldsym};
+/* 单字符的符号值，其余均为 nul */
+const enum symbol ssym[256] = {
+	['+'] = plus, ['-'] = minus, ['*'] = times, ['/'] = slash,
+	['('] = lparen, [')'] = rparen, ['{'] = lbrace, ['}'] = rbrace,
+	['['] = lbracket, [']'] = rbracket, [','] = comma, ['.'] = period, [';'] = semicolon};
+/* 虚拟机代码指令名称 */
+const char mnemonic[fctnum][5] = {
+	[lit] = "lit", [opr] = "opr", [lod] = "lod", [sto] = "sto",
+	[cal] = "cal", [ini] = "int", [jmp] = "jmp", [jpc] = "jpc",
+	[ldx] = "ldx", [stx] = "stx", [ldxu] = "ldxu", [stxu] = "stxu"};
+/* 表示声明开始的符号集合 */
+const symset declbegsys = SYMBIT(funcsym) | SYMBIT(gensym);
+/* 表示语句开始的符号集合 */
+const symset statbegsys = SYMBIT(inputsym) | SYMBIT(outputsym) | SYMBIT(ifsym) | SYMBIT(whilesym) |
+						  SYMBIT(letsym) | SYMBIT(ident) | SYMBIT(trysym) | SYMBIT(parforsym) | SYMBIT(yieldsym);
+/* 表示因子开始的符号集合 */
+const symset facbegsys =
+	SYMBIT(ident) | SYMBIT(number) | SYMBIT(lparen) | SYMBIT(spawnsym) | SYMBIT(joinsym) | SYMBIT(nextsym);
+
+
+/*
+ * 用位掩码实现集合的集合运算
+ */
+static inline int inset(int e, symset s)
+{
+	return (int)((s >> e) & 1);
+}
+
+static inline symset addset(symset s1, symset s2)
+{
+	return s1 | s2;
+}
+
+static inline symset subset(symset s1, symset s2)
+{
+	return s1 & ~s2;
+}
+
+static inline symset mulset(symset s1, symset s2)
+{
+	return s1 & s2;
+}
+
+/*
+ * 编译 ctx->src 字符串（不为 NULL 时）或 ctx->fin 中的源程序
+ * 源程序、文件句柄和开关由调用者设置，不需要的输出文件可以为 NULL，返回错误个数；遇到无法继续的错误时返回 -1
+ */
+int compile(struct compiler *ctx)
+{
+	unsigned long long start = ctx->stats ? profclock() : 0;
+
+	init(ctx); /* 初始化 */
+	if (setjmp(ctx->fatal))
+	{
+		if (ctx->stats)
+			ctx->stats->clock += profclock() - start;
+		return -1;
+	}
+
+	getsym(ctx);
+
+	program(ctx, addset(declbegsys, statbegsys)); /* ← 取代原 block(...) */
+	if (ctx->stats)
+		ctx->stats->clock += profclock() - start;
+	return ctx->err;
+}
+
+/*
+ * 报告无法继续编译的错误，并跳回 compile()
+ */
+static void fatal(struct compiler *ctx, const char *msg)
+{
+	if (ctx->echo)
+		printf("%s\n", msg);
+	if (ctx->foutput)
+		fprintf(ctx->foutput, "%s\n", msg);
+	ctx->fatalmsg = msg;
+	longjmp(ctx->fatal, 1);
+}
+
+/*
+ * 初始化编译器上下文，文件句柄和开关由调用者设置
+ */
+void init(struct compiler *ctx)
+{
+	ctx->err = 0;
+	ctx->cc = ctx->ll = 0;
+	ctx->ch = ' ';
+	ctx->tx = 0;
+	ctx->dx = 0;
+	ctx->cx = 0; /* 代码计数器 */
+	ctx->curFuncIdx = -1;
+	ctx->sym = nul;
+	ctx->num = 0;
+	ctx->id[0] = 0;
+	ctx->srcpos = 0;
+	ctx->srcend = false;
+	ctx->lineno = ctx->symline = ctx->prevline = 0;
+	ctx->errline = ctx->errcol = ctx->errcode = 0;
+	ctx->fatalmsg = NULL;
+	ctx->inipos = 0;
+	ctx->ntries = 0;
+	ctx->group = NULL;
+	ctx->ngroups = 0;
+	ctx->nspawns = 0;
+	ctx->loopfloor = 0;
+	ctx->ingen = false;
+	ctx->curlist = -1;
+	ctx->nlists = 0;
+	ctx->ndecls = ctx->naccesses = ctx->nsafe = 0;
+}
+
+/*
+ *	出错处理，打印出错位置和错误编码
+ */
+void error(struct compiler *ctx, int n)
+{
+	char space[81];
+	memset(space, 32, 81);
+
+	space[ctx->cc - 1] = 0; /* 出错时当前符号已经读完，所以cc-1 */
+
+	if (ctx->echo)
+		printf("**%s^%d\n", space, n);
+	if (ctx->foutput)
+		fprintf(ctx->foutput, "**%s^%d\n", space, n);
+
+	if (ctx->err == 0)
+	{ /* 记下第一个错误的位置 */
+		ctx->errline = ctx->lineno;
+		ctx->errcol = ctx->cc;
+		ctx->errcode = n;
+	}
+	ctx->err = ctx->err + 1;
+	if (ctx->err > maxerr)
+	{
+		fatal(ctx, "Too many errors!");
+	}
+}
+
+/*
+ * 源程序是否已读完，与 feof() 一样在读取失败之后才为真
+ */
+static bool srceof(struct compiler *ctx)
+{
+	return ctx->src ? ctx->srcend : feof(ctx->fin);
+}
+
+/*
+ * 从源程序字符串或 fin 读一个字符，读完时返回 EOF
+ */
+static int srcgetc(struct compiler *ctx)
+{
+	if (ctx->src == NULL)
+		return fgetc(ctx->fin);
+	if (ctx->srcpos >= ctx->srclen)
+	{
+		ctx->srcend = true;
+		return EOF;
+	}
+	return (unsigned char)ctx->src[ctx->srcpos++];
+}
+
+/*
+ * 过滤空格，读取一个字符
+ * 每次读一行，存入line缓冲区，line被getsym取空后再读一行
+ * 被函数getsym调用
+ */
+void getch(struct compiler *ctx)
+{
+	if (ctx->cc == ctx->ll) /* 判断缓冲区中是否有字符，若无字符，则读入下一行字符到缓冲区中 */
+	{
+		int c;
+
+		if (srceof(ctx))
+		{
+			ctx->ch = EOF; /* 交由 getsym() 把 sym 设成 nul */
+			return;
+		}
+		ctx->ll = 0;
+		ctx->cc = 0;
+		ctx->lineno++;
+		if (ctx->echo)
+			printf("%d ", ctx->cx);
+		if (ctx->foutput)
+			fprintf(ctx->foutput, "%d ", ctx->cx);
+		ctx->ch = ' ';
+		while (ctx->ch != 10 && ctx->ll < (int)sizeof(ctx->line) - 1) /* 过长的行截成几行，不越界 */
+		{
+			if ((c = srcgetc(ctx)) == EOF)
+			{
+				ctx->line[ctx->ll] = 0;
+				break;
+			}
+			ctx->ch = (char)c;
+
+			if (ctx->echo)
+				printf("%c", ctx->ch);
+			if (ctx->foutput)
+				fprintf(ctx->foutput, "%c", ctx->ch);
+			ctx->line[ctx->ll] = ctx->ch;
+			ctx->ll++;
+		}
+	}
+	ctx->ch = ctx->line[ctx->cc];
+	ctx->cc++;
+}
+
+/*
+ * 词法分析，获取一个符号
+ */
+static void scan(struct compiler *ctx)
+{
+	int i, j, k;
+
+	while (ctx->ch == ' ' || ctx->ch == 10 || ctx->ch == 9) /* 过滤空格、换行和制表符 */
+	{
+		getch(ctx);
+	}
+	ctx->prevline = ctx->symline;
+	ctx->symline = ctx->lineno;
+	if (ctx->ch == EOF)
+	{
+		ctx->sym = nul;
+		return;
+	}
+	if ((ctx->ch >= 'a' && ctx->ch <= 'z') || (ctx->ch >= 'A' && ctx->ch <= 'Z')) /* 当前的单词是标识符或是保留字 */
+	{
+		k = 0;
+		do
+		{
+			if (k < al)
+			{
+				ctx->a[k] = ctx->ch;
+				k++;
+			}
+			getch(ctx);
+		} while ((ctx->ch >= 'a' && ctx->ch <= 'z') || (ctx->ch >= 'A' && ctx->ch <= 'Z') || (ctx->ch >= '0' && ctx->ch <= '9'));
+		ctx->a[k] = 0;
+		strcpy(ctx->id, ctx->a);
+		i = 0;
+		j = norw - 1;
+		do
+		{ /* 搜索当前单词是否为保留字，使用二分法查找 */
+			k = (i + j) / 2;
+			if (strcmp(ctx->id, word[k]) <= 0)
+			{
+				j = k - 1;
+			}
+			if (strcmp(ctx->id, word[k]) >= 0)
+			{
+				i = k + 1;
+			}
+		} while (i <= j);
+		if (i - 1 > j) /* 当前的单词是保留字 */
+		{
+			ctx->sym = wsym[k];
+		}
+		else /* 当前的单词是标识符 */
+		{
+			ctx->sym = ident;
+		}
+	}
+	else
+	{
+		if (ctx->ch >= '0' && ctx->ch <= '9') /* 当前的单词是数字 */
+		{
+			k = 0;
+			ctx->num = 0;
+			ctx->sym = number;
+			do
+			{
+				ctx->num = 10 * ctx->num + ctx->ch - '0';
+				k++;
+				getch(ctx);
+				;
+			} while (ctx->ch >= '0' && ctx->ch <= '9'); /* 获取数字的值 */
+			k--;
+			if (k > nmax) /* 数字位数太多 */
+			{
+				error(ctx, 30);
+			}
+		}
+		else
+		{
+			if (ctx->ch == '=') /* 检测赋值符号 */
+			{
+				getch(ctx);
+				if (ctx->ch == '=')
+				{
+					ctx->sym = eql;
+					getch(ctx);
+				}
+				else
+				{
+					ctx->sym = becomes; /* 赋值符号 */
+				}
+			}
+			else
+			{
+				if (ctx->ch == '<') /* 检测小于或小于等于符号 */
+				{
+					getch(ctx);
+					if (ctx->ch == '=')
+					{
+						ctx->sym = leq;
+						getch(ctx);
+					}
+					else
+					{
+						ctx->sym = lss;
+					}
+				}
+				else
+				{
+					if (ctx->ch == '>') /* 检测大于或大于等于符号 */
+					{
+						getch(ctx);
+						if (ctx->ch == '=')
+						{
+							ctx->sym = geq;
+							getch(ctx);
+						}
+						else
+						{
+							ctx->sym = gtr;
+						}
+					}
+					else
+					{
+						if (ctx->ch == '!') /* 检测不等于符号 */
+						{
+							getch(ctx);
+							if (ctx->ch == '=')
+							{
+								ctx->sym = neq;
+								getch(ctx);
+							}
+							else
+							{
+								ctx->sym = nul;
+								error(ctx, 30);
+							}
+						}
+						else
+						{
+							ctx->sym = ssym[(unsigned char)ctx->ch]; /* 当符号不满足上述条件时，全部按照单字符符号处理 */
+							if (ctx->sym != nul)
+							{
+								getch(ctx);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void getsym(struct compiler *ctx)
+{
+	unsigned long long start;
+
+	if (ctx->stats == NULL)
+	{
+		scan(ctx);
+		return;
+	}
+	start = profclock();
+	scan(ctx);
+	ctx->stats->lexclock += profclock() - start;
+	ctx->stats->tokens++;
+}
+
+/*
+ * 按生成的指令模拟栈顶相对栈帧的位置，记下本函数中表达式求值用到的栈帧之上的最多单元数
+ * 表达式中没有跳转，语句之间操作数都已用完，所以按生成的顺序模拟就与执行时相同。
+ * opr 17 把实参放在 s[t + k]，cal 建立的联系单元在 s[t + 1..t + 3]，都算在内
+ */
+static void operands(struct compiler *ctx, enum fct x, int z)
+{
+	int d = ctx->opdepth;
+
+	switch (x)
+	{
+	case ini: /* 函数或主程序的开头 */
+		d = ctx->opmax = 0;
+		ctx->opk = 3;
+		break;
+	case lit:
+	case lod:
+		d++;
+		break;
+	case sto:
+	case jpc:
+		d--;
+		break;
+	case stx:
+	case stxu:
+		d -= 2;
+		break;
+	case cal:
+		if (d + 3 > ctx->opmax)
+			ctx->opmax = d + 3;
+		d++;
+		ctx->opk = 3;
+		break;
+	case opr:
+		if (z == 17)
+		{
+			if (d + ctx->opk > ctx->opmax)
+				ctx->opmax = d + ctx->opk;
+			ctx->opk++;
+			d--;
+		}
+		else if (z == 19)
+			ctx->opk = 3;
+		else if (z == 16)
+			d++;
+		else if ((z >= 2 && z <= 5) || (z >= 8 && z <= 14) || z == 25 || z == 28)
+			d--;
+		else if (z >= 29 && z <= 31)
+			d -= 2;
+		break;
+	default:
+		break;
+	}
+	ctx->opdepth = d;
+	if (d > ctx->opmax)
+		ctx->opmax = d;
+}
+
+/*
+ * 生成虚拟机代码
+ *
+ * x: instruction.f;
+ * z: instruction.a;
+ */
+void gen(struct compiler *ctx, enum fct x, int z)
+{
+	unsigned long long start = ctx->stats ? profclock() : 0;
+
+	if (ctx->cx >= cxmax)
+	{
+		fatal(ctx, "Program is too long!"); /* 生成的虚拟机代码程序过长 */
+	}
+	if (z >= amax)
+	{
+		fatal(ctx, "Displacement address is too big!"); /* 地址偏移越界 */
+	}
+	ctx->code[ctx->cx].f = x;
+	ctx->code[ctx->cx].a = z;
+	ctx->codeline[ctx->cx] = ctx->prevline; /* 生成指令时当前符号通常已是下一个结构的开头 */
+	ctx->cx++;
+	operands(ctx, x, z);
+	if (ctx->stats)
+	{
+		ctx->stats->genclock += profclock() - start;
+		ctx->stats->gens++;
+	}
+}
+
+/*
+ * 测试当前符号是否合法
+ *
+ * 在语法分析程序的入口和出口处调用测试函数test，
+ * 检查当前单词进入和退出该语法单位的合法性
+ *
+ * s1:	需要的单词集合
+ * s2:	如果不是需要的单词，在某一出错状态时，
+ *      可恢复语法分析继续正常工作的补充单词符号集合
+ * n:  	错误号
+ */
+void test(struct compiler *ctx, symset s1, symset s2, int n)
+{
+	if (!inset(ctx->sym, s1))
+	{
+		error(ctx, n);
+		/* 当检测不通过时，不停获取符号，直到它属于需要的集合或补救的集合 */
+		while ((!inset(ctx->sym, s1)) && (!inset(ctx->sym, s2)))
+		{
+			getsym(ctx);
+		}
+	}
+}
+
+/*
+ * 在主程序之后生成异常表，并把表的地址回填到 code[1]
+ * 表的第一个字是项数，每项四个字：try 区域 [start, end)、处理程序的地址、所在函数的 ini 指令地址，
+ * 都用 lit 表示，从不执行。内层的 try 排在外层之前
+ */
+static void gentrytable(struct compiler *ctx)
+{
+	int i;
+
+	ctx->code[1].a = ctx->cx;
+	gen(ctx, lit, ctx->ntries);
+	for (i = 0; i < ctx->ntries; i++)
+	{
+		gen(ctx, lit, ctx->tries[i].start);
+		gen(ctx, lit, ctx->tries[i].end);
+		gen(ctx, lit, ctx->tries[i].handler);
+		gen(ctx, lit, ctx->tries[i].ini);
+	}
+}
+
+/* 地址 i 处的指令调用的函数入口：cal 的操作数，或 spawn（opr 19）之前 lit 的操作数；不是调用时为 -1 */
+static int callee(const struct compiler *ctx, int i)
+{
+	if (ctx->code[i].f == cal)
+		return ctx->code[i].a;
+	if (ctx->code[i].f == opr && ctx->code[i].a == 19 && i > 0)
+		return ctx->code[i - 1].a;
+	return -1;
+}
+
+/* 不能交给线程池的指令：输入输出，生成器和数组都在各自的虚拟机中 */
+static bool sideeffect(struct instruction i)
+{
+	if (i.f == opr)
+		return (i.a >= 14 && i.a <= 16) || (i.a >= 23 && i.a <= 31);
+	return i.f == ldx || i.f == stx || i.f == ldxu || i.f == stxu;
+}
+
+/*
+ * 在异常表之后生成分叉表，只收入从第一次调用到最后一次调用之间所调用的函数都是纯函数、也不用 spawn 和 join 的组
+ * 纯函数不输入输出、不用生成器和数组，所调用（包括 spawn）的函数也都是纯函数：按入口地址把 code[] 划分给各函数，
+ * 先标出直接输入输出的函数，再沿调用关系传播到不再变化为止；用到 spawn、join 的函数同样传播。
+ * 表的第一个字是组数，每组先是调用次数，再是每次调用的 cal 指令地址和实参个数；
+ * 随后是启动纯函数的 spawn 数和它们的 opr 19 指令地址。都用 lit 表示，从不执行
+ */
+static void genforktable(struct compiler *ctx)
+{
+	int mainpc = ctx->code[0].a;
+	int *owner = malloc(sizeof(int) * ctx->cx); /* 每条指令所属的函数的入口，主程序中为 -1 */
+	bool *impure = calloc(ctx->cx, sizeof(bool)); /* 以函数入口为下标 */
+	bool *tasks = calloc(ctx->cx, sizeof(bool));  /* 用到 spawn、join：回退重新执行时任务会重复启动或取回 */
+	bool changed = true;
+	int i, g, c, entry = -1, pos, n = 0;
+
+	for (i = 0; i < ctx->cx; i++)
+		owner[i] = -1;
+	for (i = 1; i <= ctx->tx; i++)
+		if (ctx->table[i].kind == function && ctx->table[i].adr > 0 && ctx->table[i].adr < mainpc)
+			owner[ctx->table[i].adr] = ctx->table[i].adr;
+	for (i = 0; i < mainpc; i++)
+	{
+		if (owner[i] >= 0)
+			entry = owner[i];
+		owner[i] = entry;
+		if (entry >= 0 && sideeffect(ctx->code[i]))
+			impure[entry] = true;
+		if (entry >= 0 && ctx->code[i].f == opr && (ctx->code[i].a == 19 || ctx->code[i].a == 20))
+			tasks[entry] = true;
+	}
+	while (changed)
+	{
+		changed = false;
+		for (i = 0; i < mainpc; i++)
+		{
+			if (owner[i] < 0 || (c = callee(ctx, i)) < 0 || c >= ctx->cx)
+				continue;
+			if (!impure[owner[i]] && impure[c])
+				impure[owner[i]] = changed = true;
+			if (!tasks[owner[i]] && tasks[c])
+				tasks[owner[i]] = changed = true;
+		}
+	}
+
+	pos = ctx->cx;
+	gen(ctx, lit, 0); /* 组数，最后回填 */
+	for (g = 0; g < ctx->ngroups; g++)
+	{
+		const struct forkgroup *fg = &ctx->groups[g];
+		bool pure = true;
+
+		for (i = fg->cal[0]; i <= fg->cal[fg->n - 1]; i++)
+		{
+			if (ctx->code[i].f == cal && (impure[ctx->code[i].a] || tasks[ctx->code[i].a]))
+				pure = false;
+			if (ctx->code[i].f == opr && (ctx->code[i].a == 19 || ctx->code[i].a == 20 || ctx->code[i].a == 24))
+				pure = false;
+		}
+		if (!pure)
+			continue;
+		gen(ctx, lit, fg->n);
+		for (i = 0; i < fg->n; i++)
+		{
+			gen(ctx, lit, fg->cal[i]);
+			gen(ctx, lit, fg->nargs[i]);
+		}
+		n++;
+	}
+	ctx->code[pos].a = n;
+
+	pos = ctx->cx;
+	gen(ctx, lit, 0); /* 纯函数的 spawn 数，最后回填 */
+	for (i = n = 0; i < ctx->nspawns; i++)
+	{ /* opr 19 之前的 lit 是被调函数的入口 */
+		if (!impure[ctx->code[ctx->spawns[i] - 1].a])
+		{
+			gen(ctx, lit, ctx->spawns[i]);
+			n++;
+		}
+	}
+	ctx->code[pos].a = n;
+	free(owner);
+	free(impure);
+	free(tasks);
+}
+
+/* <program> ::= program ident '{' { <func_def> } <main_block> '}' '.' */
+void program(struct compiler *ctx, symset fsys)
+{
+	/* program <ident> '{' {function-def} main-block '}' '.' */
+	int cx0;
+	ctx->dx = 3;
+
+	if (ctx->sym != progsym)
+		error(ctx, 40);
+	getsym(ctx);
+
+	if (ctx->sym != ident)
+		error(ctx, 1); /* 程序名 */
+	getsym(ctx);
+
+	if (ctx->sym != lbrace)
+		error(ctx, 23);
+	getsym(ctx);
+
+	cx0 = ctx->cx;	 /* 保存当前 code 索引 */
+	gen(ctx, jmp, 0); /* 先生成一条 jmp 占位，后面回填 */
+	gen(ctx, jmp, 0); /* code[1] 记录异常表的地址，从不执行，最后回填 */
+
+	/* ---------- 0~多条 function 定义 ---------- */
+	while (ctx->sym == funcsym || ctx->sym == gensym)
+	{
+		symset funcFollow = declbegsys | SYMBIT(mainsym) | SYMBIT(rbrace) | SYMBIT(semicolon);
+		parse_function_header(ctx, funcFollow); /* ↓ 见第 2 节 */
+	}
+	ctx->code[cx0].a = ctx->cx;
+
+	/* ---------- main { stmt_list } ---------- */
+	if (ctx->sym != mainsym)
+		error(ctx, 41);
+	getsym(ctx);
+	symset topFollow = SYMBIT(rbrace) | SYMBIT(period) | SYMBIT(semicolon);
+	block(ctx, 
+		/* ptx      */ &ctx->tx,
+		/* fsys     */ topFollow, /* FOLLOW(program)，含 rbrace/period 即可 */
+		/* isFunc   */ 0,		  /* ★ 不解析 return，不开返回槽 */
+		/* retParamCnt */ NULL);
+	gentrytable(ctx);
+	genforktable(ctx);
+
+	if (ctx->sym != rbrace)
+		error(ctx, 24);
+	getsym(ctx);
+	if (ctx->sym == nul && srceof(ctx))
+	{
+		/* 什么也不做——正常结束 */}
+		else
+		{
+			error(ctx, 9);
+		}
+		if (ctx->tableswitch) /* 输出符号表 */
+		{
+			for (int i = 1; i <= ctx->tx; i++)
+			{
+				switch (ctx->table[i].kind)
+				{
+				case param:
+					if (ctx->echo)
+					{
+						printf("    %d param %s ", i, ctx->table[i].name);
+						printf("adr=%d\n", ctx->table[i].adr);
+					}
+					if (ctx->ftable)
+					{
+						fprintf(ctx->ftable, "    %d param %s ", i, ctx->table[i].name);
+						fprintf(ctx->ftable, "adr=%d\n", ctx->table[i].adr);
+					}
+					break;
+				case variable:
+					if (ctx->echo)
+					{
+						printf("    %d var   %s ", i, ctx->table[i].name);
+						printf("addr=%d\n", ctx->table[i].adr);
+					}
+					if (ctx->ftable)
+					{
+						fprintf(ctx->ftable, "    %d var   %s ", i, ctx->table[i].name);
+						fprintf(ctx->ftable, "ddr=%d\n", ctx->table[i].adr);
+					}
+					break;
+				case function:
+					if (ctx->echo)
+					{
+						printf("    %d func  %s ", i, ctx->table[i].name);
+						printf("addr=%d size=%d\n", ctx->table[i].adr, ctx->table[i].size);
+					}
+					if (ctx->ftable)
+					{
+						fprintf(ctx->ftable, "    %d func  %s ", i, ctx->table[i].name);
+						fprintf(ctx->ftable, "addr=%d size=%d\n", ctx->table[i].adr, ctx->table[i].size);
+					}
+					break;
+				}
+			}
+		}
+		if (ctx->echo)
+			printf("\n");
+		if (ctx->ftable)
+			fprintf(ctx->ftable, "\n");
+}
+
+/* 开始一个语句序列（函数体和 if、while 等的 {...}），返回外层的序列，结束时由调用者恢复 */
+static int openlist(struct compiler *ctx)
+{
+	int outer = ctx->curlist;
+
+	if (ctx->nlists < listmax)
+	{
+		ctx->listparent[ctx->nlists] = outer;
+		ctx->curlist = ctx->nlists++;
+	}
+	else
+		ctx->curlist = -1; /* 超出容量：其中的声明和循环都不做范围分析 */
+	return outer;
+}
+
+/* 语句序列 list 是否就是 inner 或包围着它 */
+static bool enclosing(const struct compiler *ctx, int list, int inner)
+{
+	for (; inner >= 0; inner = ctx->listparent[inner])
+		if (inner == list)
+			return true;
+	return false;
+}
+
+static const struct arraydecl *finddecl(const struct compiler *ctx, int adr)
+{
+	int i;
+
+	for (i = ctx->ndecls - 1; i >= 0; i--)
+		if (ctx->decls[i].adr == adr)
+			return &ctx->decls[i];
+	return NULL;
+}
+
+/* 已读到 '['：编译下标直到 ']'，下标是单个变量时返回它的地址，否则返回 0 */
+static int subscript(struct compiler *ctx, symset fsys, int *ptx)
+{
+	int cx0 = ctx->cx;
+
+	getsym(ctx);
+	expression(ctx, fsys | SYMBIT(rbracket), ptx);
+	if (ctx->sym == rbracket)
+		getsym(ctx);
+	else
+		error(ctx, 82); /* 缺少 ']' */
+	return ctx->cx == cx0 + 1 && ctx->code[cx0].f == lod ? ctx->code[cx0].a : 0;
+}
+
+/* 登记刚生成的 ldx 或 stx：数组变量的地址 adr，下标变量的地址 idx */
+static void access(struct compiler *ctx, int adr, int idx)
+{
+	if (idx > 0 && ctx->naccesses < arraymax)
+	{
+		ctx->accesses[ctx->naccesses].pc = ctx->cx - 1;
+		ctx->accesses[ctx->naccesses].adr = adr;
+		ctx->accesses[ctx->naccesses++].idx = idx;
+	}
+}
+
+/* while 循环的范围分析（见 inbounds()） */
+struct loopvar
+{
+	int adr;		/* 循环变量 i 的地址，不能分析时为 0 */
+	int lenadr;		/* 条件为 i < n 时 n 的地址，否则为 0 */
+	int bound;		/* 条件为 i < 常数时为它，否则为 -1 */
+	int list;		/* 循环所在的语句序列 */
+	int inc;		/* 循环体中第一个顶层的 i = i + c 的地址，没有时为 -1 */
+	int nincs;		/* 顶层的 i = i + c 的个数 */
+	long long step; /* 它们的 c 之和 */
+};
+
+/*
+ * 条件 [cx0, cx1) 是 i < n 或 i < 常数，进入循环前刚执行过 i = 非负常数，
+ * 而且没有别处跳到循环开头时，记下 i 和上界
+ */
+static void loopvar(const struct compiler *ctx, struct loopvar *lv, int cx0, int cx1)
+{
+	const struct instruction *c = ctx->code;
+	int i;
+
+	lv->adr = lv->lenadr = lv->nincs = 0;
+	lv->bound = lv->inc = -1;
+	lv->list = ctx->curlist;
+	lv->step = 0;
+	if (cx1 != cx0 + 3 || c[cx0].f != lod || c[cx0 + 2].f != opr || c[cx0 + 2].a != 10)
+		return;
+	if (c[cx0 + 1].f == lod)
+		lv->lenadr = c[cx0 + 1].a;
+	else if (c[cx0 + 1].f == lit)
+		lv->bound = c[cx0 + 1].a;
+	else
+		return;
+	/* sto 之前的 lit 只能是整个表达式 */
+	if (cx0 < 2 || c[cx0 - 2].f != lit || c[cx0 - 2].a < 0 || c[cx0 - 1].f != sto || c[cx0 - 1].a != c[cx0].a)
+		return;
+	for (i = 0; i < cx0; i++)
+		if ((c[i].f == jmp || c[i].f == jpc) && c[i].a == cx0)
+			return;
+	lv->adr = c[cx0].a;
+}
+
+/* 循环体的一条顶层语句 [st, cx) 是 i = i + c（c 为非负常数）时记下它 */
+static void increment(const struct compiler *ctx, struct loopvar *lv, int st)
+{
+	const struct instruction *c = &ctx->code[st];
+
+	if (lv->adr == 0 || ctx->cx != st + 4 || c[0].f != lod || c[0].a != lv->adr || c[1].f != lit || c[1].a < 0 ||
+		c[2].f != opr || c[2].a != 2 || c[3].f != sto || c[3].a != lv->adr)
+		return;
+	if (lv->inc < 0)
+		lv->inc = st;
+	lv->nincs++;
+	lv->step += c[1].a;
+}
+
+/*
+ * while 循环的范围分析：i 从非负常数开始，循环体中只有顶层的 i = i + c 改变 i 时，
+ * 从条件 i < n 到第一个 i = i + c 之间都有 0 <= i < n，c 之和不超过 heapmax 时 i 也不会溢出。
+ * 这一段中的 a[i]，若 a 由包围循环的语句序列中的 let a[n] 声明（或声明的长度是不小于上界的常数），
+ * 下标就在界内；a 和 n 在声明之后不再赋值，由函数结束时的 safebounds() 确认
+ */
+static void inbounds(struct compiler *ctx, const struct loopvar *lv, int body)
+{
+	int end = lv->inc >= 0 ? lv->inc : ctx->cx, n = 0, i;
+
+	if (lv->adr == 0 || lv->step > heapmax)
+		return;
+	for (i = body; i < ctx->cx; i++)
+		if (ctx->code[i].f == sto && ctx->code[i].a == lv->adr)
+			n++;
+	if (n != lv->nincs)
+		return; /* 循环体中别处还给 i 赋值 */
+	for (i = 0; i < ctx->naccesses; i++)
+	{
+		const struct arrayaccess *x = &ctx->accesses[i];
+		const struct arraydecl *d;
+
+		if (x->pc < body || x->pc >= end || x->idx != lv->adr || (d = finddecl(ctx, x->adr)) == NULL ||
+			!enclosing(ctx, d->list, lv->list))
+			continue;
+		if (lv->lenadr ? d->lenadr != lv->lenadr : d->len < lv->bound)
+			continue;
+		if (ctx->nsafe < arraymax)
+			ctx->safe[ctx->nsafe++] = *x;
+	}
+}
+
+/*
+ * 函数结束：数组变量只在声明处赋值、长度变量只在数组声明之前赋值时，
+ * 范围分析证明在界内的访问改为不检查下标的 ldxu、stxu。start 是函数的 ini 指令
+ */
+static void safebounds(struct compiler *ctx, int start)
+{
+	int *stores, *last, i;
+
+	if (ctx->nsafe > 0)
+	{
+		stores = calloc(ctx->dx + 1, sizeof(int)); /* 每个地址的 sto 数和最后一条的位置 */
+		last = calloc(ctx->dx + 1, sizeof(int));
+		for (i = start; i < ctx->cx; i++)
+		{
+			if (ctx->code[i].f == sto && ctx->code[i].a >= 0 && ctx->code[i].a <= ctx->dx)
+			{
+				stores[ctx->code[i].a]++;
+				last[ctx->code[i].a] = i;
+			}
+		}
+		for (i = 0; i < ctx->nsafe; i++)
+		{
+			const struct arraydecl *d = finddecl(ctx, ctx->safe[i].adr);
+			struct instruction *x = &ctx->code[ctx->safe[i].pc];
+
+			if (stores[d->adr] != 1 || (d->lenadr > 0 && stores[d->lenadr] > 0 && last[d->lenadr] > d->sto))
+				continue;
+			if (x->f == ldx) /* 嵌套的循环可能重复登记同一次访问 */
+				x->f = ldxu;
+			else if (x->f == stx)
+				x->f = stxu;
+		}
+		free(stores);
+		free(last);
+	}
+	ctx->ndecls = ctx->naccesses = ctx->nsafe = 0;
+}
+
+/* 已读取到关键字 function 或 generator */
+void parse_function_header(struct compiler *ctx, symset fsys)
+{
+	ctx->ingen = ctx->sym == gensym;
+	getsym(ctx); /* 跳过 'function' */
+
+	if (ctx->sym != ident)
+		error(ctx, 1);
+	ctx->curFuncIdx = enter(ctx, function, &ctx->tx, &ctx->dx);
+	getsym(ctx); /* 跳过函数名 */
+
+	ctx->table[ctx->curFuncIdx].adr = ctx->cx + 1;
+
+	/* 保存进入本函数前的 dx 值 */
+	int savedDx = ctx->dx;
+	/* 重置 dx 为 3，让函数在自己的作用域内从 3 开始分配 SL/RA/ret-slot */
+	ctx->dx = 3;
+
+	int paramCnt = 0; /* ← 只在这里声明一次 */
+
+	/* 直接把 '(' 及后续全部交给 block() */
+	block(ctx, &ctx->tx, fsys, ctx->ingen ? 2 : 1, /* isFunc = 1 → 要解析形参和唯一 return */ &paramCnt); /* 回传形参个数 */
+	ctx->ingen = false;
+
+	/* block() 结束后：形参个数和入口地址已准备好 */
+	ctx->table[ctx->curFuncIdx].paramCnt = paramCnt; /* 写入符号表 */
+	ctx->dx = savedDx;
+}
+
+/*
+ * 编译程序主体
+ *
+ * lev:    当前分程序所在层
+ * tx:     符号表当前尾指针
+ * fsys:   当前模块后继符号集合
+ */
+void block(struct compiler *ctx, int *ptx, symset fsys,
+		   int isFunc,		 /* 1 = 函数体, 2 = 生成器函数体, 0 = main/普通块 */
+		   int *retParamCnt) /* 仅 isFunc==1 时才用来回传形参个数 */
+{
+	int tx0 = *ptx; /* 记录本层符号表基准 */
+
+	/* ---------- 1. 只有函数体才预留入口 jmp ---------- */
+	int cx0 = -1; /* 非函数体保持 -1 */
+	if (isFunc)
+	{
+		cx0 = ctx->cx;	 /* 记录 jmp 指令下标，稍后回填 */
+		gen(ctx, jmp, 0); /* 先占个坑 */
+	}
+
+	/* ---------- 2. 解析形参 (仅 isFunc==1) ---------- */
+	if (isFunc && retParamCnt)
+	{
+		*retParamCnt = 0;
+		if (ctx->sym == lparen)
+		{
+			do
+			{
+				getsym(ctx); /* 读标识符 */
+				if (ctx->sym != ident)
+					error(ctx, 1);
+
+				enter(ctx, param, ptx, &ctx->dx); /* adr = dx++ */
+				(*retParamCnt)++;
+
+				getsym(ctx); /* 读下一个符号 */
+			} while (ctx->sym == comma);
+
+			if (ctx->sym != rparen)
+				error(ctx, 22);
+			getsym(ctx); /* 越过 ')' */
+		}
+	}
+
+	/* ---------- 3. 进入 { stmt_list } ---------- */
+	if (ctx->sym != lbrace)
+		error(ctx, 34);
+	getsym(ctx); /* 越过 '{' */
+
+	if (isFunc == 2)
+		gen(ctx, opr, 23); /* 生成器的入口：建立生成器，返回句柄 */
+	int ini_pos = ctx->cx; /* 记录下这条 ini 指令所在的 code[] 下标 */
+	int inipos0 = ctx->inipos;
+	gen(ctx, ini, 0);	  /* 暂时填 0，后续在第 6 步回填成正确的 dx */
+	ctx->inipos = ini_pos; /* 本块中的 try 由它得到栈帧的大小 */
+	symset inside = addset(statbegsys, fsys);
+	inside |= SYMBIT(rbrace);	 /* 块结束符 */
+	inside |= SYMBIT(semicolon); /* 语句间分号 */
+
+	ctx->curlist = -1;
+	openlist(ctx);
+	while (inset(ctx->sym, statbegsys))
+	{
+		statement(ctx, inside, ptx, &ctx->dx);
+		if (ctx->sym == semicolon)
+			getsym(ctx); /* 可选分号 */
+	}
+	ctx->curlist = -1;
+
+	/* ---------- 4. 解析唯一 return (仅函数体) ---------- */
+	if (isFunc)
+	{
+		if (ctx->sym != returnsym)
+			error(ctx, 50);
+		getsym(ctx);
+
+		symset exprFollow = addset(facbegsys, fsys);
+		exprFollow |= SYMBIT(semicolon); /* ; 跟在表达式后 */
+		expression(ctx, exprFollow, ptx);
+		gen(ctx, sto, 2);
+		if (ctx->sym != semicolon)
+			error(ctx, 10);
+
+		getsym(ctx);
+	}
+
+	/* ---------- 5. 读块结束 '}' ---------- */
+	if (ctx->sym != rbrace)
+		error(ctx, 24);
+	getsym(ctx);
+
+	/* ---------- 6. 回填入口 & 生成退出指令 ---------- */
+	int extra = ctx->opmax > stackslack ? ctx->opmax - stackslack : 0; /* ini 除栈帧之外还要预留的 */
+	if (extra > stacksize)
+		extra = stacksize; /* 执行到这里必定溢出 */
+	if (isFunc)
+	{
+		ctx->code[cx0].a = ini_pos; /* jmp 跳到正文首指令 */
+		ctx->code[ini_pos].a = ctx->dx | extra << 16;  /* +1 给返回值槽 */
+		gen(ctx, opr, 18);		   /* return */
+		ctx->table[ctx->curFuncIdx].size = ctx->dx - 3 + 1;
+	}
+	else
+	{
+		ctx->code[ini_pos].a = ctx->dx | extra << 16;
+		gen(ctx, opr, 0); /* 程序或块结束 */
+	}
+	safebounds(ctx, ini_pos);
+	ctx->inipos = inipos0;
+}
+
+/*
+ * 在符号表中加入一项
+ *
+ * k:      标识符的种类为const，var或procedure
+ * ptx:    符号表尾指针的指针，为了可以改变符号表尾指针的值
+ * lev:    标识符所在的层次
+ * pdx:    dx为当前应分配的变量的相对地址，分配后要增加1
+ *
+ */
+int enter(struct compiler *ctx, enum object k, int *ptx, int *pdx)
+{
+	if (*ptx + 1 >= txmax)
+	{
+		fatal(ctx, "Symbol table overflow!");
+	}
+
+	++(*ptx);
+	if (ctx->stats)
+		ctx->stats->symbols++;
+	strcpy(ctx->table[*ptx].name, ctx->id);
+	ctx->table[*ptx].kind = k;
+	ctx->table[*ptx].size = 0;
+	ctx->table[*ptx].paramCnt = 0;
+	ctx->table[*ptx].attr = 0;
+
+	switch (k)
+	{
+	case variable:					/* let 声明 */
+		ctx->table[*ptx].adr = (*pdx)++; /* 从 dx 开始递增 */
+		break;
+
+	case param:						/* 形参 */
+		ctx->table[*ptx].adr = (*pdx)++; /* 与变量共用地址系 */
+		ctx->table[*ptx].attr = 1;		/* bit0 = isParam  */
+		break;
+
+	case function: /* function / main */
+		/* 入口地址稍后在 block() 中回填 */
+		ctx->table[*ptx].adr = 0;
+		break;
+	}
+	return *ptx;
+}
+
+/*
+ * 查找标识符在符号表中的位置，从tx开始倒序查找标识符
+ * 找到则返回在符号表中的位置，否则返回0
+ *
+ * id:    要查找的名字
+ * tx:    当前符号表尾指针
+ */
+int position(struct compiler *ctx, char *id, int tx)
+{
+	int i;
+	unsigned long long start = ctx->stats ? profclock() : 0;
+
+	strcpy(ctx->table[0].name, id);
+	i = tx;
+	while (strcmp(ctx->table[i].name, id) != 0)
+	{
+		i--;
+	}
+	if (ctx->stats)
+	{
+		ctx->stats->lookupclock += profclock() - start;
+		ctx->stats->lookups++;
+		ctx->stats->probes += tx - i + 1;
+	}
+	return i;
+}
+
+/*
+ * 输出目标代码清单
+ */
+void listcode(struct compiler *ctx, int cx0)
+{
+	int i;
+	if (ctx->listswitch)
+	{
+		if (ctx->echo)
+			printf("\n");
+		for (i = cx0; i < ctx->cx; i++)
+		{
+			if (ctx->echo)
+				printf("%d %s %d\n", i, mnemonic[ctx->code[i].f], ctx->code[i].a);
+		}
+	}
+}
+
+/*
+ * 把目标代码写成二进制目标文件，成功返回 0
+ */
+int writeobject(FILE *fobj, const struct instruction *code, int cx)
+{
+	int head[3] = {L25O_MAGIC, L25O_VERSION, cx};
+	int i;
+
+	if (fwrite(head, sizeof(int), 3, fobj) != 3)
+		return -1;
+	for (i = 0; i < cx; i++)
+	{
+		int ins[2] = {code[i].f, code[i].a};
+		if (fwrite(ins, sizeof(int), 2, fobj) != 2)
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ * 读入二进制目标文件，指令存放在新分配的 *pcode 中，成功返回 0
+ */
+int readobject(FILE *fobj, struct instruction **pcode, int *pcx)
+{
+	int head[3];
+	int i;
+	struct instruction *code;
+
+	if (fread(head, sizeof(int), 3, fobj) != 3 || head[0] != L25O_MAGIC ||
+		head[1] != L25O_VERSION || head[2] <= 0)
+		return -1;
+	if ((code = malloc(sizeof(struct instruction) * head[2])) == NULL)
+		return -1;
+	for (i = 0; i < head[2]; i++)
+	{
+		int ins[2];
+		if (fread(ins, sizeof(int), 2, fobj) != 2 || ins[0] < 0 || ins[0] >= fctnum)
+		{
+			free(code);
+			return -1;
+		}
+		code[i].f = (enum fct)ins[0];
+		code[i].a = ins[1];
+	}
+	*pcode = code;
+	*pcx = head[2];
+	return 0;
+}
+
+/*
+ * 代码映像的 FNV-1a 散列，按每条指令的 f、a 两个 32 位整数计算，用于确认文件与程序相符
+ */
+unsigned long long codehash(const struct instruction *code, int cx)
+{
+	unsigned long long h = 14695981039346656037ULL;
+	int i, j;
+
+	for (i = 0; i < cx; i++)
+	{
+		unsigned int w[2] = {(unsigned int)code[i].f, (unsigned int)code[i].a};
+		for (j = 0; j < 8; j++)
+		{
+			h ^= (w[j / 4] >> (8 * (j % 4))) & 0xff;
+			h *= 1099511628211ULL;
+		}
+	}
+	return h;
+}
+
+/*
+ * 输出所有目标代码
+ */
+void listall(struct compiler *ctx)
+{
+	int i;
+	if (ctx->listswitch)
+	{
+		for (i = 0; i < ctx->cx; i++)
+		{
+			if (ctx->echo)
+				printf("%d %s %d\n", i, mnemonic[ctx->code[i].f], ctx->code[i].a);
+			if (ctx->fcode)
+				fprintf(ctx->fcode, "%d %s %d\n", i, mnemonic[ctx->code[i].f], ctx->code[i].a);
+		}
+	}
+}
+
+void call_handle(struct compiler *ctx, int pos)
+{
+	if (ctx->table[pos].kind != function)
+		error(ctx, 70); /* 70: 尝试调用非函数 */
+
+	int argCnt = 0;
+
+	getsym(ctx); /* 跳过 '(' */
+	if (ctx->sym != rparen)
+	{ /* 非空实参表 */
+		while (1)
+		{
+			symset nxtlev = facbegsys | SYMBIT(comma) | SYMBIT(rparen);
+
+			expression(ctx, nxtlev, &ctx->tx); /* 实参表达式求值，结果在栈顶 */
+			argCnt++;
+
+			gen(ctx, opr, 17);
+
+			if (ctx->sym == comma)
+			{
+				getsym(ctx); /* 继续下一实参 */
+				continue;
+			}
+			else if (ctx->sym == rparen)
+			{
+				break; /* 实参列表结束 */
+			}
+			else
+			{
+				error(ctx, 22); /* 缺少 ')' */
+				break;
+			}
+		}
+	}
+
+	if (ctx->sym != rparen)
+		error(ctx, 22); /* 确保 ')' */
+	getsym(ctx);	   /* 跳过 ')' */
+
+	/* 形参与实参个数核对 */
+	if (argCnt != ctx->table[pos].paramCnt)
+		error(ctx, 60); /* 60: 参数个数不符 */
+
+	/* 生成调用指令 */
+	gen(ctx, cal, ctx->table[pos].adr);
+
+	if (ctx->sym != semicolon)
+		error(ctx, 10); /* 缺少分号 */
+	getsym(ctx);	   /* 跳过 ';' */
+}
+
+/* 内建的数组操作：名字、实参个数、opr 编号、是否有值。不是保留字，同名的函数、变量优先 */
+static const struct
+{
+	char name[al];
+	int nargs;
+	int op;
+	bool value;
+} builtins[] = {
+	{"copy", 2, 31, false}, {"dot", 2, 28, true}, {"fill", 2, 29, false}, {"scale", 2, 30, false},
+	{"sum", 1, 27, true}};
+
+/* 名为 id 的内建操作，没有时返回 -1 */
+static int findbuiltin(const char *id)
+{
+	int k;
+
+	for (k = 0; k < (int)(sizeof(builtins) / sizeof(builtins[0])); k++)
+		if (strcmp(builtins[k].name, id) == 0)
+			return k;
+	return -1;
+}
+
+/*
+ * 调用内建操作 k：已读到 '('，实参依次压栈，由一条 opr 完成整个数组的操作
+ */
+static void builtin_call(struct compiler *ctx, int k, symset fsys, int *ptx)
+{
+	int n = 0;
+
+	getsym(ctx); /* 跳过 '(' */
+	if (ctx->sym != rparen)
+	{
+		while (1)
+		{
+			expression(ctx, addset(facbegsys, fsys) | SYMBIT(comma) | SYMBIT(rparen), ptx);
+			n++;
+			if (ctx->sym != comma)
+				break;
+			getsym(ctx);
+		}
+	}
+	if (ctx->sym == rparen)
+		getsym(ctx);
+	else
+		error(ctx, 22); /* 缺少 ')' */
+	if (n != builtins[k].nargs)
+		error(ctx, 60); /* 参数个数不符 */
+	gen(ctx, opr, builtins[k].op);
+}
+
+/*
+ * 语句处理
+ */
+void statement(struct compiler *ctx, symset fsys, int *ptx, int *pdx)
+{
+	symset nxtlev; /* FOLLOW 集合 */
+	int outer;	   /* 外层的语句序列 */
+
+	if (ctx->stats)
+		ctx->stats->statements++;
+
+	/* ---------- let 声明 ---------- */
+	if (ctx->sym == letsym)
+	{
+		getsym(ctx); /* 读取 ident */
+		if (ctx->sym != ident)
+			error(ctx, 1);
+
+		enter(ctx, variable, ptx, pdx); /* 建符号，adr = dx++ */
+		int varIdx = *ptx;		   /* 记录下标 */
+
+		getsym(ctx); /* 看是否有初始化 */
+
+		if (ctx->sym == becomes) /* let x = expr; */
+		{
+			getsym(ctx);
+			nxtlev = addset(facbegsys, fsys);
+			expression(ctx, nxtlev, ptx);
+			gen(ctx, sto, ctx->table[varIdx].adr);
+		}
+		else if (ctx->sym == lbracket) /* let a[n]; 新建数组，变量中是句柄 */
+		{
+			int cx0 = ctx->cx;
+
+			getsym(ctx);
+			nxtlev = addset(facbegsys, fsys) | SYMBIT(rbracket);
+			expression(ctx, nxtlev, ptx);
+			if (ctx->sym == rbracket)
+				getsym(ctx);
+			else
+				error(ctx, 82); /* 缺少 ']' */
+			gen(ctx, opr, 26);
+			gen(ctx, sto, ctx->table[varIdx].adr);
+			if (ctx->ndecls < arraymax)
+			{ /* 长度是单个变量或常数时登记，供范围分析用 */
+				struct arraydecl *d = &ctx->decls[ctx->ndecls++];
+
+				d->adr = ctx->table[varIdx].adr;
+				d->sto = ctx->cx - 1;
+				d->list = ctx->curlist;
+				d->lenadr = ctx->cx == cx0 + 3 && ctx->code[cx0].f == lod ? ctx->code[cx0].a : 0;
+				d->len = ctx->cx == cx0 + 3 && ctx->code[cx0].f == lit ? ctx->code[cx0].a : -1;
+			}
+		}
+
+		if (ctx->sym != semicolon)
+			error(ctx, 10);
+		getsym(ctx);
+	}
+
+	/* ---------- 赋值 / 函数调用 ---------- */
+	else if (ctx->sym == ident)
+	{
+		int i = position(ctx, ctx->id, *ptx);
+		int k = i == 0 ? findbuiltin(ctx->id) : -1;
+		getsym(ctx);
+		if (k >= 0 && ctx->sym == lparen)
+		{ /* ---- 内建的 fill、scale、copy ---- */
+			if (builtins[k].value)
+				error(ctx, 83); /* sum、dot 不能作为语句 */
+			builtin_call(ctx, k, fsys, ptx);
+			if (ctx->sym != semicolon)
+				error(ctx, 10);
+			getsym(ctx);
+		}
+		else if (ctx->sym == becomes)
+		{ /* ident 后面直接跟 '=' */
+			if (ctx->table[i].kind == function)
+				error(ctx, 61); /* 函数名不能出现在赋值左边 */
+			getsym(ctx);	   /* 跳过 '=' */
+			symset nxtlev = addset(facbegsys, fsys);
+			nxtlev |= SYMBIT(semicolon); /* ; 可跟在表达式后 */
+			expression(ctx, nxtlev, ptx);
+			if (ctx->loopfloor > 0 && i > 0 && ctx->table[i].adr < ctx->loopfloor)
+				error(ctx, 80); /* parfor 的各次迭代不能给循环体外的变量赋值 */
+			gen(ctx, sto, ctx->table[i].adr); /* 把值写回变量 */
+			if (ctx->sym != semicolon)
+				error(ctx, 10);
+			getsym(ctx); /* 跳过 ';' */
+		}
+		else if (ctx->sym == lparen)
+		{ /* ---- 函数调用 ---- */
+			call_handle(ctx, i);
+		}
+		else if (ctx->sym == lbracket)
+		{ /* ---- 数组元素赋值 a[i] = e：先求下标，再求值 ---- */
+			int idx;
+
+			if (ctx->table[i].kind == function)
+				error(ctx, 61);
+			idx = subscript(ctx, fsys | SYMBIT(becomes), ptx);
+			if (ctx->sym != becomes)
+				error(ctx, 13); /* 缺少 '=' */
+			else
+				getsym(ctx);
+			nxtlev = addset(facbegsys, fsys);
+			nxtlev |= SYMBIT(semicolon);
+			expression(ctx, nxtlev, ptx);
+			gen(ctx, stx, ctx->table[i].adr);
+			access(ctx, ctx->table[i].adr, idx);
+			if (ctx->sym != semicolon)
+				error(ctx, 10);
+			getsym(ctx);
+		}
+		else
+			error(ctx, 33);
+	}
+
+	/* ---------- if 语句 ---------- */
+	else if (ctx->sym == ifsym)
+	{
+		getsym(ctx);
+		if (ctx->sym != lparen)
+			error(ctx, 23); /* 23：缺少 '(' */
+		getsym(ctx);	   /* 吃掉 '(' */
+
+		/* --- 解析 condition --- */
+		nxtlev = addset(statbegsys, fsys);
+		nxtlev |= SYMBIT(rparen);
+		condition(ctx, nxtlev, ptx);
+
+		/* --- 强制检测右括号 --- */
+		if (ctx->sym != rparen)
+			error(ctx, 22); /* 22：缺少 ')' */
+		getsym(ctx);	   /* 吃掉 ')' */
+
+		int cx1 = ctx->cx;
+		gen(ctx, jpc, 0); /* 条件假跳转 */
+
+		if (ctx->sym != lbrace)
+			error(ctx, 34);
+		getsym(ctx);
+		symset bodyFollow = addset(statbegsys, fsys);
+		bodyFollow |= SYMBIT(rbrace);	 /* 右花括号算作语句结束 */
+		bodyFollow |= SYMBIT(semicolon); /* 语句之后可选分号 */
+
+		/* 循环消化块内所有语句 */
+		outer = openlist(ctx);
+		while (inset(ctx->sym, statbegsys))
+		{
+			statement(ctx, bodyFollow, ptx, pdx);
+			if (ctx->sym == semicolon)
+				getsym(ctx); /* 如果当前符号是分号，就先把它吞掉 */
+		}
+		ctx->curlist = outer;
+		if (ctx->sym != rbrace)
+			error(ctx, 24); /* 块没有以 '}' 结束 */
+		getsym(ctx);	   /* 吃掉 '}' */
+
+		if (ctx->sym == elsesym) /* 可选 else */
+		{
+			int cx2 = ctx->cx;
+			gen(ctx, jmp, 0);	  /* if 真分支跳过 else */
+			ctx->code[cx1].a = ctx->cx; /* 回填 jpc */
+
+			getsym(ctx); /* 读 else */
+			if (ctx->sym != lbrace)
+				error(ctx, 34);
+			getsym(ctx);
+			symset bodyFollow = addset(statbegsys, fsys);
+			bodyFollow |= SYMBIT(rbrace);	 /* 右花括号算作语句结束 */
+			bodyFollow |= SYMBIT(semicolon); /* 语句之后可选分号 */
+
+			/* 循环消化块内所有语句 */
+			outer = openlist(ctx);
+			while (inset(ctx->sym, statbegsys))
+			{
+				statement(ctx, bodyFollow, ptx, pdx);
+				if (ctx->sym == semicolon)
+					getsym(ctx); /* 如果当前符号是分号，就先把它吞掉 */
+			}
+			ctx->curlist = outer;
+			if (ctx->sym != rbrace)
+				error(ctx, 24);	  /* 块没有以 '}' 结束 */
+			getsym(ctx);		  /* 吃掉 '}' */
+			ctx->code[cx2].a = ctx->cx; /* 回填 jmp */
+		}
+		else
+			ctx->code[cx1].a = ctx->cx; /* 无 else，直接回填 */
+	}
+
+	/* ---------- while 语句 ---------- */
+	else if (ctx->sym == whilesym)
+	{
+		int cx0 = ctx->cx; /* 循环开头 */
+		getsym(ctx);
+		if (ctx->sym != lparen)
+			error(ctx, 23); /* 23：缺少 '(' */
+		getsym(ctx);	   /* 吃掉 '(' */
+
+		/* --- 解析 condition --- */
+		nxtlev = addset(statbegsys, fsys);
+		nxtlev |= SYMBIT(rparen);
+		condition(ctx, nxtlev, ptx);
+
+		/* --- 强制检测右括号 --- */
+		if (ctx->sym != rparen)
+			error(ctx, 22); /* 22：缺少 ')' */
+		getsym(ctx);	   /* 吃掉 ')' */
+
+		int cx1 = ctx->cx;
+		gen(ctx, jpc, 0);
+
+		if (ctx->sym != lbrace)
+			error(ctx, 34);
+		getsym(ctx);
+		symset bodyFollow = addset(statbegsys, fsys);
+		bodyFollow |= SYMBIT(rbrace);	 /* 右花括号算作语句结束 */
+		bodyFollow |= SYMBIT(semicolon); /* 语句之后可选分号 */
+
+		/* 循环消化块内所有语句，记下顶层的 i = i + c，供范围分析用 */
+		struct loopvar lv;
+		int cx2;
+
+		loopvar(ctx, &lv, cx0, cx1);
+		outer = openlist(ctx);
+		while (inset(ctx->sym, statbegsys))
+		{
+			cx2 = ctx->cx;
+			statement(ctx, bodyFollow, ptx, pdx);
+			increment(ctx, &lv, cx2);
+			if (ctx->sym == semicolon)
+				getsym(ctx); /* 如果当前符号是分号，就先把它吞掉 */
+		}
+		ctx->curlist = outer;
+		if (ctx->sym != rbrace)
+			error(ctx, 24); /* 块没有以 '}' 结束 */
+		getsym(ctx);	   /* 吃掉 '}' */
+
+		inbounds(ctx, &lv, cx1 + 1);
+		gen(ctx, jmp, cx0);
+		ctx->code[cx1].a = ctx->cx; /* 回填假跳转 */
+	}
+
+	/* ---------- parfor 语句 ---------- */
+	/*
+	 * parfor (i = lo, hi) { ... } 让 i 从 lo 到 hi - 1 各执行一次循环体，hi 只在开始时求值一次
+	 * 生成的代码就是一个 while 循环，顺序执行时 opr 21 和 opr 22 什么也不做；
+	 * 并行执行时 opr 21 按紧跟着的 lod i、lod hi、opr 10、jpc 找到循环变量、上界和循环末尾的 opr 22，
+	 * 把 [lo, hi) 分段交给线程池（见 par_loop()）。各次迭代互不依赖：循环体不能给循环体之外的变量赋值
+	 */
+	else if (ctx->sym == parforsym)
+	{
+		int i = 0, hv, cx0, cx1, floor0;
+
+		getsym(ctx);
+		if (ctx->sym != lparen)
+			error(ctx, 23);
+		getsym(ctx);
+		if (ctx->sym != ident)
+			error(ctx, 1);
+		else if ((i = position(ctx, ctx->id, *ptx)) == 0)
+			error(ctx, 11);
+		else if (ctx->table[i].kind == function)
+			error(ctx, 61);
+		else if (ctx->loopfloor > 0 && ctx->table[i].adr < ctx->loopfloor)
+			error(ctx, 80); /* 外层 parfor 之外的变量 */
+		getsym(ctx);
+		if (ctx->sym != becomes)
+			error(ctx, 13);
+		getsym(ctx);
+		expression(ctx, addset(fsys, SYMBIT(comma) | SYMBIT(rparen)), ptx);
+		gen(ctx, sto, ctx->table[i].adr);
+		if (ctx->sym != comma)
+			error(ctx, 5);
+		getsym(ctx);
+		expression(ctx, addset(fsys, SYMBIT(rparen)), ptx);
+		hv = (*pdx)++; /* 上界放在一个没有名字的变量中 */
+		gen(ctx, sto, hv);
+		if (ctx->sym != rparen)
+			error(ctx, 22);
+		getsym(ctx);
+
+		gen(ctx, opr, 21);
+		cx0 = ctx->cx;
+		gen(ctx, lod, ctx->table[i].adr);
+		gen(ctx, lod, hv);
+		gen(ctx, opr, 10);
+		cx1 = ctx->cx;
+		gen(ctx, jpc, 0);
+
+		if (ctx->sym != lbrace)
+			error(ctx, 34);
+		getsym(ctx);
+		symset bodyFollow = addset(statbegsys, fsys);
+		bodyFollow |= SYMBIT(rbrace);	 /* 右花括号算作语句结束 */
+		bodyFollow |= SYMBIT(semicolon); /* 语句之后可选分号 */
+
+		floor0 = ctx->loopfloor;
+		ctx->loopfloor = *pdx; /* 循环体中声明的变量从这里开始 */
+		outer = openlist(ctx);
+		while (inset(ctx->sym, statbegsys))
+		{
+			statement(ctx, bodyFollow, ptx, pdx);
+			if (ctx->sym == semicolon)
+				getsym(ctx); /* 如果当前符号是分号，就先把它吞掉 */
+		}
+		ctx->curlist = outer;
+		ctx->loopfloor = floor0;
+		if (ctx->sym != rbrace)
+			error(ctx, 24); /* 块没有以 '}' 结束 */
+		getsym(ctx);	   /* 吃掉 '}' */
+
+		gen(ctx, lod, ctx->table[i].adr);
+		gen(ctx, lit, 1);
+		gen(ctx, opr, 2);
+		gen(ctx, sto, ctx->table[i].adr);
+		gen(ctx, jmp, cx0);
+		ctx->code[cx1].a = ctx->cx; /* 回填假跳转 */
+		gen(ctx, opr, 22);
+	}
+
+	/* ---------- input 语句 ---------- */
+	else if (ctx->sym == inputsym)
+	{
+		getsym(ctx);
+		if (ctx->sym != lparen)
+			error(ctx, 26);
+		getsym(ctx);
+		while (1)
+		{
+			if (ctx->sym != ident)
+				error(ctx, 1); /* 缺少标识符 */
+			int i = position(ctx, ctx->id, *ptx);
+			if (i == -1)
+				error(ctx, 11); /* 未声明的标识符 */
+			else if (ctx->loopfloor > 0 && ctx->table[i].adr < ctx->loopfloor)
+				error(ctx, 80);
+
+			/* 先生成 OPR 16 指令：读入一个整数到栈顶 */
+			gen(ctx, opr, 16);
+
+			/* 然后把栈顶的值存到该变量的地址 */
+			gen(ctx, sto, ctx->table[i].adr);
+
+			/* 读下一个符号，看是逗号还是右括号 */
+			getsym(ctx);
+
+			if (ctx->sym == comma)
+			{
+				getsym(ctx); /* 吃掉 ','，处理下一个变量 */
+				continue;
+			}
+			break; /* 不是逗号，就退出循环 */
+		}
+
+		if (ctx->sym != rparen)
+			error(ctx, 22);
+		getsym(ctx);
+
+		if (ctx->sym != semicolon)
+			error(ctx, 10);
+		getsym(ctx);
+	}
+
+	/* ---------- output 语句 ---------- */
+	else if (ctx->sym == outputsym)
+	{
+		getsym(ctx);
+		if (ctx->sym != lparen)
+			error(ctx, 34);
+		getsym(ctx);
+
+		while (1)
+		{
+			symset exprFollow = addset(facbegsys, fsys);
+			/* 在表达式后允许看到 ',' 或 ')' */
+			exprFollow |= SYMBIT(comma) | SYMBIT(rparen);
+
+			expression(ctx, exprFollow, ptx);
+			/* 每解析完一个表达式，就生成一次“打印栈顶”指令 */
+			gen(ctx, opr, 14); /* 14: 输出栈顶整数 */
+
+			if (ctx->sym == comma)
+			{
+				getsym(ctx); /* 逗号分隔，继续下一个表达式 */
+				continue;
+			}
+			break; /* 没有逗号，就退出循环，准备读右括号 */
+		}
+
+		if (ctx->sym != rparen)
+			error(ctx, 22);
+		getsym(ctx);
+
+		if (ctx->sym != semicolon)
+			error(ctx, 10);
+		getsym(ctx);
+	}
+
+	/* ---------- return 语句（仅函数体允许） ---------- */
+	else if (ctx->sym == returnsym)
+	{
+		getsym(ctx);
+		nxtlev = addset(facbegsys, fsys);
+		expression(ctx, nxtlev, ptx); /* 返回值压栈 */
+
+		gen(ctx, sto, 3);  /* 写到 b-1 处 (约定的返回槽) */
+		gen(ctx, opr, 18); /* 操作 0 0 = 返回 */
+
+		if (ctx->sym != semicolon)
+			error(ctx, 10);
+		getsym(ctx);
+	}
+	/* ---------- yield 语句（仅生成器允许）：把值交给 next，在此挂起 ---------- */
+	else if (ctx->sym == yieldsym)
+	{
+		if (!ctx->ingen)
+			error(ctx, 81); /* yield 只能出现在生成器中 */
+		getsym(ctx);
+		nxtlev = addset(facbegsys, fsys);
+		expression(ctx, nxtlev, ptx);
+		gen(ctx, opr, 25);
+
+		if (ctx->sym != semicolon)
+			error(ctx, 10);
+		getsym(ctx);
+	}
+	/* ---------- try-catch 语句 ---------- */
+	else if (ctx->sym == trysym)
+	{
+		getsym(ctx); /* 跳过 try */
+
+		/* ===== 1. try 区域从这里开始，不生成任何指令 ===== */
+		int tryStart = ctx->cx;
+
+		/* ===== 2. 解析 try { … } ===== */
+		if (ctx->sym != lbrace)
+			error(ctx, 34); /* 缺少 '{' */
+		getsym(ctx);	   /* 吞掉 '{' */
+
+		symset tryFollow = addset(statbegsys, fsys);
+		tryFollow |= SYMBIT(rbrace);
+
+		outer = openlist(ctx);
+		while (inset(ctx->sym, statbegsys))
+		{
+			statement(ctx, tryFollow, ptx, pdx);
+			if (ctx->sym == semicolon)
+				getsym(ctx);
+		}
+		ctx->curlist = outer;
+		if (ctx->sym != rbrace)
+			error(ctx, 24); /* 缺少 '}' */
+		getsym(ctx);	   /* 吞掉 '}' */
+
+		/* try 正常走完，跳过 catch；try 区域到这条 jmp 为止（不含） */
+		int jmpIdx = ctx->cx;
+		gen(ctx, jmp, 0); /* 稍后回填到 catch 之后 */
+
+		/* ===== 3. 解析 catch { … } ===== */
+		if (ctx->sym != catchsym)
+			error(ctx, 88); /* 缺少 catch */
+		getsym(ctx);
+
+		if (ctx->sym != lbrace)
+			error(ctx, 34);
+		getsym(ctx);
+
+		int catchStart = ctx->cx; /* catch 起始地址，即处理程序的入口 */
+		if (ctx->ntries >= trymax)
+			fatal(ctx, "Too many try statements!");
+		ctx->tries[ctx->ntries].start = tryStart;
+		ctx->tries[ctx->ntries].end = jmpIdx;
+		ctx->tries[ctx->ntries].handler = catchStart;
+		ctx->tries[ctx->ntries].ini = ctx->inipos;
+		ctx->ntries++; /* 内层的 try 先结束，先登记 */
+
+		symset catchFollow = addset(statbegsys, fsys);
+		catchFollow |= SYMBIT(rbrace);
+
+		outer = openlist(ctx);
+		while (inset(ctx->sym, statbegsys))
+		{
+			statement(ctx, catchFollow, ptx, pdx);
+			if (ctx->sym == semicolon)
+				getsym(ctx);
+		}
+		ctx->curlist = outer;
+		if (ctx->sym != rbrace)
+			error(ctx, 24);
+		getsym(ctx);
+
+		/* ===== 4. 回填 “跳过 catch” ===== */
+		ctx->code[jmpIdx].a = ctx->cx;
+	}
+
+	else
+	{
+		/* 空语句或非法开头：交给上层 test() 处理 */
+	}
+}
+
+/*
+ * 表达式处理
+ */
+/*
+ * 结束表达式中正在登记的一组兄弟调用：运算指令要取用栈上的调用结果，结果必须在它之前取回
+ * 有两次以上调用的组登记下来，超出容量的组照常顺序执行
+ */
+static void endgroup(struct compiler *ctx)
+{
+	struct forkgroup *g = ctx->group;
+
+	if (g->n >= 2 && ctx->ngroups < groupmax)
+		ctx->groups[ctx->ngroups++] = *g;
+	g->n = 0;
+}
+
+void expression(struct compiler *ctx, symset fsys, int *ptx)
+{
+	enum symbol addop; /* 用于保存正负号 */
+	symset nxtlev = fsys | SYMBIT(plus) | SYMBIT(minus);
+	struct forkgroup group, *outer = ctx->group; /* 本表达式中直接作为因子的调用，实参和括号中的不算 */
+
+	group.n = 0;
+	ctx->group = &group;
+
+	if (ctx->stats)
+		ctx->stats->expressions++;
+	if (ctx->sym == plus || ctx->sym == minus) /* 表达式开头有正负号，此时当前表达式被看作一个正的或负的项 */
+	{
+		addop = ctx->sym; /* 保存开头的正负号 */
+		getsym(ctx);
+		term(ctx, nxtlev, ptx); /* 处理项 */
+		if (addop == minus)
+		{
+			endgroup(ctx);
+			gen(ctx, opr, 1); /* 如果开头为负号生成取负指令 */
+		}
+	}
+	else /* 此时表达式被看作项的加减 */
+	{
+		term(ctx, nxtlev, ptx); /* 处理项 */
+	}
+	while (ctx->sym == plus || ctx->sym == minus)
+	{
+		addop = ctx->sym;
+		getsym(ctx);
+		term(ctx, nxtlev, ptx); /* 处理项 */
+		endgroup(ctx);
+		if (addop == plus)
+		{
+			gen(ctx, opr, 2); /* 生成加法指令 */
+		}
+		else
+		{
+			gen(ctx, opr, 3); /* 生成减法指令 */
+		}
+	}
+	endgroup(ctx);
+	ctx->group = outer;
+}
+
+/*
+ * 项处理
+ */
+void term(struct compiler *ctx, symset fsys, int *ptx)
+{
+	enum symbol mulop; /* 用于保存乘除法符号 */
+	symset nxtlev = fsys | SYMBIT(times) | SYMBIT(slash);
+
+	factor(ctx, nxtlev, ptx); /* 处理因子 */
+	while (ctx->sym == times || ctx->sym == slash)
+	{
+		mulop = ctx->sym;
+		getsym(ctx);
+		factor(ctx, nxtlev, ptx);
+		endgroup(ctx);
+		if (mulop == times)
+		{
+			gen(ctx, opr, 4); /* 生成乘法指令 */
+		}
+		else
+		{
+			gen(ctx, opr, 5); /* 生成除法指令 */
+		}
+	}
+}
+
+/*
+ * 实参表：已读到 '('，每个实参求值后用 opr 17 放到调用者栈顶之上，返回实参个数
+ */
+static int arguments(struct compiler *ctx, symset fsys, int *ptx)
+{
+	int argCnt = 0;
+	symset nxtlev;
+
+	/* 1. 初始化 nxtlev = facbegsys ∪ fsys */
+	nxtlev = addset(facbegsys, fsys);
+	nxtlev |= SYMBIT(comma);  /* ← 一定要允许逗号 */
+	nxtlev |= SYMBIT(rparen); /* ← 一定要允许右括号 */
+
+	/* 2. 解析实参列表，每个 expression 都把值压栈 */
+	getsym(ctx);		   /* 已读到 '(', 现在取下一个符号 */
+	if (ctx->sym != rparen) /* 允许空实参 */
+	{
+		do
+		{
+			/* 传入已初始化的 nxtlev，保证 expression() 能正确停到逗号或右括号 */
+			expression(ctx, nxtlev, ptx);
+			argCnt++;
+			gen(ctx, opr, 17); /* 参数传递指令 */
+			if (ctx->sym == comma)
+				getsym(ctx);
+		} while (ctx->sym != rparen);
+
+		if (ctx->sym != rparen)
+			error(ctx, 22); /* 缺少右括号 ')' */
+	}
+	getsym(ctx); /* 越过 ')' */
+	return argCnt;
+}
+
+/*
+ * 因子处理
+ */
+/* factor() —— 解析因子，支持函数调用、变量、数字、括号表达式以及 spawn 和 join */
+void factor(struct compiler *ctx, symset fsys, int *ptx)
+{
+	int i, k, argCnt;
+	symset nxtlev;
+
+	/* 检测因子的开始符号，')' 交给调用者报告 */
+	test(ctx, facbegsys | SYMBIT(rparen), fsys, 77);
+
+	while (inset(ctx->sym, facbegsys)) /* 循环处理一个完整的因子 */
+	{
+		if (ctx->sym == ident)
+		{
+			/* 标识符：要么是函数调用，要么是普通变量或形参 */
+			i = position(ctx, ctx->id, *ptx);
+			if (i == -1)
+				error(ctx, 11); /* 未声明标识符 */
+			k = i == 0 ? findbuiltin(ctx->id) : -1;
+			getsym(ctx);
+
+			/* --------- 没有同名的函数时 sum(a)、dot(a, b) 是内建操作 --------- */
+			if (k >= 0 && ctx->sym == lparen)
+			{
+				if (!builtins[k].value)
+					error(ctx, 83); /* fill、scale、copy 没有值 */
+				builtin_call(ctx, k, fsys, ptx);
+			}
+			/* --------- 如果紧跟 '('，视为函数调用 --------- */
+			else if (ctx->sym == lparen)
+			{
+				argCnt = arguments(ctx, fsys, ptx);
+
+				/* 3. 检查实参个数是否与表中记录一致 */
+				// if (argCnt != table[i].paramCnt)
+				// error(ctx, 60);
+
+				/* 4. 生成函数调用指令，返回值留在栈顶 */
+				gen(ctx, cal, ctx->table[i].adr);
+				if (ctx->group && ctx->group->n < forkmax)
+				{ /* 登记为所在表达式的兄弟调用 */
+					ctx->group->cal[ctx->group->n] = ctx->cx - 1;
+					ctx->group->nargs[ctx->group->n++] = argCnt;
+				}
+			}
+			/* --------- 紧跟 '[' 时是数组元素 --------- */
+			else if (ctx->sym == lbracket)
+			{
+				int idx;
+
+				if (ctx->table[i].kind == function)
+					error(ctx, 61);
+				idx = subscript(ctx, fsys, ptx);
+				gen(ctx, ldx, ctx->table[i].adr);
+				access(ctx, ctx->table[i].adr, idx);
+			}
+			/* --------- 否则视为普通变量或形参 --------- */
+			else
+			{
+				if (ctx->table[i].kind == function)
+					error(ctx, 61); /* 函数名不能直接作为值 */
+				gen(ctx, lod, ctx->table[i].adr);
+			}
+		}
+		else if (ctx->sym == spawnsym)
+		{
+			/* spawn f(实参)：实参照常放好，lit 给出入口，opr 19 留下任务的句柄 */
+			getsym(ctx);
+			i = 0;
+			if (ctx->sym != ident)
+				error(ctx, 1);
+			else if ((i = position(ctx, ctx->id, *ptx)) == 0)
+				error(ctx, 11);
+			else if (ctx->table[i].kind != function)
+				error(ctx, 70);
+			getsym(ctx);
+			if (ctx->sym != lparen)
+				error(ctx, 23);
+			else
+				arguments(ctx, fsys, ptx);
+			gen(ctx, lit, i > 0 ? ctx->table[i].adr : 0);
+			gen(ctx, opr, 19);
+			if (ctx->nspawns < spawnmax) /* 超出容量的 spawn 到 join 时才执行 */
+				ctx->spawns[ctx->nspawns++] = ctx->cx - 1;
+		}
+		else if (ctx->sym == joinsym)
+		{
+			/* join(句柄)：等待任务结束，结果留在栈顶 */
+			getsym(ctx);
+			if (ctx->sym != lparen)
+				error(ctx, 23);
+			getsym(ctx);
+			expression(ctx, fsys | SYMBIT(rparen), ptx);
+			if (ctx->sym == rparen)
+				getsym(ctx);
+			else
+				error(ctx, 22);
+			gen(ctx, opr, 20);
+		}
+		else if (ctx->sym == nextsym)
+		{
+			/* next(句柄)：生成器继续执行到下一个 yield，产出的值留在栈顶 */
+			getsym(ctx);
+			if (ctx->sym != lparen)
+				error(ctx, 23);
+			getsym(ctx);
+			expression(ctx, fsys | SYMBIT(rparen), ptx);
+			if (ctx->sym == rparen)
+				getsym(ctx);
+			else
+				error(ctx, 22);
+			gen(ctx, opr, 24);
+		}
+		else if (ctx->sym == number)
+		{
+			/* 因子是数字常量 */
+			if (ctx->num > amax)
+			{
+				error(ctx, 31); /* 数字越界 */
+				ctx->num = 0;
+			}
+			gen(ctx, lit, ctx->num);
+			getsym(ctx);
+		}
+		else if (ctx->sym == lparen)
+		{
+			/* 因子是括号内表达式 "( ... )" */
+			getsym(ctx); /* 吃掉 '(' */
+			/* 设置子表达式的 FOLLOW 集 = fsys ∪ { ')' } */
+			nxtlev = fsys | SYMBIT(rparen);
+			expression(ctx, nxtlev, ptx);
+			if (ctx->sym == rparen)
+				getsym(ctx);
+			else
+				error(ctx, 22); /* 缺少右括号 ')' */
+		}
+		else
+		{
+			/* 不合法的因子开头，退出循环 */
+			break;
+		}
+
+		/* 因子处理结束后，检查下一个符号是否合法 */
+		fsys |= SYMBIT(comma);
+		test(ctx, fsys, SYMBIT(lparen), 77);
+	}
+}
+
+/*
+ * 条件处理
+ */
+void condition(struct compiler *ctx, symset fsys, int *ptx)
+{
+	enum symbol relop;
+	symset nxtlev;
+
+	/* 逻辑表达式处理 */
+	nxtlev = fsys | SYMBIT(eql) | SYMBIT(neq) | SYMBIT(lss) | SYMBIT(leq) | SYMBIT(gtr) | SYMBIT(geq);
+	expression(ctx, nxtlev, ptx);
+	if (ctx->sym != eql && ctx->sym != neq && ctx->sym != lss && ctx->sym != leq && ctx->sym != gtr && ctx->sym != geq)
+	{
+		error(ctx, 20); /* 应该为关系运算符 */
+	}
+	else
+	{
+		relop = ctx->sym;
+		getsym(ctx);
+		expression(ctx, fsys, ptx);
+		switch (relop)
+		{
+		case eql:
+			gen(ctx, opr, 8);
+			break;
+		case neq:
+			gen(ctx, opr, 9);
+			break;
+		case lss:
+			gen(ctx, opr, 10);
+			break;
+		case geq:
+			gen(ctx, opr, 11);
+			break;
+		case gtr:
+			gen(ctx, opr, 12);
+			break;
+		case leq:
+			gen(ctx, opr, 13);
+			break;
+		}
+	}
+}
+
+/*
+ * 在异常表中为地址 pc 处的错误找处理程序：先在当前函数中找，再沿动态链到各调用点找
+ * 栈的第 i 个单元是 s[i * stride]，按道交错存放的栈（l25Lanes.c）stride 为道数
+ * 找到时返回表项在 code[] 中的地址（四个字依次是 start、end、handler、ini），*pb 改为 try 所在栈帧的基址；
+ * 找不到时返回 -1。内层的 try 在表中排在前面，所以第一个包含 pc 的表项就是最内层的
+ */
+int findhandler(const struct instruction *code, const int *s, int stride, int pc, int *pb)
+{
+	int n = code[code[1].a].a, e;
+	int b = *pb;
+
+	for (;;)
+	{
+		for (e = code[1].a + 1; e < code[1].a + 1 + 4 * n; e += 4)
+		{
+			if (code[e].a <= pc && pc < code[e + 1].a)
+			{
+				*pb = b;
+				return e;
+			}
+		}
+		if (b <= 1)
+			return -1;
+		pc = s[(b + 1) * stride] - 1; /* 调用点 cal 指令的地址 */
+		b = s[b * stride];
+	}
+}
+
+/*
+ * 释放执行中分配的没有 join 的任务、生成器和数组；虚拟机结束或出错停止后调用，可以重复调用
+ */
+void vmrelease(struct vm *vm)
+{
+	if (vm->spawned)
+		spawn_release(vm);
+	if (vm->coros)
+		coro_release(vm);
+	if (vm->arrays)
+		array_release(vm);
+}
+
+/*
+ * 初始化虚拟机上下文，准备从 code[0] 开始执行
+ */
+void vminit(struct vm *vm, const struct instruction *code)
+{
+	vm->code = code;
+	vm->p = 0;
+	vm->b = 1;
+	vm->t = 0;
+	vm->k = 3;
+	memset(vm->s, 0, sizeof(vm->s)); /* s[0]不用，主程序的三个联系单元均置为0 */
+	vm->stackswitch = false;
+	vm->echo = false;
+	vm->fresult = NULL;
+	vm->in = NULL;
+	vm->nin = vm->inpos = 0;
+	vm->out = NULL;
+	vm->outcap = vm->nout = 0;
+	vm->input = NULL;
+	vm->output = NULL;
+	vm->newline = NULL;
+	vm->iouser = NULL;
+	vm->prof = NULL;
+	vm->sampler = NULL;
+	vm->trace = NULL;
+	vm->steps = 0;
+	vm->maxt = 0;
+	vm->depth = vm->maxdepth = 1; /* 主程序算作第一层 */
+	vm->par = NULL;
+	vm->forks = NULL;
+	vm->spawned = NULL;
+	vm->nspawned = vm->capspawned = 0;
+	vm->loopb = 0;
+	vm->loopend = -1;
+	vm->co = NULL;
+	vm->coros = NULL;
+	vm->ncoros = vm->capcoros = 0;
+	vm->arrays = NULL;
+	vm->narrays = vm->caparrays = 0;
+	vm->heap = NULL;
+	vm->heaptop = vm->heapcap = 0;
+	vm->sharedheap = false;
+	vm->undo = NULL;
+	vm->nundo = vm->capundo = 0;
+	vm->regions = NULL;
+	vm->nregions = vm->capregions = 0;
+	vm->pin = vm->pinbase = 0;
+	vm->keep = 0;
+}
+
+/*
+ * 输出一个整数（opr 14）：回显、结果文件、输出缓冲区和输出回调
+ */
+void vmwrite(struct vm *vm, int value)
+{
+	if (vm->echo)
+		printf("%d ", value);
+	if (vm->fresult)
+		fprintf(vm->fresult, "%d ", value);
+	if (vm->out && vm->nout < vm->outcap)
+		vm->out[vm->nout] = value;
+	if (vm->output)
+		vm->output(vm->iouser, value);
+	vm->nout++;
+}
+
+/*
+ * 输出换行（opr 15）
+ */
+void vmwriteln(struct vm *vm)
+{
+	if (vm->echo)
+		printf("\n");
+	if (vm->fresult)
+		fprintf(vm->fresult, "\n");
+	if (vm->newline)
+		vm->newline(vm->iouser);
+}
+
+/*
+ * 解释程序，一直执行到程序结束或出错
+ * 返回 enum vmstatus，出错时寄存器停在出错指令处
+ */
+int interpret(struct vm *vm)
+{
+	return vmrun(vm, -1);
+}
+
+/*
+ * 从当前寄存器状态继续执行，最多执行大约 budget 条指令，budget < 0 表示不限
+ * 预算只在调用和向后跳转处检查，顺序执行的代码没有额外开销；
+ * 执行的指令数按顺序执行段的地址跨度计数：每次跳转、调用和返回结束一段，所以计数与逐条分派的指令数相同。
+ * 预算用完时返回 vm_yield，寄存器停在下一条要执行的指令上，可以再次调用 vmrun() 继续
+ */
+int vmrun(struct vm *vm, long long budget)
+{
+	const struct instruction *code = vm->code;
+	int p = vm->p;			/* 指令指针 */
+	int b = vm->b;			/* 指令基址 */
+	int t = vm->t;			/* 栈顶指针 */
+	int k = vm->k;			// 参数位置
+	struct instruction i;	/* 存放当前指令 */
+	struct coroutine *cur = vm->co, *co; /* 正在执行的生成器，在主栈上时为 NULL */
+	int *s = cur ? cur->s : vm->s;		 /* 栈 */
+	int *heap = vm->heap;				 /* 数组的元素和描述符，只在新建数组时改变 */
+	const struct arraydesc *arrays = vm->arrays;
+	const struct arraydesc *x, *y; /* 内建数组操作的操作数 */
+	bool shared = vm->sharedheap;  /* parfor 的分段：改写元素之前记下原值 */
+	int regb = vm->nregions > 0 ? vm->regions[vm->nregions - 1].b : -1; /* 区域栈顶的栈帧的基址 */
+	int maxt = vm->maxt;	/* 栈顶指针的最大值，只在压栈的指令处更新 */
+	int depth = vm->depth;	/* 当前调用深度 */
+	FILE *fresult = vm->fresult;
+	struct profile *prof = vm->prof;
+	struct sampler *smp = vm->sampler;
+	struct tracer *trace = vm->trace;
+	bool got; /* 是否读到了输入 */
+	int h, tb; /* 异常表项和 try 所在栈帧的基址 */
+	int value; /* join 取回的结果、生成器产出的值 */
+	int status = vm_ok;
+	long long left = budget < 0 ? LLONG_MAX : budget; /* 剩余的指令预算 */
+	int seg = p;									   /* 当前顺序执行段的起始地址 */
+	/* 只在不限预算、不剖析不跟踪时分叉；分叉的结果在主栈上取回，生成器中不分叉 */
+	struct parallel *par0 = budget < 0 && !prof && !smp && !trace && !vm->stackswitch ? vm->par : NULL;
+	struct parallel *par = cur ? NULL : par0;
+	int nofork = -1; /* 子任务出错后顺序重新执行的 cal，这一次不分叉 */
+
+	if (vm->steps == 0)
+	{
+		if (prof) /* 主程序从 code[0] 的跳转目标开始 */
+			prof_start(prof, code[0].a);
+		if (vm->echo)
+			printf("Start l25\n");
+		if (fresult)
+			fprintf(fresult, "Start l25\n");
+	}
+	do
+	{
+	resume:
+		i = code[p]; /* 读当前指令 */
+		if (trace)
+		{ /* 记录执行前的状态，出错的指令也有记录 */
+			struct tracerec *r = &trace->ring[trace->n++ & trace->mask];
+			r->pc = p;
+			r->f = i.f;
+			r->a = i.a;
+			r->t = t;
+			r->b = b;
+			r->tos = s[t];
+		}
+		if (prof)
+		{
+			prof->count[p]++;
+			if (t > prof->maxt)
+				prof->maxt = t;
+		}
+		p = p + 1;
+		switch (i.f)
+		{
+		case lit: /* 将常量a的值取到栈顶 */
+			t = t + 1;
+			s[t] = i.a;
+			if (t > maxt)
+				maxt = t;
+			break;
+		case opr: /* 数学、逻辑运算 */
+			switch (i.a)
+			{
+			case 0: /* 函数调用结束后返回 */
+				if (prof)
+					prof_leave(prof);
+				depth--;
+				left -= p - seg;
+				t = b - 1;
+				p = s[t + 3];
+				b = s[t + 2];
+				seg = p;
+				break;
+			case 1: /* 栈顶元素取反 */
+				s[t] = -s[t];
+				break;
+			case 2: /* 次栈顶项加上栈顶项，退两个栈元素，相加值进栈 */
+				t = t - 1;
+				s[t] = s[t] + s[t + 1];
+				break;
+			case 3: /* 次栈顶项减去栈顶项 */
+				t = t - 1;
+				s[t] = s[t] - s[t + 1];
+				break;
+			case 4: /* 次栈顶项乘以栈顶项 */
+				t = t - 1;
+				s[t] = s[t] * s[t + 1];
+				break;
+			case 5: /* 次栈顶项除以栈顶项 */
+			{		/* 次栈顶 ÷ 栈顶 */
+				if (s[t] == 0)
+				{
+					if (vm->echo)
+						printf("** Runtime Error: Division by zero at instruction %d\n", p - 1);
+					if (fresult)
+						fprintf(fresult, "** Runtime Error: Division by zero at instruction %d\n", p - 1);
+
+					if (par && vm->forks)
+					{ /* 先取回分叉的调用，其中有出错的就回到那里顺序执行 */
+						vm->maxt = maxt;
+						if (fork_flush(vm))
+							goto redo;
+					}
+					tb = b;
+					h = findhandler(code, s, 1, p - 1, &tb);
+					for (co = cur; h < 0 && co; co = co->resumer)
+					{ /* 生成器中没有 catch：在执行 next 的一方接着找 */
+						tb = co->rb;
+						h = findhandler(code, co->rs, 1, co->rp - 1, &tb);
+					}
+					if (h >= 0 && co == NULL && tb == vm->loopb && code[h].a < code[vm->loopend - 1].a)
+						h = -1; /* parfor 的分段中，包围整个循环的 try 由父任务处理 */
+					if (h >= 0)
+					{ /* 结束 catch 之内的生成器，退出 try 所在函数之上的栈帧，在 catch 开头恢复该函数的栈顶 */
+						while (cur != co)
+						{
+							for (; b >= 1; b = s[b])
+								if (prof)
+									prof_leave(prof);
+							coro_finish(cur, 0);
+							s = cur->rs;
+							b = cur->rb;
+							depth = cur->rdepth;
+							cur = cur->resumer;
+						}
+						par = cur ? NULL : par0;
+						while (b != tb)
+						{
+							if (prof)
+								prof_leave(prof);
+							depth--;
+							b = s[b];
+						}
+						if (!cur && regb > b)
+							regb = region_unwind(vm, b);
+						left -= p - seg;
+						p = seg = code[h + 2].a;
+						t = b - 1 + iniframe(code[code[h + 3].a].a);
+						k = 3;
+					}
+					else
+					{ /* 没有 catch 可以处理，寄存器停在出错的除法上 */
+						p--;
+						status = vm_divzero;
+						goto stop;
+					}
+				}
+				else
+				{ /* 正常除法 */
+					t--;
+					s[t] = s[t] / s[t + 1];
+				}
+				break;
+			}
+			case 6: /* 栈顶元素的奇偶判断 */
+				s[t] = s[t] % 2;
+				break;
+			case 8: /* 次栈顶项与栈顶项是否相等 */
+				t = t - 1;
+				s[t] = (s[t] == s[t + 1]);
+				break;
+			case 9: /* 次栈顶项与栈顶项是否不等 */
+				t = t - 1;
+				s[t] = (s[t] != s[t + 1]);
+				break;
+			case 10: /* 次栈顶项是否小于栈顶项 */
+				t = t - 1;
+				s[t] = (s[t] < s[t + 1]);
+				break;
+			case 11: /* 次栈顶项是否大于等于栈顶项 */
+				t = t - 1;
+				s[t] = (s[t] >= s[t + 1]);
+				break;
+			case 12: /* 次栈顶项是否大于栈顶项 */
+				t = t - 1;
+				s[t] = (s[t] > s[t + 1]);
+				break;
+			case 13: /* 次栈顶项是否小于等于栈顶项 */
+				t = t - 1;
+				s[t] = (s[t] <= s[t + 1]);
+				break;
+			case 14: /* 栈顶值输出 */
+				vmwrite(vm, s[t]);
+				t = t - 1;
+				break;
+			case 15: /* 输出换行符 */
+				vmwriteln(vm);
+				break;
+			case 16: /* 读入一个输入置于栈顶 */
+				t = t + 1;
+				if (vm->echo)
+					printf("?");
+				if (vm->in)
+				{ /* 输入缓冲区优先，其次是输入回调，最后是标准输入 */
+					if ((got = vm->inpos < vm->nin))
+						s[t] = vm->in[vm->inpos];
+				}
+				else if (vm->input)
+					got = vm->input(vm->iouser, &s[t]) == 0;
+				else
+					got = scanf("%d", &(s[t])) == 1;
+				if (!got)
+				{ /* 输入已读完，停在本条指令上 */
+					t--;
+					p--;
+					status = vm_noinput;
+					goto stop;
+				}
+				vm->inpos++; /* 输入的位置，快照中保存 */
+				if (fresult)
+				{
+					fprintf(fresult, "?");
+					fprintf(fresult, "%d\n", s[t]);
+				}
+				if (t > maxt)
+					maxt = t;
+				break;
+			case 17: /* 参数传入 */
+				s[t + k] = s[t];
+				k++;
+				t--;
+				break;
+			case 18:
+			{
+				int retVal = s[b + 2]; /* 从 s[b+2] 中取出 testfunc 真正写好的返回值 */
+				int oldB = s[b + 0];   /* 从 s[b+0] 中取出上一层的基址 (SL) */
+				int oldP = s[b + 1];   /* 从 s[b+1] 中取出上一层的返回地址 (RA) */
+
+				if (prof)
+					prof_leave(prof);
+				depth--;
+				left -= p - seg;
+				if (b == regb && !cur) /* 释放这个栈帧的区域 */
+					regb = region_leave(vm, retVal);
+				t = b - 1;	   /* 恢复栈顶到 cal 之前的状态 */
+				t = t + 1;	   /* 先把 t 再往上拨 1，改写为 8 */
+				s[t] = retVal; /* 把 21 写到 s[8] */
+				// 上面做法让 “返回值” → 直接留在 s[8] 上
+				// 之后再恢复 b、p：
+				b = oldB;
+				p = oldP;
+				seg = p;
+				if (p == 0 && cur)
+				{ /* 生成器 return：结束，返回值交给 next */
+					value = retVal;
+					coro_finish(cur, value);
+					goto leave;
+				}
+				if (par && vm->forks && par->site[p].collect)
+				{ /* 一组兄弟调用的最后一次返回，取回分叉的结果 */
+					vm->maxt = maxt;
+					if (fork_join(vm, p, b))
+						goto redo;
+					maxt = vm->maxt;
+				}
+				break;
+			}
+			case 19: /* spawn：栈顶是入口，其下 k - 3 个实参已由 opr 17 放好，换成任务的句柄 */
+				t = t - 1;
+				h = spawn_start(vm, s, par && par->site[p - 1].spawn ? p - 1 : -1, s[t + 1], k - 3, t, depth);
+				t = t + 1;
+				s[t] = h;
+				k = 3;
+				if (t > maxt)
+					maxt = t;
+				break;
+			case 20: /* join：把栈顶的句柄换成任务的结果，任务还没有执行时在这里调用 */
+				t = t - 1;
+				vm->maxt = maxt;
+				h = spawn_join(vm, s, s[t + 1], t, &value);
+				maxt = vm->maxt;
+				if (h < 0)
+				{
+					t++;
+					p--;
+					status = h == -1 ? vm_badjoin : vm_overflow;
+					goto stop;
+				}
+				if (h == 0)
+				{
+					t = t + 1;
+					s[t] = value;
+					break;
+				}
+				i.a = h; /* 实参已放在 s[t + 4] 起的单元中 */
+				goto call;
+			case 21: /* parfor 开始：并行执行时把各次迭代分段交给线程池 */
+				if (par)
+				{
+					vm->maxt = maxt;
+					if ((h = par_loop(vm, p - 1, b, t, depth)) > 0)
+					{ /* 全部迭代已执行完，跳到循环末尾 */
+						left -= p - seg;
+						p = seg = h;
+					}
+					maxt = vm->maxt;
+				}
+				break;
+			case 22: /* parfor 结束：是本分段所在的循环时停止 */
+				if (p - 1 == vm->loopend && b == vm->loopb)
+					goto stop;
+				break;
+			case 23: /* 生成器函数的入口：实参交给新建的生成器，像 opr 18 一样返回句柄 */
+				h = coro_create(vm, s, b, p);
+				if (prof)
+					prof_leave(prof);
+				depth--;
+				left -= p - seg;
+				p = s[b + 1];
+				t = b;
+				b = s[b];
+				s[t] = h;
+				seg = p;
+				break;
+			case 24: /* next：切换到栈顶句柄的生成器，从挂起处继续执行 */
+				co = coro_get(vm, s[t]);
+				if (co == NULL || co->running)
+				{ /* 不是生成器，或者在 next 的链上 */
+					p--;
+					status = vm_badnext;
+					goto stop;
+				}
+				if (co->done)
+				{
+					s[t] = co->value;
+					break;
+				}
+				co->rs = s;
+				co->rp = p;
+				co->rb = b;
+				co->rt = t - 1;
+				co->rk = k;
+				co->rdepth = depth;
+				co->resumer = cur;
+				co->running = true;
+				cur = co;
+				par = NULL;
+				left -= p - seg;
+				s = co->s;
+				p = seg = co->p;
+				b = co->b;
+				t = co->t;
+				k = 3;
+				if (++depth > vm->maxdepth)
+					vm->maxdepth = depth;
+				if (prof)
+					prof_enter(prof, co->fn);
+				if (left <= 0)
+				{ /* 预算用完，停在生成器中 */
+					status = vm_yield;
+					goto stop;
+				}
+				break;
+			case 25: /* yield：保存生成器的寄存器，栈顶的值交给 next */
+				if (cur == NULL)
+				{ /* 不会发生：生成器的函数体只在自己的栈段上执行 */
+					p--;
+					status = vm_badnext;
+					goto stop;
+				}
+				if (prof)
+					prof_leave(prof);
+				left -= p - seg;
+				value = s[t];
+				cur->p = p;
+				cur->b = b;
+				cur->t = t - 1;
+				cur->running = false;
+			leave: /* 回到执行 next 的一方，值留在 next 处 */
+				co = cur;
+				cur = co->resumer;
+				par = cur ? NULL : par0;
+				s = co->rs;
+				p = seg = co->rp;
+				b = co->rb;
+				t = co->rt + 1;
+				k = co->rk;
+				depth = co->rdepth;
+				s[t] = value;
+				if (t > maxt)
+					maxt = t;
+				break;
+			case 26: /* 新建数组：栈顶的长度换成句柄 */
+				if (b != regb && !cur)
+					regb = region_enter(vm, b);
+				if ((h = array_new(vm, s[t])) == 0)
+				{
+					p--;
+					status = vm_heap;
+					goto stop;
+				}
+				s[t] = h;
+				if (cur) /* 生成器新建的数组随生成器保留 */
+					region_keep(vm, &h, 1);
+				heap = vm->heap;
+				arrays = vm->arrays;
+				break;
+			case 27: /* sum(a)：栈顶的句柄换成元素之和 */
+				if ((x = array_get(vm, s[t])) == NULL)
+				{
+					p--;
+					status = vm_bounds;
+					goto stop;
+				}
+				s[t] = bulk_sum(&heap[x->base], x->len);
+				break;
+			case 28: /* dot(a, b)：两个长度相同的数组对应元素乘积之和 */
+				x = array_get(vm, s[t - 1]);
+				y = array_get(vm, s[t]);
+				if (x == NULL || y == NULL || x->len != y->len)
+				{
+					p--;
+					status = vm_bounds;
+					goto stop;
+				}
+				t = t - 1;
+				s[t] = bulk_dot(&heap[x->base], &heap[y->base], x->len);
+				break;
+			case 29: /* fill(a, v)：次栈顶是句柄，每个元素置为栈顶的值 */
+			case 30: /* scale(a, k)：每个元素乘以栈顶的值 */
+				if ((x = array_get(vm, s[t - 1])) == NULL)
+				{
+					p--;
+					status = vm_bounds;
+					goto stop;
+				}
+				if (shared)
+					array_log(vm, x->base, x->len);
+				if (i.a == 29)
+				{
+					if (s[t] > s[t - 1] && s[t] <= vm->narrays)
+						region_pin(vm, s[t - 1], s[t]);
+					bulk_fill(&heap[x->base], x->len, s[t]);
+				}
+				else
+					bulk_scale(&heap[x->base], x->len, s[t]);
+				t = t - 2;
+				break;
+			case 31: /* copy(a, b)：把数组 b 复制到长度相同的数组 a */
+				x = array_get(vm, s[t - 1]);
+				y = array_get(vm, s[t]);
+				if (x == NULL || y == NULL || x->len != y->len)
+				{
+					p--;
+					status = vm_bounds;
+					goto stop;
+				}
+				if (s[t] > s[t - 1]) /* b 的元素中比 b 新的句柄已经记在 pin 中，a 还在时保留到 b 为止即可 */
+					region_pin(vm, s[t - 1], s[t]);
+				if (shared)
+					array_log(vm, x->base, x->len);
+				bulk_copy(&heap[x->base], &heap[y->base], x->len);
+				t = t - 2;
+				break;
+			}
+			break;
+		case lod: /* 取相对当前过程的数据基地址为a的内存的值到栈顶 */
+			t = t + 1;
+			s[t] = s[b + i.a];
+			if (t > maxt)
+				maxt = t;
+			break;
+		case sto: /* 栈顶的值存到相对当前过程的数据基地址为a的内存 */
+			s[b + i.a] = s[t];
+			t = t - 1;
+			break;
+		case ldx: /* 栈顶的下标换成变量 a 中句柄所指数组的元素 */
+			h = s[b + i.a] - 1;
+			if ((unsigned)h >= (unsigned)vm->narrays || (unsigned)s[t] >= (unsigned)arrays[h].len)
+			{
+				p--;
+				status = vm_bounds;
+				goto stop;
+			}
+			s[t] = heap[arrays[h].base + s[t]];
+			break;
+		case ldxu: /* 范围分析已证明在界内 */
+			s[t] = heap[arrays[s[b + i.a] - 1].base + s[t]];
+			break;
+		case stx: /* 次栈顶是下标，栈顶的值存入数组元素 */
+			h = s[b + i.a] - 1;
+			if ((unsigned)h >= (unsigned)vm->narrays || (unsigned)s[t - 1] >= (unsigned)arrays[h].len)
+			{
+				p--;
+				status = vm_bounds;
+				goto stop;
+			}
+			if (shared)
+				array_log(vm, arrays[h].base + s[t - 1], 1);
+			heap[arrays[h].base + s[t - 1]] = s[t];
+			if ((unsigned)(s[t] - h - 2) < (unsigned)(vm->narrays - h - 1))
+				region_pin(vm, h + 1, s[t]); /* 存入的是之后新建的数组的句柄 */
+			t = t - 2;
+			break;
+		case stxu:
+			h = s[b + i.a] - 1;
+			if (shared)
+				array_log(vm, arrays[h].base + s[t - 1], 1);
+			heap[arrays[h].base + s[t - 1]] = s[t];
+			if ((unsigned)(s[t] - h - 2) < (unsigned)(vm->narrays - h - 1))
+				region_pin(vm, h + 1, s[t]);
+			t = t - 2;
+			break;
+		case cal:		  /* 调用子过程 */
+			if (par && par->site[p - 1].nargs >= 0 && depth <= par->cutoff)
+			{
+				if (p - 1 != nofork)
+				{ /* 纯函数的兄弟调用交给线程池，结果的位置先压入 0 */
+					fork_spawn(vm, i.a, p - 1, b, t, depth);
+					t = t + 1;
+					s[t] = 0;
+					k = 3; /* 与调用返回后相同 */
+					if (t > maxt)
+						maxt = t;
+					break;
+				}
+				nofork = -1;
+			}
+		call:
+			s[t + 1] = b; /* 将本过程基地址入栈，即建立动态链 */
+			s[t + 2] = p; /* 将当前指令指针入栈，即保存返回地址 */
+			s[t + 3] = 0; /* 留出一个格子给返回值（初始化为0） */
+			b = t + 1;	  /* 更新基地址 */
+			left -= p - seg;
+			p = i.a;	  /* 跳转到函数入口 */
+			k = 3;		  /* ← 初始化参数搬运偏移量为4 */
+			if (++depth > vm->maxdepth)
+				vm->maxdepth = depth;
+			if (prof)
+				prof_enter(prof, p);
+			if (smp && smp->pending) /* 安全点：调用 */
+				sampler_take(smp, p, b, s);
+			seg = p;
+			if (left <= 0)
+			{ /* 预算用完，停在函数入口 */
+				status = vm_yield;
+				goto stop;
+			}
+			break;
+		case ini: /* 在数据栈中为被调用的过程开辟 iniframe(a) 个单元的数据区 */
+			if (t + iniframe(i.a) + stackslack + iniextra(i.a) >= stacksize)
+			{ /* 栈帧之上还要留出表达式求值的单元 */
+				p--;
+				status = vm_overflow;
+				goto stop;
+			}
+			t = t + iniframe(i.a);
+			if (t > maxt)
+				maxt = t;
+			break;
+		case jmp: /* 直接跳转 */
+			if (i.a < p)
+			{ /* 向后跳转（循环），检查预算 */
+				left -= p - seg;
+				p = seg = i.a;
+				if (smp && smp->pending) /* 安全点：向后跳转 */
+					sampler_take(smp, p, b, s);
+				if (left <= 0)
+				{
+					status = vm_yield;
+					goto stop;
+				}
+			}
+			else
+			{ /* 向前跳转也结束当前段，跳过的指令不计入 */
+				left -= p - seg;
+				p = seg = i.a;
+			}
+			break;
+		case jpc: /* 条件跳转 */
+			if (s[t] == 0)
+			{
+				left -= p - seg;
+				p = seg = i.a;
+			}
+			t = t - 1;
+			break;
+		}
+		if (vm->stackswitch && fresult)
+		{
+			if (vm->echo)
+				printf("  [after %s %d]  stack (t=%d, b=%d):", mnemonic[i.f], i.a, t, b);
+			fprintf(fresult, "  [after %s %d]  stack (t=%d, b=%d):", mnemonic[i.f], i.a, t, b);
+			for (int i = 1; i <= t; i++)
+			{
+				if (vm->echo)
+					printf(" %d", s[i]);
+				fprintf(fresult, " %d", s[i]);
+			}
+			if (vm->echo)
+				printf("\n");
+			fprintf(fresult, "\n");
+		} /*输出所有栈*/
+	} while (p != 0);
+	vmrelease(vm); /* 没有 join 的任务、生成器和数组 */
+	if (vm->echo)
+		printf("\nEnd l25\n");
+	if (fresult)
+		fprintf(fresult, "\nEnd l25\n");
+stop:
+	if (par && vm->forks)
+	{ /* 停止之前取回分叉的结果，其中有出错的就回到那里顺序执行 */
+		vm->maxt = maxt;
+		if (fork_flush(vm))
+		{
+			status = vm_ok;
+			goto redo;
+		}
+		maxt = vm->maxt;
+	}
+	if (status != vm_yield)
+		left -= p - seg;
+	if (status != vm_ok && status != vm_yield && status != vm_noinput && !vm->sharedheap)
+		vmrelease(vm); /* 出错停止，不能再继续执行；parfor 的分段由父任务合并后释放 */
+	while (prof && status != vm_yield && prof->depth > 0)
+		prof_leave(prof); /* 出错中止时结束所有活动函数的计时 */
+	vm->steps += (budget < 0 ? LLONG_MAX : budget) - left;
+	if (trace)
+		trace->hdr->count = trace->n;
+	vm->p = p;
+	vm->b = b;
+	vm->t = t;
+	vm->k = k;
+	vm->maxt = maxt;
+	vm->depth = depth;
+	vm->co = cur;
+	return status;
+
+redo: /* 分叉的调用出错，fork_join()/fork_flush() 已把寄存器改为那次 cal 之前的状态 */
+	left -= p - seg;
+	p = seg = vm->p;
+	b = vm->b;
+	t = vm->t;
+	k = vm->k;
+	depth = vm->depth;
+	maxt = vm->maxt;
+	nofork = p;
+	goto resume;
 }
\ No newline at end of file
@@ -0,0 +1,82 @@
+/*
+ * l25Coro.c
+ * 生成器：每个生成器有自己的栈段，interpret() 在 next 和 yield 处保存、恢复 p、b、t 并切换栈
+ *
+ * 生成器函数的入口是 opr 23：cal 已在调用者的栈上建好栈帧，coro_create() 把实参复制到新栈段上基址为 1 的栈帧中，
+ * 动态链和返回地址为 0，调用随即返回句柄。next(句柄) 记下执行 next 的一方的栈和寄存器，切换到生成器的栈段上
+ * 从挂起处继续执行；yield 保存生成器的寄存器后切换回来，把值压在 next 处。生成器 return 时结束（coro_finish()），
+ * 之后的 next 都得到返回值。生成器中没有被 catch 的除零在 next 处继续找 catch，生成器随之结束。
+ * 生成器之间可以互相 next，形成一条链；链上的生成器不能再被 next。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "l25.h"
+
+/*
+ * 执行到生成器函数入口的 opr 23：b 是 cal 在栈 s 上建好的栈帧，entry 是其后 ini 指令的地址
+ * 建立生成器，停在 ini 上，返回句柄
+ */
+int coro_create(struct vm *vm, const int *s, int b, int entry)
+{
+	struct coroutine *co = malloc(sizeof(struct coroutine));
+	int n = iniframe(vm->code[entry].a) - 3; /* 形参和局部变量的个数，只有形参有值 */
+
+	if (n > stacksize - b - 3)
+		n = stacksize - b - 3;
+	co->s = calloc(stacksize, sizeof(int));
+	memcpy(&co->s[4], &s[b + 3], sizeof(int) * (n > 0 ? n : 0));
+	region_keep(vm, &co->s[4], n);
+	co->p = entry;
+	co->b = 1; /* s[1..3] 为 0：return 时 p 为 0，由 interpret() 结束生成器 */
+	co->t = 0;
+	co->fn = entry - 1;
+	co->resumer = NULL;
+	co->running = false;
+	co->done = false;
+	co->value = 0;
+
+	if (vm->ncoros == vm->capcoros)
+	{
+		vm->capcoros = vm->capcoros ? 2 * vm->capcoros : 16;
+		vm->coros = realloc(vm->coros, sizeof(struct coroutine *) * vm->capcoros);
+	}
+	vm->coros[vm->ncoros++] = co;
+	return vm->ncoros;
+}
+
+/* 句柄 h 的生成器，无效时返回 NULL */
+struct coroutine *coro_get(struct vm *vm, int h)
+{
+	return h >= 1 && h <= vm->ncoros ? vm->coros[h - 1] : NULL;
+}
+
+/* 生成器结束，以后的 next 都得到 value；栈段不再需要 */
+void coro_finish(struct coroutine *co, int value)
+{
+	co->done = true;
+	co->running = false;
+	co->value = value;
+	free(co->s);
+	co->s = NULL;
+}
+
+/*
+ * 释放所有生成器
+ */
+void coro_release(struct vm *vm)
+{
+	int i;
+
+	for (i = 0; i < vm->ncoros; i++)
+	{
+		free(vm->coros[i]->s);
+		free(vm->coros[i]);
+	}
+	free(vm->coros);
+	vm->coros = NULL;
+	vm->ncoros = vm->capcoros = 0;
+	vm->co = NULL;
+}
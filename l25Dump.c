@@ -0,0 +1,273 @@
+/*
+ * l25Dump.c
+ * 执行轨迹解码器：对照源程序把 l25 -T 写出的二进制轨迹还原成可读的文本
+ *
+ * 使用方法：
+ * l25dump [-n 条数] [-s] 轨迹文件 源程序.l25
+ * 重新编译源程序得到 code[]、table[] 和每条指令的源程序行，用代码散列确认轨迹属于这个程序。
+ * 默认输出文件中保留的全部记录（最后 capacity 条），-n 只输出最后若干条；
+ * 每条记录一行：序号、所在函数、地址、指令、操作数的含义（变量名、被调函数名）、执行前的 t、b、栈顶值和源程序行。
+ * -s 只输出按指令统计的次数。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "l25.h"
+
+/* 一个函数：入口地址和它的局部符号在 table[] 中的范围 */
+struct dumpfunc
+{
+	const char *name;
+	int entry;
+	int first, last; /* 形参和变量在 table[] 中的下标范围 */
+};
+
+static struct compiler ctx; /* 上下文较大，不放在栈上 */
+static struct dumpfunc *funcs;
+static int nfunc;
+static int *funcof; /* 每条指令所属的函数 */
+
+static const char *opername[] = {
+	[0] = "ret", [1] = "neg", [2] = "add", [3] = "sub", [4] = "mul", [5] = "div", [6] = "odd",
+	[8] = "eq", [9] = "ne", [10] = "lt", [11] = "ge", [12] = "gt", [13] = "le", [14] = "write",
+	[15] = "writeln", [16] = "read", [17] = "arg", [18] = "return", [19] = "spawn", [20] = "join",
+	[21] = "parfor", [22] = "endfor", [23] = "generator", [24] = "next", [25] = "yield",
+	[26] = "newarray", [27] = "sum", [28] = "dot", [29] = "fill", [30] = "scale", [31] = "copy"};
+
+/*
+ * 按符号表划分函数：每个函数的形参和变量紧跟在它的函数项后面
+ */
+static void buildfuncs()
+{
+	int i, j, cur;
+
+	funcs = malloc(sizeof(struct dumpfunc) * (ctx.tx + 2));
+	funcs[0].name = "main";
+	funcs[0].entry = ctx.code[0].a;
+	funcs[0].first = 1;
+	funcs[0].last = ctx.tx;
+	nfunc = 1;
+	cur = 0;
+	for (i = 1; i <= ctx.tx; i++)
+	{
+		if (ctx.table[i].kind == function)
+		{
+			funcs[nfunc].name = ctx.table[i].name;
+			funcs[nfunc].entry = ctx.table[i].adr;
+			funcs[nfunc].first = i + 1;
+			funcs[nfunc].last = ctx.tx;
+			if (cur > 0)
+				funcs[cur].last = i - 1;
+			cur = nfunc++;
+		}
+	}
+	/* 主程序的符号紧跟在最后一个函数的符号之后，地址从 3 重新开始，以地址不再递增处为界 */
+	if (cur > 0)
+	{
+		for (i = funcs[cur].first; i <= ctx.tx; i++)
+			if (ctx.table[i].kind == variable && i > funcs[cur].first && ctx.table[i].adr <= ctx.table[i - 1].adr)
+				break;
+		funcs[cur].last = i - 1;
+		funcs[0].first = i;
+	}
+
+	funcof = malloc(sizeof(int) * ctx.cx);
+	for (i = 0; i < ctx.cx; i++)
+	{
+		int best = 0, bestentry = -1;
+		for (j = 0; j < nfunc; j++)
+		{
+			if (funcs[j].entry <= i && funcs[j].entry > bestentry)
+			{
+				best = j;
+				bestentry = funcs[j].entry;
+			}
+		}
+		funcof[i] = best;
+	}
+}
+
+/* 函数 fn 中地址为 adr 的形参或变量名，最后声明的优先 */
+static const char *varname(int fn, int adr)
+{
+	int i;
+
+	for (i = funcs[fn].last; i >= funcs[fn].first; i--)
+		if (ctx.table[i].kind != function && ctx.table[i].adr == adr)
+			return ctx.table[i].name;
+	return NULL;
+}
+
+static const char *funcname(int entry)
+{
+	int i;
+
+	for (i = 0; i < nfunc; i++)
+		if (funcs[i].entry == entry)
+			return funcs[i].name;
+	return "?";
+}
+
+/* 操作数的含义 */
+static void describe(char *buf, size_t n, const struct tracerec *r)
+{
+	const char *name;
+
+	buf[0] = 0;
+	switch (r->f)
+	{
+	case opr:
+		if (r->a >= 0 && r->a < (int)(sizeof(opername) / sizeof(opername[0])) && opername[r->a])
+			snprintf(buf, n, "%s", opername[r->a]);
+		break;
+	case lod:
+	case sto:
+	case ldx:
+	case stx:
+	case ldxu:
+	case stxu:
+		if (r->pc >= 0 && r->pc < ctx.cx && (name = varname(funcof[r->pc], r->a)) != NULL)
+			snprintf(buf, n, "%.*s", al, name);
+		else if (r->a == 2)
+			snprintf(buf, n, "(return slot)");
+		break;
+	case cal:
+		snprintf(buf, n, "%.*s", al, funcname(r->a));
+		break;
+	case ini:
+		snprintf(buf, n, iniextra(r->a) ? "frame %d, %d more for expressions" : "frame %d", iniframe(r->a), iniextra(r->a));
+		break;
+	default:
+		break;
+	}
+}
+
+static int compilesource(const char *path)
+{
+	if ((ctx.fin = fopen(path, "r")) == NULL)
+	{
+		fprintf(stderr, "Can't open the source file %s!\n", path);
+		return -1;
+	}
+	if (compile(&ctx) != 0)
+	{
+		fprintf(stderr, "%s does not compile!\n", path);
+		fclose(ctx.fin);
+		return -1;
+	}
+	fclose(ctx.fin);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *tracepath = NULL, *srcpath = NULL;
+	long long last = -1, k, first, cap;
+	bool summary = false;
+	struct traceheader *hdr;
+	const struct tracerec *ring;
+	struct stat st;
+	void *map;
+	int i, fd;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			last = atoll(argv[++i]);
+		else if (strcmp(argv[i], "-s") == 0)
+			summary = true;
+		else if (tracepath == NULL)
+			tracepath = argv[i];
+		else if (srcpath == NULL)
+			srcpath = argv[i];
+		else
+			tracepath = NULL, i = argc;
+	}
+	if (tracepath == NULL || srcpath == NULL)
+	{
+		fprintf(stderr, "usage: l25dump [-n last] [-s] trace program.l25\n");
+		return 1;
+	}
+
+	if ((fd = open(tracepath, O_RDONLY)) < 0 || fstat(fd, &st) != 0)
+	{
+		fprintf(stderr, "Can't open the trace file %s!\n", tracepath);
+		return 1;
+	}
+	if ((size_t)st.st_size < sizeof(struct traceheader) ||
+		(map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+	{
+		fprintf(stderr, "%s is not a trace file!\n", tracepath);
+		return 1;
+	}
+	close(fd);
+	hdr = map;
+	cap = (long long)hdr->capacity;
+	if (hdr->magic != L25T_MAGIC || hdr->version != L25T_VERSION || hdr->recsize != sizeof(struct tracerec) ||
+		sizeof(struct traceheader) + cap * sizeof(struct tracerec) > (size_t)st.st_size)
+	{
+		fprintf(stderr, "%s is not a trace file!\n", tracepath);
+		return 1;
+	}
+	ring = (const struct tracerec *)(hdr + 1);
+
+	if (compilesource(srcpath) != 0)
+		return 1;
+	if (ctx.cx != hdr->cx || codehash(ctx.code, ctx.cx) != hdr->codehash)
+	{
+		fprintf(stderr, "%s was not recorded from %s (code image differs)!\n", tracepath, srcpath);
+		return 1;
+	}
+	buildfuncs();
+
+	/* 文件中保留的是第 first 到第 count - 1 条记录 */
+	first = (long long)hdr->count > cap ? (long long)hdr->count - cap : 0;
+	if (last >= 0 && (long long)hdr->count - last > first)
+		first = (long long)hdr->count - last;
+	printf("%llu instructions executed, %lld kept, showing %lld\n", hdr->count,
+		   (long long)hdr->count < cap ? (long long)hdr->count : cap, (long long)hdr->count - first);
+
+	if (summary)
+	{
+		long long *count = calloc(ctx.cx, sizeof(long long));
+
+		for (k = first; k < (long long)hdr->count; k++)
+		{
+			const struct tracerec *r = &ring[k % cap];
+			if (r->pc >= 0 && r->pc < ctx.cx)
+				count[r->pc]++;
+		}
+		printf("%6s %-10s %-4s %6s %12s %6s\n", "addr", "function", "op", "a", "count", "line");
+		for (i = 0; i < ctx.cx; i++)
+			if (count[i] > 0)
+				printf("%6d %-10.*s %-4s %6d %12lld %6d\n", i, al, funcs[funcof[i]].name, mnemonic[ctx.code[i].f],
+					   ctx.code[i].a, count[i], ctx.codeline[i]);
+		free(count);
+	}
+	else
+	{
+		printf("%12s %-10s %6s %-4s %6s %-12s %5s %5s %11s %6s\n", "step", "function", "addr", "op", "a", "", "t", "b",
+			   "top", "line");
+		for (k = first; k < (long long)hdr->count; k++)
+		{
+			const struct tracerec *r = &ring[k % cap];
+			char what[64];
+			bool ok = r->pc >= 0 && r->pc < ctx.cx && r->f >= 0 && r->f < fctnum;
+
+			describe(what, sizeof(what), r);
+			printf("%12lld %-10.*s %6d %-4s %6d %-12s %5d %5d %11d %6d\n", k, al,
+				   ok ? funcs[funcof[r->pc]].name : "?", r->pc, ok ? mnemonic[r->f] : "?", r->a, what, r->t, r->b,
+				   r->tos, ok ? ctx.codeline[r->pc] : 0);
+		}
+	}
+	munmap(map, st.st_size);
+	free(funcs);
+	free(funcof);
+	return 0;
+}
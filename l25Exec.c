@@ -0,0 +1,840 @@
+/*
+ * l25Exec.c
+ * 执行服务：程序只装入一次，在多个工作线程上并发执行大量互相独立的运行
+ *
+ * 每次运行使用所在工作线程的虚拟机上下文（独立的 s[]、p/b/t 寄存器和输入输出缓冲区），
+ * 所有运行共享只读的 code[]。任务通过 work-stealing 线程池分派。
+ *
+ * 使用方法：
+ * l25 -x [-j 线程数] [-n 重复次数] [-s 时间片] [-f 指令数上限] [-w 毫秒] [-p] [-v] [-q] 程序(.l25 或 .l25o) 输入文件
+ * 输入文件每行是一次运行的输入（空白分隔的整数），按行的顺序输出每次运行的结果
+ * -s 时不用线程池，而是在当前线程上按时间片轮流执行所有运行
+ * -f、-w 限定每次运行最多执行的指令数和墙钟时间
+ * -p 只执行一次第一个 input() 之前的前缀（初始化、随机数预热等），每次运行复制前缀结束时的虚拟机接着执行
+ * -v 每 lanes 次运行作为一个任务，按 SIMD 道同步执行（见 l25Lanes.c），不能与 -s 同用
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "l25.h"
+
+struct execservice
+{
+	struct wspool *pool;
+	struct vm *vms; /* 每个工作线程一个虚拟机上下文，反复使用 */
+	struct lanevm *lvms; /* 每个工作线程一个按道同步执行的上下文 */
+};
+
+static double now_msec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* 校验代码时的状态：各条指令所属的函数，到达时栈帧之上的操作数个数和 opr 17 的参数位置 */
+struct checker
+{
+	const struct instruction *code;
+	int e;				 /* 异常表的地址，可执行的代码在 [2, e) 中 */
+	int *owner;			 /* 每条指令所属函数的入口，不属于任何函数时为 -1 */
+	int *depth;			 /* 到达时栈帧之上的操作数个数，还没有到达时为 -1 */
+	int *argk;			 /* 到达时 opr 17 的参数位置 */
+	int *work, nwork;	 /* 已到达、还没有检查的指令 */
+	int fn, frame, room; /* 正在检查的函数的入口、栈帧大小和表达式求值可用的单元数 */
+};
+
+/* 函数入口 pc 处的 ini 的地址：入口是 ini，或生成器的 opr 23 之后紧跟 ini；不是函数入口时返回 -1 */
+static int entryini(const struct instruction *code, int e, int pc)
+{
+	if (pc < 2 || pc >= e)
+		return -1;
+	if (code[pc].f == opr && code[pc].a == 23)
+		pc++;
+	if (pc >= e || code[pc].f != ini || code[pc].a < 0 || iniframe(code[pc].a) < 3 || iniframe(code[pc].a) >= stacksize)
+		return -1;
+	return pc;
+}
+
+/* 以操作数个数 d、参数位置 k 到达 pc：跳出了本函数，或与此前到达时不同，返回 -1 */
+static int reach(struct checker *ck, int pc, int d, int k)
+{
+	if (pc < 0 || pc >= ck->e || ck->owner[pc] != ck->fn)
+		return -1;
+	if (ck->depth[pc] < 0)
+	{
+		ck->depth[pc] = d;
+		ck->argk[pc] = k;
+		ck->work[ck->nwork++] = pc;
+		return 0;
+	}
+	return ck->depth[pc] == d && ck->argk[pc] == k ? 0 : -1;
+}
+
+/*
+ * 检查 pc 处的一条指令并到达它的后继：操作数够用，栈帧之上用到的单元不超过 ini 预留的，
+ * 变量在栈帧之内，不改写联系单元，调用的是函数入口
+ */
+static int checkstep(struct checker *ck, int pc)
+{
+	const struct instruction *code = ck->code;
+	struct instruction i = code[pc];
+	int d = ck->depth[pc], k = ck->argk[pc];
+	int need = 0, top = d; /* 要用的操作数个数，用到的最高单元 */
+	int q;
+
+	switch (i.f)
+	{
+	case lit:
+		d++;
+		break;
+	case lod:
+		if (i.a < 0 || i.a >= ck->frame)
+			return -1;
+		d++;
+		break;
+	case sto: /* 主程序的 s[b + 2] 是 opr 0 取的返回地址 */
+		if (i.a < (ck->fn == code[0].a ? 3 : 2) || i.a >= ck->frame)
+			return -1;
+		need = 1;
+		d--;
+		break;
+	case ldx:
+	case ldxu:
+		if (i.a < 0 || i.a >= ck->frame)
+			return -1;
+		need = 1;
+		break;
+	case stx:
+	case stxu:
+		if (i.a < 0 || i.a >= ck->frame)
+			return -1;
+		need = 2;
+		d -= 2;
+		break;
+	case cal:
+		if (entryini(code, ck->e, i.a) < 0)
+			return -1;
+		top = d + 3; /* 联系单元 */
+		d++;
+		k = 3;
+		break;
+	case jmp:
+		return reach(ck, i.a, d, k);
+	case jpc:
+		need = 1;
+		d--;
+		if (d >= 0 && reach(ck, i.a, d, k) != 0)
+			return -1;
+		break;
+	case opr:
+		switch (i.a)
+		{
+		case 0: /* 取 s[b + 2] 为返回地址，只能结束主程序 */
+			return ck->fn == code[0].a ? 0 : -1;
+		case 18:
+			return 0;
+		case 1:
+		case 6:
+		case 20:
+		case 24:
+		case 26:
+		case 27:
+			need = 1;
+			break;
+		case 2:
+		case 3:
+		case 4:
+		case 5:
+		case 8:
+		case 9:
+		case 10:
+		case 11:
+		case 12:
+		case 13:
+		case 28:
+			need = 2;
+			d--;
+			break;
+		case 14:
+		case 25:
+			need = 1;
+			d--;
+			break;
+		case 15:
+		case 22:
+			break;
+		case 16:
+			d++;
+			break;
+		case 17:
+			need = 1;
+			top = d + k; /* 实参放在 s[t + k] */
+			k++;
+			d--;
+			break;
+		case 19: /* 入口由紧挨着的 lit 给出，不能是跳转目标（见 checkprogram()） */
+			if (code[pc - 1].f != lit || entryini(code, ck->e, code[pc - 1].a) < 0)
+				return -1;
+			need = 1;
+			k = 3;
+			break;
+		case 21: /* par_loop() 按 lod i、lod hi、opr 10、jpc 取循环变量、上界和循环末尾 */
+			if (pc + 4 >= ck->e || code[pc + 1].f != lod || code[pc + 2].f != lod || code[pc + 3].f != opr ||
+				code[pc + 3].a != 10 || code[pc + 4].f != jpc || (q = code[pc + 4].a) < 0 || q >= ck->e ||
+				code[q].f != opr || code[q].a != 22)
+				return -1;
+			break;
+		case 29:
+		case 30:
+		case 31:
+			need = 2;
+			d -= 2;
+			break;
+		default: /* opr 23 只能在生成器的入口，其余的编号没有定义 */
+			return -1;
+		}
+		break;
+	default: /* ini 只能在函数入口 */
+		return -1;
+	}
+	if (ck->depth[pc] < need || d > ck->room || top > ck->room)
+		return -1;
+	return reach(ck, pc + 1, d, k);
+}
+
+/*
+ * 检查装入的代码，目标文件可能被截断或改写过：
+ * code[0]、code[1] 是跳到主程序和异常表的 jmp，异常表、分叉表都在 code[] 之内，表中的地址指向相应的指令；
+ * 从主程序和每个函数的入口（cal 的目标、spawn 的 lit）出发，沿所有可能的执行路径模拟栈顶，
+ * 每个地址到达时栈帧之上的操作数个数相同，执行时栈上的存取都在 ini 检查过的范围之内，不会执行到函数之外
+ */
+static int checkprogram(const struct program *prog)
+{
+	const struct instruction *code = prog->code;
+	int cx = prog->cx;
+	struct checker ck;
+	char *target;
+	int e, n, f, g, m, i, fn, h, ok = -1;
+
+	if (cx < 3 || code[0].f != jmp || code[1].f != jmp || (e = code[1].a) < 3 || e >= cx)
+		return -1;
+	if ((n = code[e].a) < 0 || n > (cx - e - 1) / 4 || (f = e + 1 + 4 * n) >= cx)
+		return -1;
+	for (g = code[f++].a; g > 0; g--)
+	{ /* 分叉表：每组的调用次数、各次 cal 的地址和实参个数 */
+		if (f >= cx || (m = code[f++].a) < 1 || m > forkmax || m > (cx - f) / 2)
+			return -1;
+		for (i = 0; i < m; i++, f += 2)
+			if (code[f].a < 2 || code[f].a >= e || code[code[f].a].f != cal || code[f + 1].a < 0 ||
+				code[f + 1].a >= stacksize)
+				return -1;
+	}
+	if (f >= cx || (n = code[f++].a) < 0 || n > cx - f)
+		return -1;
+	for (; n > 0; n--, f++) /* 纯函数的 spawn */
+		if (code[f].a < 2 || code[f].a >= e || code[code[f].a].f != opr || code[code[f].a].a != 19)
+			return -1;
+
+	ck.code = code;
+	ck.e = e;
+	ck.owner = malloc(sizeof(int) * e);
+	ck.depth = malloc(sizeof(int) * e);
+	ck.argk = malloc(sizeof(int) * e);
+	ck.work = malloc(sizeof(int) * e);
+	target = calloc(e, 1); /* 1：函数入口，2：跳转目标 */
+	if (entryini(code, e, code[0].a) < 0)
+		goto out;
+	target[code[0].a] = 1;
+	for (i = 2; i < e; i++)
+	{
+		if (code[i].f == cal || (code[i].f == opr && code[i].a == 19 && code[i - 1].f == lit))
+		{
+			fn = code[i].f == cal ? code[i].a : code[i - 1].a;
+			if (entryini(code, e, fn) < 0)
+				goto out;
+			target[fn] |= 1;
+			target[entryini(code, e, fn)] |= 4;
+		}
+		if (code[i].f == jmp || code[i].f == jpc)
+		{
+			if (code[i].a < 0 || code[i].a >= e)
+				goto out;
+			target[code[i].a] |= 2;
+		}
+	}
+	target[entryini(code, e, code[0].a)] |= 4;
+	for (h = code[1].a + 1; h < code[1].a + 1 + 4 * code[e].a; h += 4)
+	{ /* 没有被调用的函数只能从 try 表中的 ini 找到，以 ini 为入口 */
+		if ((i = code[h + 3].a) < 2 || i >= e)
+			goto out;
+		if (!(target[i] & 4))
+		{
+			if (entryini(code, e, i) != i)
+				goto out;
+			target[i] |= 5;
+		}
+	}
+	for (i = 0, fn = -1; i < e; i++)
+	{ /* 每个函数从入口到下一个入口为止 */
+		if (target[i] & 1)
+			fn = i;
+		ck.owner[i] = fn;
+		ck.depth[i] = -1;
+	}
+	for (h = code[1].a + 1; h < code[1].a + 1 + 4 * code[e].a; h += 4)
+	{ /* try 区域、catch 入口都在同一个函数中，最后一个字是这个函数的 ini */
+		int start = code[h].a, end = code[h + 1].a, handler = code[h + 2].a;
+
+		if (start < 2 || start >= end || end > e || handler < 2 || handler >= e || (fn = ck.owner[start]) < 0 ||
+			ck.owner[end - 1] != fn || ck.owner[handler] != fn || code[h + 3].a != entryini(code, e, fn))
+			goto out;
+		target[handler] |= 2;
+	}
+	for (i = 2; i < e; i++)
+		if ((target[i] & 2) && code[i].f == opr && code[i].a == 19)
+			goto out; /* 跳过了给出入口的 lit */
+	for (fn = 2; fn < e; fn++)
+	{
+		if (!(target[fn] & 1))
+			continue;
+		ck.fn = fn;
+		i = entryini(code, e, fn);
+		ck.frame = iniframe(code[i].a);
+		ck.room = stackslack + iniextra(code[i].a);
+		if (ck.frame + ck.room >= stacksize)
+			continue; /* ini 必定溢出，函数体不会执行 */
+		ck.nwork = 0;
+		if (reach(&ck, i + 1, 0, 3) != 0)
+			goto out;
+		for (h = code[1].a + 1; h < code[1].a + 1 + 4 * code[e].a; h += 4)
+			if (ck.owner[code[h + 2].a] == fn && reach(&ck, code[h + 2].a, 0, 3) != 0)
+				goto out; /* catch 开头的栈顶恢复为栈帧的大小 */
+		while (ck.nwork > 0)
+			if (checkstep(&ck, ck.work[--ck.nwork]) != 0)
+				goto out;
+	}
+	ok = 0;
+out:
+	free(ck.owner);
+	free(ck.depth);
+	free(ck.argk);
+	free(ck.work);
+	free(target);
+	return ok;
+}
+
+/*
+ * 装入程序：.l25o 目标文件直接读入，其余按源程序编译
+ * 成功返回 0
+ */
+int loadprogram(struct program *prog, const char *path)
+{
+	size_t len = strlen(path);
+	FILE *f;
+	int i;
+
+	prog->code = NULL;
+	prog->cx = 0;
+	prog->prefix = NULL;
+	if (len > 5 && strcmp(path + len - 5, ".l25o") == 0)
+	{
+		if ((f = fopen(path, "rb")) == NULL)
+			return -1;
+		if (readobject(f, &prog->code, &prog->cx) != 0)
+		{
+			fclose(f);
+			return -1;
+		}
+		fclose(f);
+		for (i = 0; i < prog->cx; i++)
+		{ /* 目标文件中范围分析的结论不可信，不检查下标的存取改回检查的 */
+			if (prog->code[i].f == ldxu)
+				prog->code[i].f = ldx;
+			else if (prog->code[i].f == stxu)
+				prog->code[i].f = stx;
+		}
+	}
+	else
+	{
+		struct compiler *ctx = calloc(1, sizeof(struct compiler));
+		int err;
+
+		if ((ctx->fin = fopen(path, "r")) == NULL)
+		{
+			free(ctx);
+			return -1;
+		}
+		ctx->foutput = fopen("/dev/null", "w");
+		ctx->ftable = fopen("/dev/null", "w");
+		err = compile(ctx);
+		fclose(ctx->fin);
+		fclose(ctx->foutput);
+		fclose(ctx->ftable);
+		if (err != 0)
+		{
+			free(ctx);
+			return -1;
+		}
+		prog->cx = ctx->cx;
+		prog->code = malloc(sizeof(struct instruction) * ctx->cx);
+		memcpy(prog->code, ctx->code, sizeof(struct instruction) * ctx->cx);
+		free(ctx);
+	}
+	if (checkprogram(prog) != 0)
+	{
+		freeprogram(prog);
+		return -1;
+	}
+	return 0;
+}
+
+void freeprogram(struct program *prog)
+{
+	if (prog->prefix)
+	{
+		free(prog->prefix->out);
+		free(prog->prefix);
+		prog->prefix = NULL;
+	}
+	free(prog->code);
+	prog->code = NULL;
+	prog->cx = 0;
+}
+
+/*
+ * 执行程序的前缀：不给输入，从头执行到第一次 input()，保留前 outcap 个输出
+ * 前缀的结果与输入无关，之后的每次运行都从 prog->prefix 的副本开始，前缀只执行一次
+ * 程序在读输入之前就结束、出错或超出 fuel 条指令时不使用前缀，返回 -1
+ * 虚拟机上下文只有几 KB，复制它比 fork() 复制页表便宜，并发由执行服务的线程池提供
+ */
+int prefix_create(struct program *prog, int outcap, long long fuel)
+{
+	static const int none[1];
+	struct vm *vm = malloc(sizeof(struct vm));
+
+	vminit(vm, prog->code);
+	vm->in = none; /* 空的输入缓冲区：停在第一条 opr 16 上，寄存器不变 */
+	vm->nin = 0;
+	vm->outcap = outcap;
+	vm->out = malloc(sizeof(int) * (outcap > 0 ? outcap : 1));
+	if (vmslice(vm, -1, fuel, 0) != vm_noinput || vm->spawned || vm->coros || vm->arrays)
+	{ /* spawn 的任务、生成器和数组不能由各次运行共用 */
+		vmrelease(vm);
+		free(vm->out);
+		free(vm);
+		return -1;
+	}
+	prog->prefix = vm;
+	return 0;
+}
+
+/*
+ * 准备一次运行的虚拟机：有前缀时复制前缀的虚拟机和它的输出，否则从头开始
+ */
+static void startvm(struct vm *vm, const struct program *prog, const int *in, int nin, int *out, int outcap)
+{
+	const struct vm *pre = prog->prefix;
+
+	if (pre)
+	{
+		int n = pre->nout < pre->outcap ? pre->nout : pre->outcap;
+
+		memcpy(vm, pre, sizeof(struct vm));
+		memcpy(out, pre->out, sizeof(int) * (n < outcap ? n : outcap));
+	}
+	else
+		vminit(vm, prog->code);
+	vm->in = in;
+	vm->nin = nin;
+	vm->out = out;
+	vm->outcap = outcap;
+}
+
+struct execservice *exec_create(int nthreads)
+{
+	struct execservice *svc = malloc(sizeof(struct execservice));
+
+	svc->pool = wspool_create(nthreads);
+	svc->vms = calloc(wspool_size(svc->pool), sizeof(struct vm));
+	svc->lvms = aligned_alloc(_Alignof(struct lanevm), sizeof(struct lanevm) * wspool_size(svc->pool));
+	return svc;
+}
+
+/* 执行到结束，有限制时分时间片执行，每片结束时检查 */
+static int runvm(struct vm *vm, long long fuel, double deadline)
+{
+	int status;
+
+	if (fuel <= 0 && deadline <= 0)
+		status = interpret(vm);
+	else
+	{
+		do
+			status = vmslice(vm, timeslice, fuel, deadline);
+		while (status == vm_yield);
+	}
+	vmrelease(vm); /* 输入不够或超出限制停止时还没有释放 */
+	return status;
+}
+
+static void runexec(void *arg, int worker)
+{
+	struct execjob *job = arg;
+	struct vm *vm = &job->svc->vms[worker];
+	double start = now_msec();
+
+	startvm(vm, job->prog, job->in, job->nin, job->out, job->outcap);
+	job->status = runvm(vm, job->fuel, job->timeout > 0 ? start + job->timeout : 0);
+	job->nout = vm->nout;
+	job->msec = now_msec() - start;
+}
+
+static void runlanes(void *arg, int worker)
+{
+	struct execjob *jobs = arg;
+	struct execservice *svc = jobs[0].svc;
+	struct lanevm *lv = &svc->lvms[worker];
+	const struct vm *start = jobs[0].prog->prefix;
+	struct vm *vm = &svc->vms[worker];
+	double t0 = now_msec();
+	double deadline = jobs[0].timeout > 0 ? t0 + jobs[0].timeout : 0;
+	int l;
+
+	if (start == NULL)
+	{
+		vminit(vm, jobs[0].prog->code);
+		start = vm;
+	}
+	lanes_start(lv, start);
+	for (l = 0; l < jobs[0].nlanes; l++)
+		lanes_add(lv, jobs[l].in, jobs[l].nin, jobs[l].out, jobs[l].outcap);
+	lanes_run(lv, jobs[0].fuel, deadline);
+	for (l = 0; l < jobs[0].nlanes; l++)
+	{
+		jobs[l].status = lv->status[l];
+		jobs[l].nout = lv->nout[l];
+		if (jobs[l].status == vm_yield)
+		{ /* 各道分开得太散，逐道解释剩下的部分 */
+			vminit(vm, jobs[0].prog->code);
+			lanes_extract(lv, l, vm);
+			jobs[l].status = runvm(vm, jobs[l].fuel, deadline);
+			jobs[l].nout = vm->nout;
+		}
+		jobs[l].msec = now_msec() - t0;
+	}
+}
+
+/*
+ * 提交 n（不超过 lanes）次同一程序的运行作为一个任务，按道同步执行
+ * 各次运行的 fuel、timeout 取 jobs[0] 的
+ */
+void exec_submitlanes(struct execservice *svc, struct execjob *jobs, int n)
+{
+	int l;
+
+	for (l = 0; l < n; l++)
+		jobs[l].svc = svc;
+	jobs[0].nlanes = n;
+	wspool_submit(svc->pool, runlanes, jobs);
+}
+
+/*
+ * 提交一次运行，job 在 exec_wait() 返回前必须保持有效
+ */
+void exec_submit(struct execservice *svc, struct execjob *job)
+{
+	job->svc = svc;
+	wspool_submit(svc->pool, runexec, job);
+}
+
+void exec_wait(struct execservice *svc)
+{
+	wspool_wait(svc->pool);
+}
+
+void exec_destroy(struct execservice *svc)
+{
+	wspool_destroy(svc->pool);
+	free(svc->vms);
+	free(svc->lvms);
+	free(svc);
+}
+
+/* 读入一行中的所有整数 */
+static int parseints(const char *line, int **pv)
+{
+	int n = 0, cap = 0, *v = NULL;
+	char *end;
+
+	for (;;)
+	{
+		long x = strtol(line, &end, 10);
+		if (end == line)
+			break;
+		if (n == cap)
+		{
+			cap = cap ? cap * 2 : 8;
+			v = realloc(v, sizeof(int) * cap);
+		}
+		v[n++] = (int)x;
+		line = end;
+	}
+	*pv = v;
+	return n;
+}
+
+/*
+ * 读入 l25 -R 录制的输入（文件头之后的部分），返回整数个数，格式错误时返回 -1
+ */
+static int readrecording(FILE *f, int **pv)
+{
+	int n = 0, cap = 64, *v = malloc(sizeof(int) * cap);
+	int c;
+
+	while ((c = getc(f)) != EOF)
+	{
+		unsigned int u = 0;
+		int shift = 0;
+
+		for (;;)
+		{ /* LEB128：每字节 7 位，最高位表示后面还有 */
+			u |= (unsigned int)(c & 0x7f) << shift;
+			if ((c & 0x80) == 0)
+				break;
+			shift += 7;
+			if (shift > 28 || (c = getc(f)) == EOF)
+			{
+				free(v);
+				return -1;
+			}
+		}
+		if (n == cap)
+		{
+			cap *= 2;
+			v = realloc(v, sizeof(int) * cap);
+		}
+		v[n++] = (int)((u >> 1) ^ (0U - (u & 1))); /* zigzag 解码 */
+	}
+	*pv = v;
+	return n;
+}
+
+/*
+ * 读入输入文件，每行是一次运行的输入，返回行数，无法打开文件时返回 -1
+ * *pinputs[i] 为第 i 行的整数，个数在 *pninputs[i] 中，都由调用者释放
+ * l25 -R 录制的二进制文件（以 L25I_MAGIC 开头）作为一行，按录制的顺序重放
+ */
+int readinputs(const char *path, int ***pinputs, int **pninputs)
+{
+	int **inputs = NULL, *ninputs = NULL, nlines = 0, cap = 0;
+	char line[65536];
+	unsigned int head[2];
+	FILE *f;
+
+	if ((f = fopen(path, "rb")) == NULL)
+		return -1;
+	if (fread(head, sizeof(unsigned int), 2, f) == 2 && head[0] == L25I_MAGIC)
+	{
+		inputs = malloc(sizeof(int *));
+		ninputs = malloc(sizeof(int));
+		if (head[1] != L25I_VERSION || (ninputs[0] = readrecording(f, &inputs[0])) < 0)
+		{
+			fclose(f);
+			free(inputs);
+			free(ninputs);
+			return -1;
+		}
+		fclose(f);
+		*pinputs = inputs;
+		*pninputs = ninputs;
+		return 1;
+	}
+	rewind(f);
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		if (nlines == cap)
+		{
+			cap = cap ? cap * 2 : 64;
+			inputs = realloc(inputs, sizeof(int *) * cap);
+			ninputs = realloc(ninputs, sizeof(int) * cap);
+		}
+		ninputs[nlines] = parseints(line, &inputs[nlines]);
+		nlines++;
+	}
+	fclose(f);
+	*pinputs = inputs;
+	*pninputs = ninputs;
+	return nlines;
+}
+
+static int cmpdouble(const void *x, const void *y)
+{
+	double a = *(const double *)x, b = *(const double *)y;
+	return (a > b) - (a < b);
+}
+
+int exec_main(int argc, char **argv)
+{
+	int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	int repeat = 1;
+	long long slice = 0, fuel = 0;
+	double timeout = 0;
+	bool quiet = false, prefix = false, vector = false;
+	const char *progpath = NULL, *inpath = NULL;
+	struct program prog;
+	struct execservice *svc;
+	struct execjob *jobs;
+	int **inputs = NULL, *ninputs = NULL, nlines;
+	int njobs, i, j, nfail = 0;
+	double start, wall, *lat;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			nthreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			repeat = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			slice = atoll(argv[++i]);
+		else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+			fuel = atoll(argv[++i]);
+		else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+			timeout = atof(argv[++i]);
+		else if (strcmp(argv[i], "-q") == 0)
+			quiet = true;
+		else if (strcmp(argv[i], "-p") == 0)
+			prefix = true;
+		else if (strcmp(argv[i], "-v") == 0)
+			vector = true;
+		else if (progpath == NULL)
+			progpath = argv[i];
+		else
+			inpath = argv[i];
+	}
+	if (progpath == NULL || inpath == NULL || repeat < 1 || (vector && slice > 0))
+	{
+		printf("usage: l25 -x [-j threads] [-n repeat] [-s slice] [-f fuel] [-w msec] [-p] [-v] [-q] program.l25|program.l25o inputs\n");
+		return 1;
+	}
+	if (loadprogram(&prog, progpath) != 0)
+	{
+		printf("Can't load program %s!\n", progpath);
+		return 1;
+	}
+	if ((nlines = readinputs(inpath, &inputs, &ninputs)) < 0)
+	{
+		printf("Can't open the input file!\n");
+		freeprogram(&prog);
+		return 1;
+	}
+
+	if (prefix)
+	{
+		double t0 = now_msec();
+
+		if (prefix_create(&prog, 64, fuel) == 0)
+			fprintf(stderr, "prefix: %lld instructions, %.4f ms, shared by all runs\n", prog.prefix->steps,
+					now_msec() - t0);
+		else
+			fprintf(stderr, "prefix: the program does not stop at an input, running every job from the start\n");
+	}
+
+	njobs = nlines * repeat;
+	jobs = calloc(njobs > 0 ? njobs : 1, sizeof(struct execjob));
+	for (i = 0; i < njobs; i++)
+	{
+		jobs[i].prog = &prog;
+		jobs[i].in = inputs[i % nlines];
+		jobs[i].nin = ninputs[i % nlines];
+		jobs[i].outcap = 64;
+		jobs[i].out = malloc(sizeof(int) * jobs[i].outcap);
+		jobs[i].fuel = fuel;
+		jobs[i].timeout = timeout;
+	}
+
+	if (slice > 0)
+	{ /* 单线程时间片轮转 */
+		struct vm *vms = malloc(sizeof(struct vm) * (njobs > 0 ? njobs : 1));
+		struct schedjob *sj = calloc(njobs > 0 ? njobs : 1, sizeof(struct schedjob));
+
+		for (i = 0; i < njobs; i++)
+		{
+			startvm(&vms[i], &prog, jobs[i].in, jobs[i].nin, jobs[i].out, jobs[i].outcap);
+			sj[i].vm = &vms[i];
+			sj[i].fuel = fuel;
+			sj[i].timeout = timeout;
+		}
+		nthreads = 1;
+		start = now_msec();
+		schedule(sj, njobs, slice);
+		wall = now_msec() - start;
+		for (i = 0; i < njobs; i++)
+		{
+			jobs[i].status = sj[i].status;
+			jobs[i].nout = vms[i].nout;
+			jobs[i].msec = sj[i].msec;
+			vmrelease(&vms[i]); /* 输入不够或超出限制停止时还没有释放 */
+		}
+		free(sj);
+		free(vms);
+	}
+	else
+	{
+		svc = exec_create(nthreads);
+		nthreads = wspool_size(svc->pool);
+		start = now_msec();
+		if (vector)
+			for (i = 0; i < njobs; i += lanes)
+				exec_submitlanes(svc, &jobs[i], njobs - i < lanes ? njobs - i : lanes);
+		else
+			for (i = 0; i < njobs; i++)
+				exec_submit(svc, &jobs[i]);
+		exec_wait(svc);
+		wall = now_msec() - start;
+		exec_destroy(svc);
+	}
+
+	lat = malloc(sizeof(double) * (njobs > 0 ? njobs : 1));
+	for (i = 0; i < njobs; i++)
+	{
+		struct execjob *job = &jobs[i];
+		int shown = job->nout < job->outcap ? job->nout : job->outcap;
+
+		lat[i] = job->msec;
+		if (job->status != vm_ok)
+			nfail++;
+		if (quiet)
+			continue;
+		for (j = 0; j < shown; j++)
+			printf(j ? " %d" : "%d", job->out[j]);
+		if (job->nout > shown)
+			printf(" ...");
+		if (job->status != vm_ok)
+			printf("%s[%s]", shown ? " " : "", vmstatusname(job->status));
+		printf("\n");
+	}
+	if (njobs > 0)
+	{
+		qsort(lat, njobs, sizeof(double), cmpdouble);
+		fprintf(stderr, "%d runs, %d failed, %d threads\n", njobs, nfail, nthreads);
+		fprintf(stderr, "wall %.3f ms, %.1f runs/sec\n", wall, njobs / (wall / 1e3));
+		fprintf(stderr, "latency ms: p50 %.4f  p99 %.4f  max %.4f\n",
+				lat[njobs / 2], lat[(int)(njobs * 0.99)], lat[njobs - 1]);
+	}
+
+	for (i = 0; i < njobs; i++)
+		free(jobs[i].out);
+	for (i = 0; i < nlines; i++)
+		free(inputs[i]);
+	free(inputs);
+	free(ninputs);
+	free(jobs);
+	free(lat);
+	freeprogram(&prog);
+	return nfail == 0 ? 0 : 1;
+}
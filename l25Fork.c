@@ -0,0 +1,504 @@
+/*
+ * l25Fork.c
+ * 纯函数兄弟调用的 fork-join：fib(n - 1) + fib(n - 2) 这样同一表达式中对纯函数的几次调用并行执行
+ *
+ * 编译器在异常表之后生成分叉表（见 genforktable()），par_create() 把它展开成按指令地址索引的 forksite[]。
+ * interpret() 执行到可以分叉的 cal 时，若调用深度不超过 cutoff，就把实参复制到一个新虚拟机的栈上，
+ * 交给 work-stealing 线程池执行，父任务在结果的位置压入 0 后接着执行本组其余的调用；
+ * 最后一次调用返回时（fork_join()）等待并把结果写回。深度超过 cutoff 的调用照常顺序执行。
+ *
+ * 子任务的栈帧放在与顺序执行时相同的位置，栈溢出的行为不变。子任务是纯函数，执行顺序不影响结果；
+ * 只有出错的顺序需要照顾：子任务出错（未处理的除零、栈溢出）时，父任务回到那次调用的 cal 上顺序重新执行，
+ * 其后分叉的调用一概作废。父任务自己出错、停止之前（fork_flush()）先等待所有子任务，
+ * 有子任务出错就同样回退，因为顺序执行时它的错误先发生。
+ *
+ * 语言中显式的并行也在这里执行：
+ * spawn f(实参) 得到一个句柄（本虚拟机中 spawn_start() 登记的下标加 1），join(句柄) 取回 f 的结果。
+ * 语义是 f 在 join 处被调用，所以 f 不是纯函数、或者没有线程池时，spawn 只保存实参，到 join 时才调用；
+ * f 是纯函数时立即在线程池中开始执行，出错时 join 改为在父任务中顺序调用，出错的位置和 catch 与顺序执行相同。
+ * parfor 循环（par_loop()）把 [lo, hi) 分成若干段，每段在复制了当前栈帧的虚拟机上执行同一段循环代码，
+ * 输出先存在各段中，全部执行完后按段的顺序输出；有一段出错或要读输入时，父任务从这一段的开头起顺序执行。
+ * 各段改写数组元素之前记下原值（array_log()），这一段和之后的段改写的元素先恢复，顺序执行时不会重复改写。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "l25.h"
+
+/* 一次分叉的调用 */
+struct forktask
+{
+	struct vm vm;			 /* 子任务的虚拟机，栈与父任务分开 */
+	struct forktask *next;	 /* 更早分叉的调用 */
+	int pc, b, t, depth;	 /* 分叉时父任务的 cal 地址、基址、栈顶和调用深度 */
+	int join;				 /* 取回结果的地址 */
+	int status;				 /* 子任务的 enum vmstatus */
+	atomic_int done;		 /* 子任务执行完时置 1 */
+	int nargs;
+	int args[];				 /* 实参，回退时写回父任务的栈 */
+};
+
+/* spawn 得到的一个任务 */
+struct spawntask
+{
+	struct vm *vm;		/* 已交给线程池时是任务的虚拟机，否则为 NULL，到 join 时才调用 */
+	int status;			/* 任务的 enum vmstatus */
+	atomic_int done;	/* 任务执行完时置 1 */
+	int entry, nargs;
+	int args[];
+};
+
+/* parfor 的一段迭代 */
+struct looptask
+{
+	struct vm vm;		/* 复制了循环所在栈帧的虚拟机 */
+	long long *rec;		/* 本段的输出，换行记为 outnl */
+	int nrec, caprec;
+	int lo;				/* 本段第一次迭代的循环变量 */
+	int status;
+	atomic_int done;
+};
+#define outnl ((long long)INT_MAX + 1)
+
+/*
+ * 按分叉表建立并行执行的上下文，pool 中的线程与调用 interpret() 的线程一起执行子任务
+ */
+struct parallel *par_create(const struct instruction *code, int cx, struct wspool *pool, int cutoff)
+{
+	struct parallel *par = calloc(1, sizeof(struct parallel));
+	int e = code[1].a, f, g, n, i, join;
+
+	par->pool = pool;
+	par->cutoff = cutoff;
+	par->site = malloc(sizeof(struct forksite) * (cx + 1));
+	for (i = 0; i <= cx; i++)
+	{
+		par->site[i].nargs = -1;
+		par->site[i].join = -1;
+		par->site[i].collect = false;
+		par->site[i].spawn = false;
+	}
+	f = e + 1 + 4 * code[e].a; /* 分叉表紧跟在异常表之后 */
+	for (g = code[f++].a; g > 0; g--)
+	{
+		n = code[f++].a;
+		join = code[f + 2 * (n - 1)].a + 1;
+		par->site[join].collect = true;
+		for (i = 0; i < n - 1; i++, f += 2)
+		{ /* 最后一次调用由父任务自己执行 */
+			par->site[code[f].a].nargs = code[f + 1].a;
+			par->site[code[f].a].join = join;
+		}
+		f += 2;
+	}
+	for (n = code[f++].a; n > 0; n--, f++) /* 纯函数的 spawn */
+		par->site[code[f].a].spawn = true;
+	atomic_init(&par->forks, 0);
+	atomic_init(&par->redone, 0);
+	atomic_init(&par->spawned, 0);
+	atomic_init(&par->chunks, 0);
+	return par;
+}
+
+void par_destroy(struct parallel *par)
+{
+	free(par->site);
+	free(par);
+}
+
+static void forkrun(void *arg, int worker)
+{
+	struct forktask *ft = arg;
+
+	(void)worker;
+	ft->status = vmrun(&ft->vm, -1);
+	spawn_release(&ft->vm);
+	atomic_store_explicit(&ft->done, 1, memory_order_release);
+}
+
+/*
+ * 把地址 pc 处调用 entry 的 cal 交给线程池；b、t、depth 是执行 cal 之前父任务的寄存器，
+ * 实参已经在 s[t + 4] 起的单元中
+ */
+void fork_spawn(struct vm *vm, int entry, int pc, int b, int t, int depth)
+{
+	struct parallel *par = vm->par;
+	int nargs = par->site[pc].nargs;
+	struct forktask *ft = malloc(sizeof(struct forktask) + sizeof(int) * nargs);
+
+	vminit(&ft->vm, vm->code);
+	ft->vm.par = par;
+	memcpy(&ft->vm.s[t + 4], &vm->s[t + 4], sizeof(int) * nargs);
+	memcpy(ft->args, &vm->s[t + 4], sizeof(int) * nargs);
+	/* 与 cal 相同的栈帧，动态链和返回地址为 0：返回时子任务结束，出错时不会找到父任务中的 catch */
+	ft->vm.s[t + 1] = 0;
+	ft->vm.s[t + 2] = 0;
+	ft->vm.s[t + 3] = 0;
+	ft->vm.b = t + 1;
+	ft->vm.t = t;
+	ft->vm.p = entry;
+	ft->vm.depth = ft->vm.maxdepth = depth + 1;
+	ft->pc = pc;
+	ft->b = b;
+	ft->t = t;
+	ft->depth = depth;
+	ft->nargs = nargs;
+	atomic_init(&ft->done, 0);
+	ft->join = par->site[pc].join;
+	ft->next = vm->forks;
+	vm->forks = ft;
+	atomic_fetch_add_explicit(&par->forks, 1, memory_order_relaxed);
+	wspool_submit(par->pool, forkrun, ft);
+}
+
+/*
+ * 结束最近分叉的 n 个调用：等它们执行完，把结果写回父任务的栈
+ * 有子任务出错时，从最早出错的那一个起都作废，父任务的寄存器改为那次 cal 之前的状态，返回 1
+ */
+static int settle(struct vm *vm, int n)
+{
+	struct forktask *ft, *next = vm->forks, *bad = NULL;
+	bool discard;
+	int i;
+
+	for (ft = vm->forks, i = 0; i < n; ft = ft->next, i++)
+	{
+		wspool_join(vm->par->pool, &ft->done);
+		if (ft->status != vm_ok)
+			bad = ft; /* 越往后分叉得越早 */
+	}
+	discard = bad != NULL;
+	for (ft = vm->forks, i = 0; i < n; ft = next, i++)
+	{
+		next = ft->next;
+		if (ft == bad)
+		{ /* 最早出错的调用：回到它的 cal 上顺序执行，之后分叉的都已作废 */
+			memcpy(&vm->s[ft->t + 4], ft->args, sizeof(int) * ft->nargs);
+			vm->p = ft->pc;
+			vm->b = ft->b;
+			vm->t = ft->t;
+			vm->k = 3;
+			vm->depth = ft->depth;
+			discard = false;
+			atomic_fetch_add_explicit(&vm->par->redone, 1, memory_order_relaxed);
+		}
+		else if (!discard)
+		{
+			vm->s[ft->t + 1] = ft->vm.s[ft->t + 1];
+			vm->steps += ft->vm.steps;
+			if (ft->vm.maxt > vm->maxt)
+				vm->maxt = ft->vm.maxt;
+			if (ft->vm.maxdepth > vm->maxdepth)
+				vm->maxdepth = ft->vm.maxdepth;
+		}
+		free(ft);
+	}
+	vm->forks = next;
+	return bad != NULL;
+}
+
+/*
+ * 父任务的 b 帧中地址 p 之前的调用返回后，取回这一组分叉的结果，需要顺序重新执行时返回 1
+ */
+int fork_join(struct vm *vm, int p, int b)
+{
+	struct forktask *ft;
+	int n = 0;
+
+	for (ft = vm->forks; ft && ft->join == p && ft->b == b; ft = ft->next)
+		n++;
+	return n > 0 ? settle(vm, n) : 0;
+}
+
+/*
+ * 父任务出错或停止之前取回所有分叉的结果，需要顺序重新执行时返回 1
+ */
+int fork_flush(struct vm *vm)
+{
+	struct forktask *ft;
+	int n = 0;
+
+	for (ft = vm->forks; ft; ft = ft->next)
+		n++;
+	return settle(vm, n);
+}
+
+static void spawnrun(void *arg, int worker)
+{
+	struct spawntask *st = arg;
+
+	(void)worker;
+	st->status = vmrun(st->vm, -1);
+	spawn_release(st->vm);
+	atomic_store_explicit(&st->done, 1, memory_order_release);
+}
+
+/* 末尾已经 join 的句柄可以再用 */
+static void spawntrim(struct vm *vm)
+{
+	while (vm->nspawned > 0 && vm->spawned[vm->nspawned - 1] == NULL)
+		vm->nspawned--;
+}
+
+/*
+ * spawn：入口为 entry 的函数，实参在栈 s（vm->s 或生成器的栈段）中 s[t + 4] 起的 nargs 个单元中，返回句柄
+ * pc >= 0 时被调函数是纯函数，立即交给线程池，栈帧放在与在这里调用时相同的位置
+ */
+int spawn_start(struct vm *vm, const int *s, int pc, int entry, int nargs, int t, int depth)
+{
+	struct spawntask *st = malloc(sizeof(struct spawntask) + sizeof(int) * nargs);
+
+	st->entry = entry;
+	st->nargs = nargs;
+	memcpy(st->args, &s[t + 4], sizeof(int) * nargs);
+	region_keep(vm, st->args, nargs);
+	st->vm = NULL;
+	if (pc >= 0)
+	{
+		struct vm *cv = st->vm = malloc(sizeof(struct vm));
+
+		vminit(cv, vm->code);
+		cv->par = vm->par;
+		memcpy(&cv->s[t + 4], st->args, sizeof(int) * nargs);
+		cv->s[t + 1] = 0; /* 动态链和返回地址为 0：返回时任务结束 */
+		cv->s[t + 2] = 0;
+		cv->s[t + 3] = 0;
+		cv->b = t + 1;
+		cv->t = t;
+		cv->p = entry;
+		cv->depth = cv->maxdepth = depth + 1;
+		atomic_init(&st->done, 0);
+		atomic_fetch_add_explicit(&vm->par->spawned, 1, memory_order_relaxed);
+		wspool_submit(vm->par->pool, spawnrun, st);
+	}
+
+	spawntrim(vm);
+	if (vm->nspawned == vm->capspawned)
+	{
+		vm->capspawned = vm->capspawned ? 2 * vm->capspawned : 16;
+		vm->spawned = realloc(vm->spawned, sizeof(struct spawntask *) * vm->capspawned);
+	}
+	vm->spawned[vm->nspawned++] = st;
+	return vm->nspawned;
+}
+
+/* 取回已交给线程池的任务的结果，返回任务的 enum vmstatus */
+static int spawnwait(struct vm *vm, struct spawntask *st, int *value)
+{
+	struct vm *cv = st->vm;
+
+	wspool_join(vm->par->pool, &st->done);
+	if (st->status == vm_ok)
+	{
+		*value = cv->s[cv->t]; /* opr 18 把返回值留在栈顶 */
+		vm->steps += cv->steps;
+		if (cv->maxt > vm->maxt)
+			vm->maxt = cv->maxt;
+		if (cv->maxdepth > vm->maxdepth)
+			vm->maxdepth = cv->maxdepth;
+	}
+	free(cv);
+	st->vm = NULL;
+	return st->status;
+}
+
+/*
+ * join：句柄 h 的任务已执行完时把结果放在 *value 中，返回 0；
+ * 任务还没有执行（或出错，要在这里重新调用）时把实参放到栈 s 中 s[t + 4] 起的单元中，返回被调函数的入口；
+ * 句柄无效时返回 -1，栈上放不下实参时返回 -2，句柄仍然有效
+ */
+int spawn_join(struct vm *vm, int *s, int h, int t, int *value)
+{
+	struct spawntask *st;
+	int entry;
+
+	if (h < 1 || h > vm->nspawned || (st = vm->spawned[h - 1]) == NULL)
+		return -1;
+	if (st->vm)
+	{
+		if (spawnwait(vm, st, value) == vm_ok)
+		{
+			free(st);
+			vm->spawned[h - 1] = NULL;
+			spawntrim(vm);
+			return 0;
+		}
+		atomic_fetch_add_explicit(&vm->par->redone, 1, memory_order_relaxed);
+	}
+	if (t + 4 + st->nargs + stackslack >= stacksize)
+		return -2;
+	memcpy(&s[t + 4], st->args, sizeof(int) * st->nargs);
+	entry = st->entry;
+	free(st);
+	vm->spawned[h - 1] = NULL;
+	spawntrim(vm);
+	return entry;
+}
+
+/*
+ * 释放所有没有 join 的任务，已交给线程池的先等它结束
+ */
+void spawn_release(struct vm *vm)
+{
+	int i, value;
+
+	for (i = 0; i < vm->nspawned; i++)
+	{
+		if (vm->spawned[i] && vm->spawned[i]->vm)
+			spawnwait(vm, vm->spawned[i], &value);
+		free(vm->spawned[i]);
+	}
+	free(vm->spawned);
+	vm->spawned = NULL;
+	vm->nspawned = vm->capspawned = 0;
+}
+
+/* parfor 的一段的输出回调：先存起来 */
+static void looprec(struct looptask *lt, long long r)
+{
+	if (lt->nrec == lt->caprec)
+	{
+		lt->caprec = lt->caprec ? 2 * lt->caprec : 64;
+		lt->rec = realloc(lt->rec, sizeof(long long) * lt->caprec);
+	}
+	lt->rec[lt->nrec++] = r;
+}
+
+static void loopwrite(void *user, int value)
+{
+	looprec(user, value);
+}
+
+static void loopnewline(void *user)
+{
+	looprec(user, outnl);
+}
+
+static void looprun(void *arg, int worker)
+{
+	struct looptask *lt = arg;
+
+	(void)worker;
+	lt->status = vmrun(&lt->vm, -1);
+	spawn_release(&lt->vm);
+	if (lt->vm.coros)
+	{ /* 生成器的句柄按建立的先后编号，这一段改为顺序执行才与顺序执行一致 */
+		coro_release(&lt->vm);
+		if (lt->status == vm_ok)
+			lt->status = vm_badnext;
+	}
+	atomic_store_explicit(&lt->done, 1, memory_order_release);
+}
+
+/*
+ * 执行到 b 帧中地址 pc 处的 opr 21：把循环分段交给线程池并等待，t 是语句边界处的栈顶
+ * 全部迭代都执行完时返回循环末尾 opr 22 的地址；迭代少于两次时返回 0，照常顺序执行；
+ * 有一段出错或要读输入时，输出它之前各段的结果，栈帧和数组改为顺序执行到这一段开头时的状态，返回 0
+ */
+int par_loop(struct vm *vm, int pc, int b, int t, int depth)
+{
+	static const int none[1];
+	const struct instruction *code = vm->code;
+	struct parallel *par = vm->par;
+	int iv = code[pc + 1].a, hv = code[pc + 2].a, end = code[pc + 4].a; /* lod i、lod hi、opr 10、jpc */
+	int lo = vm->s[b + iv], hi = vm->s[b + hv];
+	long long n = (long long)hi - lo;
+	int nchunk = 4 * (wspool_size(par->pool) + 1), bad, c, r;
+	struct looptask *lt;
+
+	if (n < 2)
+		return 0;
+	if (nchunk > n)
+		nchunk = (int)n;
+	lt = malloc(sizeof(struct looptask) * nchunk);
+	for (c = 0; c < nchunk; c++)
+	{
+		struct vm *cv = &lt[c].vm;
+
+		vminit(cv, code);
+		memcpy(&cv->s[b], &vm->s[b], sizeof(int) * (t - b + 1));
+		cv->s[b] = 0; /* 动态链和返回地址为 0，包围循环的 try 也不算（见 interpret() 中的除法） */
+		cv->s[b + 1] = 0;
+		lt[c].lo = lo + (int)(n * c / nchunk);
+		cv->s[b + iv] = lt[c].lo;
+		cv->s[b + hv] = lo + (int)(n * (c + 1) / nchunk);
+		cv->p = pc + 1;
+		cv->b = b;
+		cv->t = t;
+		cv->depth = cv->maxdepth = depth;
+		cv->in = none; /* 读输入时停止，这一段改由父任务顺序执行 */
+		cv->nin = 0;
+		cv->output = loopwrite;
+		cv->newline = loopnewline;
+		cv->iouser = &lt[c];
+		cv->par = par;
+		cv->loopb = b;
+		cv->loopend = end;
+		cv->arrays = vm->arrays; /* 各段读写同一批数组，新建数组时这一段改由父任务顺序执行 */
+		cv->narrays = vm->narrays;
+		cv->heap = vm->heap;
+		cv->sharedheap = true;
+		lt[c].rec = NULL;
+		lt[c].nrec = lt[c].caprec = 0;
+		atomic_init(&lt[c].done, 0);
+	}
+	atomic_fetch_add_explicit(&par->chunks, nchunk, memory_order_relaxed);
+	for (c = 0; c < nchunk; c++)
+		wspool_submit(par->pool, looprun, &lt[c]);
+
+	bad = nchunk;
+	for (c = 0; c < nchunk; c++)
+	{
+		wspool_join(par->pool, &lt[c].done);
+		if (lt[c].status != vm_ok && bad == nchunk)
+			bad = c;
+	}
+	for (c = nchunk - 1; c >= bad; c--) /* 出错的段和之后的段改写的数组元素恢复原值，顺序执行时再写 */
+		array_undo(&lt[c].vm);
+	for (c = 0; c < bad; c++)
+	{ /* 按顺序输出 */
+		struct vm *cv = &lt[c].vm;
+		int j;
+
+		for (j = 0; j < lt[c].nrec; j++)
+		{
+			if (lt[c].rec[j] == outnl)
+				vmwriteln(vm);
+			else
+				vmwrite(vm, (int)lt[c].rec[j]);
+		}
+		vm->steps += cv->steps;
+		if (cv->maxt > vm->maxt)
+			vm->maxt = cv->maxt;
+		if (cv->maxdepth > vm->maxdepth)
+			vm->maxdepth = cv->maxdepth;
+	}
+	/* 循环体中声明的变量取最后执行的一次迭代的值，循环变量为下一次迭代的值 */
+	if (bad > 0)
+		memcpy(&vm->s[b + 3], &lt[bad - 1].vm.s[b + 3], sizeof(int) * (t - b - 2));
+	if (bad < nchunk)
+	{
+		vm->s[b + iv] = lt[bad].lo;
+		vm->s[b + hv] = hi;
+		atomic_fetch_add_explicit(&par->redone, 1, memory_order_relaxed);
+		r = 0;
+	}
+	else
+		r = end;
+	for (c = 0; c < nchunk; c++)
+	{ /* 各段存入数组的句柄都要由父任务保留，出错的段已经写入的也一样 */
+		struct vm *cv = &lt[c].vm;
+
+		if (cv->pin > 0)
+			region_pin(vm, cv->pinbase, cv->pin);
+		if (vm->sharedheap && c < bad)
+			array_logmerge(vm, cv);
+		array_release(cv);
+		free(lt[c].rec);
+	}
+	free(lt);
+	return r;
+}
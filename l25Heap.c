@@ -0,0 +1,200 @@
+/*
+ * l25Heap.c
+ * 数组堆：let a[n] 建立的数组的元素连续存放在虚拟机的堆中，按分配的先后紧挨着排列
+ *
+ * 变量中保存的是句柄，即描述符的下标加 1；描述符记录元素在堆中的起始位置和个数。
+ * 下标检查只需比较描述符，栈上任意的值都不会访问到堆之外。
+ * 新建数组只是把堆顶向上移动，元素初始化为 0；堆满时加倍扩大，最多 heapmax 个单元。
+ *
+ * 数组属于新建它的栈帧的区域。主栈上的栈帧第一次新建数组时记下此前的数组个数（region_enter()），
+ * 这个栈帧 opr 18 返回时把数组个数和堆顶退回去（region_leave()），一次释放它和它调用的函数新建的全部数组，
+ * 与调用者的数组紧挨着，所以不需要空闲表。逃逸的数组留给调用者，即并入调用者的区域：
+ * 返回值是区域中数组的句柄时保留到这个数组为止；stx、fill、copy 把句柄存入更早的数组时记下 pin（region_pin()），
+ * 那个数组还在时保留前 pin 个数组。除零跳到 catch 时退出的栈帧不释放，数组并入 try 所在的栈帧（region_unwind()）。
+ * 句柄可能保存在生成器的栈段或 spawn 的任务的实参中：建立生成器、spawn 时实参中的句柄，以及生成器新建的数组
+ * 都记在 keep 中（region_keep()），前 keep 个数组不再释放，其余栈帧的区域照常释放。
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "l25.h"
+
+/*
+ * 新建长度为 len 的数组，返回句柄；长度为负或堆已满时返回 0
+ */
+int array_new(struct vm *vm, int len)
+{
+	if (len < 0 || vm->sharedheap || len > heapmax - vm->heaptop)
+		return 0;
+	if (vm->heaptop + len > vm->heapcap)
+	{
+		int cap = vm->heapcap ? vm->heapcap : 1024;
+
+		while (cap < vm->heaptop + len)
+			cap = cap < heapmax / 2 ? 2 * cap : heapmax;
+		vm->heap = realloc(vm->heap, sizeof(int) * cap);
+		vm->heapcap = cap;
+	}
+	if (vm->narrays == vm->caparrays)
+	{
+		vm->caparrays = vm->caparrays ? 2 * vm->caparrays : 64;
+		vm->arrays = realloc(vm->arrays, sizeof(struct arraydesc) * vm->caparrays);
+	}
+	memset(&vm->heap[vm->heaptop], 0, sizeof(int) * len);
+	vm->arrays[vm->narrays].base = vm->heaptop;
+	vm->arrays[vm->narrays].len = len;
+	vm->heaptop += len;
+	return ++vm->narrays;
+}
+
+/* 句柄 h 的数组，无效时返回 NULL */
+const struct arraydesc *array_get(const struct vm *vm, int h)
+{
+	return h >= 1 && h <= vm->narrays ? &vm->arrays[h - 1] : NULL;
+}
+
+/*
+ * 基址为 b 的栈帧第一次新建数组，返回区域栈顶的基址
+ */
+int region_enter(struct vm *vm, int b)
+{
+	if (vm->nregions == vm->capregions)
+	{
+		vm->capregions = vm->capregions ? 2 * vm->capregions : 64;
+		vm->regions = realloc(vm->regions, sizeof(struct region) * vm->capregions);
+	}
+	vm->regions[vm->nregions].b = b;
+	vm->regions[vm->nregions].mark = vm->narrays;
+	vm->nregions++;
+	return b;
+}
+
+/*
+ * 区域栈顶的栈帧返回，value 是返回值：释放区域中没有逃逸的数组，返回新的区域栈顶的基址，没有时为 -1
+ */
+int region_leave(struct vm *vm, int value)
+{
+	int top = vm->regions[--vm->nregions].mark;
+
+	if (value > top && value <= vm->narrays)
+		top = value; /* 返回的数组和它之前的数组留给调用者 */
+	if (vm->keep > top)
+		top = vm->keep; /* 生成器或任务持有的数组 */
+	if (vm->pin > 0 && vm->pinbase <= top)
+	{ /* 存入句柄的数组还在 */
+		if (vm->pin > top)
+			top = vm->pin;
+	}
+	else
+		vm->pin = 0;
+	vm->narrays = top;
+	vm->heaptop = top > 0 ? vm->arrays[top - 1].base + vm->arrays[top - 1].len : 0;
+	return vm->nregions > 0 ? vm->regions[vm->nregions - 1].b : -1;
+}
+
+/*
+ * 除零跳到基址为 b 的栈帧中的 catch：退出的栈帧的区域并入 b 帧，返回新的区域栈顶的基址
+ */
+int region_unwind(struct vm *vm, int b)
+{
+	while (vm->nregions > 0 && vm->regions[vm->nregions - 1].b > b)
+		vm->nregions--;
+	return vm->nregions > 0 ? vm->regions[vm->nregions - 1].b : -1;
+}
+
+/*
+ * 句柄 value 存入了更早新建的数组 container：container 还在时 value 也要保留
+ */
+void region_pin(struct vm *vm, int container, int value)
+{
+	if (vm->pin == 0 || container < vm->pinbase)
+		vm->pinbase = container;
+	if (value > vm->pin)
+		vm->pin = value;
+}
+
+/*
+ * v[0..n) 交给了生成器或 spawn 的任务：其中的句柄和它之前的数组都不再释放
+ */
+void region_keep(struct vm *vm, const int *v, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (v[i] > vm->keep && v[i] <= vm->narrays)
+			vm->keep = v[i];
+}
+
+/* 改写记录再放得下 n 对 */
+static void logroom(struct vm *vm, int n)
+{
+	int cap = vm->capundo ? vm->capundo : 256;
+
+	if (vm->nundo + 2 * n <= vm->capundo)
+		return;
+	while (cap < vm->nundo + 2 * n)
+		cap *= 2;
+	vm->undo = realloc(vm->undo, sizeof(int) * cap);
+	vm->capundo = cap;
+}
+
+/*
+ * parfor 的分段改写 heap[at..at + n) 之前记下原值；这一段作废时 array_undo() 倒序写回
+ */
+void array_log(struct vm *vm, int at, int n)
+{
+	int i;
+
+	logroom(vm, n);
+	for (i = 0; i < n; i++)
+	{
+		vm->undo[vm->nundo++] = at + i;
+		vm->undo[vm->nundo++] = vm->heap[at + i];
+	}
+}
+
+/* 把记下的元素倒序恢复为改写之前的值 */
+void array_undo(struct vm *vm)
+{
+	while (vm->nundo > 0)
+	{
+		vm->nundo -= 2;
+		vm->heap[vm->undo[vm->nundo]] = vm->undo[vm->nundo + 1];
+	}
+}
+
+/* 嵌套的 parfor 中保留下来的一段 cv 的改写也记到外层的分段 vm 中，外层这一段作废时一起恢复 */
+void array_logmerge(struct vm *vm, const struct vm *cv)
+{
+	if (cv->nundo == 0)
+		return;
+	logroom(vm, cv->nundo / 2);
+	memcpy(&vm->undo[vm->nundo], cv->undo, sizeof(int) * cv->nundo);
+	vm->nundo += cv->nundo;
+}
+
+/*
+ * 释放所有数组；parfor 的分段只是不再使用父任务的数组
+ */
+void array_release(struct vm *vm)
+{
+	if (!vm->sharedheap)
+	{
+		free(vm->arrays);
+		free(vm->heap);
+	}
+	vm->arrays = NULL;
+	vm->heap = NULL;
+	vm->narrays = vm->caparrays = 0;
+	vm->heaptop = vm->heapcap = 0;
+	vm->sharedheap = false;
+	free(vm->undo);
+	vm->undo = NULL;
+	vm->nundo = vm->capundo = 0;
+	free(vm->regions);
+	vm->regions = NULL;
+	vm->nregions = vm->capregions = 0;
+	vm->pin = 0;
+	vm->keep = 0;
+}
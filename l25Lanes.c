@@ -0,0 +1,495 @@
+/*
+ * l25Lanes.c
+ * 按 SIMD 道同步执行：同一程序的 lanes 次运行（各自的输入）共用一个指令流
+ *
+ * 各道的栈按单元交错存放（struct lanevm），寄存器 p、b、t、k 都相同的道组成一组，
+ * 每条指令只取指、分派一次，对整组的栈单元做一次向量运算；组内是全部活着的道时整行写入，不必保留其他道的单元。
+ * 条件跳转、函数返回、异常使组内各道去向不同时拆开分组，在活着的道中选 p 最小的一道，与它状态完全相同的道组成新的一组，
+ * 一直执行到 p 不再小于组外各道的 p 为止，再重新分组：if 的两个分支先后执行到汇合点、先退出循环的道等到其余的道也退出，
+ * 就重新合并。除法、输入输出逐道进行。
+ * 各道长期分开执行（例如递归深度各不相同）时平均每条指令只做一两道的工作，不如逐道解释，
+ * 这时 lanes_run() 提前返回，调用者用 lanes_extract() 取出还没结束的道，交给 interpret() 执行。
+ * 不支持剖析、采样和轨迹，需要时用 interpret() 逐次执行。
+ *
+ * 向量用 GCC 的向量扩展表示；x86-64 上 lanes_run() 同时编译出 AVX2 和默认（SSE2）两个版本，
+ * 装入时按 CPU 选择，其他平台上由编译器决定如何展开。
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+#include "l25.h"
+
+#if defined(__x86_64__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define lanetarget __attribute__((target_clones("avx2", "default")))
+#endif
+#endif
+#ifndef lanetarget
+#define lanetarget
+#endif
+
+#define lanemin 3 /* 平均每条指令执行的道数低于此值时改为逐道解释 */
+
+/* 写一行栈单元：组内是全部活着的道时整行写入，否则只写组内的道 */
+#define put(x, v)                                         \
+	do                                                    \
+	{                                                     \
+		lanevec v_ = (v);                                 \
+		(x) = full ? v_ : (((x) & ~m) | (v_ & m));        \
+	} while (0)
+
+static double now_msec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/*
+ * 所有道从 start 的状态开始（vminit() 之后的虚拟机，或执行过前缀的虚拟机）
+ */
+void lanes_start(struct lanevm *lv, const struct vm *start)
+{
+	int i, l;
+
+	lv->code = start->code;
+	lv->start = start;
+	for (i = 0; i < stacksize; i++)
+		for (l = 0; l < lanes; l++)
+			lv->s[i][l] = start->s[i];
+	lv->n = 0;
+}
+
+/*
+ * 加入一道，返回道号；已满时返回 -1
+ */
+int lanes_add(struct lanevm *lv, const int *in, int nin, int *out, int outcap)
+{
+	const struct vm *st = lv->start;
+	int l = lv->n, n;
+
+	if (l >= lanes)
+		return -1;
+	lv->n++;
+	lv->p[l] = st->p;
+	lv->b[l] = st->b;
+	lv->t[l] = st->t;
+	lv->k[l] = st->k;
+	lv->in[l] = in;
+	lv->nin[l] = nin;
+	lv->inpos[l] = st->inpos;
+	lv->out[l] = out;
+	lv->outcap[l] = outcap;
+	lv->nout[l] = st->nout;
+	lv->steps[l] = st->steps;
+	lv->status[l] = vm_yield;
+	if (st->out)
+	{ /* 前缀的输出 */
+		n = st->nout < st->outcap ? st->nout : st->outcap;
+		memcpy(out, st->out, sizeof(int) * (n < outcap ? n : outcap));
+	}
+	return l;
+}
+
+/*
+ * 把第 l 道的状态放进已由 vminit() 准备好的虚拟机，以便用 interpret() 继续执行
+ */
+void lanes_extract(const struct lanevm *lv, int l, struct vm *vm)
+{
+	int i;
+
+	for (i = 0; i < stacksize; i++)
+		vm->s[i] = lv->s[i][l];
+	vm->p = lv->p[l];
+	vm->b = lv->b[l];
+	vm->t = lv->t[l];
+	vm->k = lv->k[l];
+	vm->in = lv->in[l];
+	vm->nin = lv->nin[l];
+	vm->inpos = lv->inpos[l];
+	vm->out = lv->out[l];
+	vm->outcap = lv->outcap[l];
+	vm->nout = lv->nout[l];
+	vm->steps = lv->steps[l];
+}
+
+/* 把组 grp 中各道的寄存器设为 p、b、t、k，并计入本组执行的指令数 */
+static void setregs(struct lanevm *lv, unsigned grp, int p, int b, int t, int k, long long run)
+{
+	int l;
+
+	for (l = 0; l < lanes; l++)
+	{
+		if (grp & (1u << l))
+		{
+			lv->p[l] = p;
+			lv->b[l] = b;
+			lv->t[l] = t;
+			lv->k[l] = k;
+			lv->steps[l] += run;
+		}
+	}
+}
+
+/* 第 l 道结束，寄存器停在 p 处 */
+static void finish(struct lanevm *lv, int l, int status, int p, int b, int t, long long run)
+{
+	lv->status[l] = status;
+	lv->p[l] = p;
+	lv->b[l] = b;
+	lv->t[l] = t;
+	lv->steps[l] += run;
+}
+
+/*
+ * 执行所有的道，各道的结果在 lv->status[]、nout[]、steps[] 中
+ * fuel > 0 时每道最多执行约 fuel 条指令，deadline > 0 时到这个时刻（now_msec()）还没结束的道都终止
+ * 指令数上限、时间和平均每条指令执行的道数只在调用和向后跳转处每 timeslice 条指令检查一次
+ * 返回还没结束（status 为 vm_yield）、应当逐道解释的道数
+ */
+lanetarget int lanes_run(struct lanevm *lv, long long fuel, double deadline)
+{
+	const struct instruction *code = lv->code;
+	lanevec *s = lv->s;
+	lanevec m = {0};	   /* 组的向量掩码，组内的道为 -1 */
+	unsigned live = 0;	   /* 活着的道 */
+	unsigned grp = 0;	   /* 当前的组，为 0 时重新分组 */
+	bool full = false;	   /* 组内是全部活着的道 */
+	long long run = 0;	   /* 当前的组执行的指令数，离开组时计入各道 */
+	long long total = 0;   /* 全部的组执行的指令数 */
+	long long check = timeslice;
+	long long work = 0;	   /* 上次检查时各道执行的指令数之和 */
+	struct instruction i;
+	int p = 0, b = 0, t = 0, k = 0;
+	int minother = INT_MAX; /* 组外各道最小的 p */
+	int l, lead;
+
+	for (l = 0; l < lv->n; l++)
+		work += lv->steps[l];
+
+	for (l = 0; l < lv->n; l++)
+		if (lv->status[l] == vm_yield)
+			live |= 1u << l;
+	while (live)
+	{
+		if (grp == 0)
+		{ /* 选 p 最小的一道，与它状态相同的道组成一组 */
+			lead = -1;
+			for (l = 0; l < lanes; l++)
+				if ((live & (1u << l)) && (lead < 0 || lv->p[l] < lv->p[lead]))
+					lead = l;
+			p = lv->p[lead];
+			b = lv->b[lead];
+			t = lv->t[lead];
+			k = lv->k[lead];
+			minother = INT_MAX;
+			for (l = 0; l < lanes; l++)
+			{
+				bool same = (live & (1u << l)) && lv->p[l] == p && lv->b[l] == b && lv->t[l] == t && lv->k[l] == k;
+				if (same)
+					grp |= 1u << l;
+				else if ((live & (1u << l)) && lv->p[l] < minother)
+					minother = lv->p[l];
+				m[l] = same ? -1 : 0;
+			}
+			full = grp == live;
+			run = 0;
+		}
+
+		i = code[p];
+		p = p + 1;
+		run++;
+		total++;
+		switch (i.f)
+		{
+		case lit:
+			t = t + 1;
+			put(s[t], (lanevec){0} + i.a);
+			break;
+		case opr:
+			switch (i.a)
+			{
+			case 0: /* 主程序结束 */
+			case 18: /* 函数返回，各道的返回地址和基址可能不同 */
+			{
+				lanevec ra = i.a == 0 ? s[b + 2] : s[b + 1];
+				lanevec dl = i.a == 0 ? s[b + 1] : s[b];
+				unsigned g = grp;
+				bool same = true;
+
+				lead = __builtin_ctz(g); /* 组内的任一道 */
+				t = b - 1;
+				if (i.a == 18)
+				{
+					t = t + 1;
+					put(s[t], s[b + 2]); /* 返回值留在栈顶 */
+				}
+				for (l = 0; l < lanes; l++)
+					if ((g & (1u << l)) && (ra[l] != ra[lead] || dl[l] != dl[lead]))
+						same = false;
+				if (same)
+				{
+					p = ra[lead];
+					b = dl[lead];
+					if (p == 0)
+					{ /* 主程序结束 */
+						for (l = 0; l < lanes; l++)
+							if (g & (1u << l))
+								finish(lv, l, vm_ok, p, b, t, run);
+						live &= ~g;
+						grp = 0;
+					}
+					break;
+				}
+				for (l = 0; l < lanes; l++)
+				{
+					if (g & (1u << l))
+					{
+						if (ra[l] == 0)
+						{
+							finish(lv, l, vm_ok, 0, dl[l], t, run);
+							live &= ~(1u << l);
+						}
+						else
+							setregs(lv, 1u << l, ra[l], dl[l], t, k, run);
+					}
+				}
+				grp = 0;
+				break;
+			}
+			case 1:
+				put(s[t], -s[t]);
+				break;
+			case 2:
+				t = t - 1;
+				put(s[t], s[t] + s[t + 1]);
+				break;
+			case 3:
+				t = t - 1;
+				put(s[t], s[t] - s[t + 1]);
+				break;
+			case 4:
+				t = t - 1;
+				put(s[t], s[t] * s[t + 1]);
+				break;
+			case 5: /* 除法逐道进行，除数为零的道各自找 catch */
+			{
+				unsigned moved = 0;
+
+				for (l = 0; l < lanes; l++)
+				{
+					int h, tb;
+
+					if (!(grp & (1u << l)))
+						continue;
+					if (s[t][l] != 0)
+					{
+						s[t - 1][l] = s[t - 1][l] / s[t][l];
+						continue;
+					}
+					tb = b;
+					if ((h = findhandler(code, (const int *)s + l, lanes, p - 1, &tb)) >= 0)
+						setregs(lv, 1u << l, code[h + 2].a, tb, tb - 1 + iniframe(code[code[h + 3].a].a), 3, run);
+					else
+					{
+						finish(lv, l, vm_divzero, p - 1, b, t, run);
+						live &= ~(1u << l);
+					}
+					moved |= 1u << l;
+				}
+				t = t - 1;
+				if (moved)
+				{ /* 转到 catch 的道离开了组，其余的道保存寄存器后重新分组 */
+					setregs(lv, grp & ~moved, p, b, t, k, run);
+					grp = 0;
+				}
+				break;
+			}
+			case 6:
+				put(s[t], s[t] % 2);
+				break;
+			case 8:
+				t = t - 1;
+				put(s[t], (s[t] == s[t + 1]) & 1);
+				break;
+			case 9:
+				t = t - 1;
+				put(s[t], (s[t] != s[t + 1]) & 1);
+				break;
+			case 10:
+				t = t - 1;
+				put(s[t], (s[t] < s[t + 1]) & 1);
+				break;
+			case 11:
+				t = t - 1;
+				put(s[t], (s[t] >= s[t + 1]) & 1);
+				break;
+			case 12:
+				t = t - 1;
+				put(s[t], (s[t] > s[t + 1]) & 1);
+				break;
+			case 13:
+				t = t - 1;
+				put(s[t], (s[t] <= s[t + 1]) & 1);
+				break;
+			case 14:
+				for (l = 0; l < lanes; l++)
+				{
+					if (grp & (1u << l))
+					{
+						if (lv->nout[l] < lv->outcap[l])
+							lv->out[l][lv->nout[l]] = s[t][l];
+						lv->nout[l]++;
+					}
+				}
+				t = t - 1;
+				break;
+			case 15:
+				break;
+			case 16:
+				for (l = 0; l < lanes; l++)
+				{
+					if (!(grp & (1u << l)))
+						continue;
+					if (lv->inpos[l] < lv->nin[l])
+						s[t + 1][l] = lv->in[l][lv->inpos[l]++];
+					else
+					{ /* 输入已读完，停在本条指令上 */
+						finish(lv, l, vm_noinput, p - 1, b, t, run);
+						live &= ~(1u << l);
+						grp &= ~(1u << l);
+					}
+				}
+				t = t + 1;
+				break;
+			case 17:
+				put(s[t + k], s[t]);
+				k++;
+				t--;
+				break;
+			case 19: /* spawn、join 的任务表、生成器和数组在各自的虚拟机中，改为逐道解释 */
+			case 20:
+			case 23:
+			case 24:
+			case 25:
+			case 26:
+			case 27:
+			case 28:
+			case 29:
+			case 30:
+			case 31:
+				setregs(lv, grp, p - 1, b, t, k, run - 1);
+				return __builtin_popcount(live);
+			case 21: /* parfor 顺序执行 */
+			case 22:
+				break;
+			}
+			break;
+		case lod:
+			t = t + 1;
+			put(s[t], s[b + i.a]);
+			break;
+		case sto:
+			put(s[b + i.a], s[t]);
+			t = t - 1;
+			break;
+		case cal:
+			put(s[t + 1], (lanevec){0} + b);
+			put(s[t + 2], (lanevec){0} + p);
+			put(s[t + 3], (lanevec){0});
+			b = t + 1;
+			p = i.a;
+			k = 3;
+			goto safepoint;
+		case ini:
+			if (t + iniframe(i.a) + stackslack + iniextra(i.a) >= stacksize)
+			{
+				for (l = 0; l < lanes; l++)
+					if (grp & (1u << l))
+						finish(lv, l, vm_overflow, p - 1, b, t, run);
+				live &= ~grp;
+				grp = 0;
+				break;
+			}
+			t = t + iniframe(i.a);
+			break;
+		case jmp:
+			if (i.a < p)
+			{
+				p = i.a;
+				goto safepoint;
+			}
+			p = i.a;
+			break;
+		case ldx:
+		case stx:
+		case ldxu:
+		case stxu:
+			setregs(lv, grp, p - 1, b, t, k, run - 1);
+			return __builtin_popcount(live);
+		case jpc:
+		{
+			unsigned z = 0; /* 条件为假、要跳转的道 */
+
+			for (l = 0; l < lanes; l++)
+				if ((grp & (1u << l)) && s[t][l] == 0)
+					z |= 1u << l;
+			t = t - 1;
+			if (z == grp)
+			{
+				bool back = i.a < p;
+				p = i.a;
+				if (back)
+					goto safepoint;
+			}
+			else if (z != 0)
+			{ /* 各道去向不同，拆开分组 */
+				setregs(lv, z, i.a, b, t, k, run);
+				setregs(lv, grp & ~z, p, b, t, k, run);
+				grp = 0;
+			}
+			break;
+		}
+		}
+		goto next;
+
+	safepoint: /* 调用和向后跳转：每 timeslice 条指令检查一次指令数上限、时间和平均每条指令执行的道数 */
+		if (total >= check)
+		{
+			bool late = deadline > 0 && now_msec() >= deadline;
+			long long sum = 0;
+
+			check = total + timeslice;
+			setregs(lv, grp, p, b, t, k, run);
+			grp = 0;
+			for (l = 0; l < lv->n; l++)
+				sum += lv->steps[l];
+			if (sum - work < (long long)lanemin * timeslice)
+				return __builtin_popcount(live); /* 分开得太散，改为逐道解释 */
+			work = sum;
+			for (l = 0; l < lanes; l++)
+			{
+				if (!(live & (1u << l)))
+					continue;
+				if (late)
+					finish(lv, l, vm_timeout, lv->p[l], lv->b[l], lv->t[l], 0);
+				else if (fuel > 0 && lv->steps[l] >= fuel)
+					finish(lv, l, vm_nofuel, lv->p[l], lv->b[l], lv->t[l], 0);
+				else
+					continue;
+				live &= ~(1u << l);
+			}
+		}
+
+	next:
+		if (grp != 0 && !full && p >= minother)
+		{ /* 分开执行时组外有 p 更小或相同的道，重新分组，状态相同的道合并 */
+			setregs(lv, grp, p, b, t, k, run);
+			grp = 0;
+		}
+	}
+	return 0;
+}
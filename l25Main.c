@@ -0,0 +1,131 @@
+/*
+ * l25Main.c
+ * 命令行入口
+ *
+ * 使用方法：
+ * 运行后输入l25源程序文件名
+ * 回答是否输出虚拟机代码
+ * 回答是否输出符号表
+ * fcode.txt输出虚拟机代码
+ * foutput.txt输出源文件、出错示意（如有错）和各行对应的生成代码首地址（如无错）
+ * fresult.txt输出运行结果
+ * ftable.txt输出符号表
+ *
+ * l25 [-l] [-t] [-d] [-i 输入文件 | -r 输入向量文件] 源程序
+ * 非交互地编译、执行，见 l25Cli.c
+ * l25 -b [-j 线程数] [-o 输出目录] [-t] 文件|目录|@列表文件 ...
+ * 批量编译多个源程序，见 l25Batch.c
+ * l25 -x [-j 线程数] [-n 重复次数] [-s 时间片] [-f 指令数上限] [-w 毫秒] [-q] 程序 输入文件
+ * 程序只装入一次，按输入文件的每一行并发执行，见 l25Exec.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "l25.h"
+
+/* 主程序开始 */
+int main(int argc, char **argv)
+{
+	static struct compiler ctx; /* 上下文较大，不放在栈上 */
+	static struct vm vm;
+	char fname[256];
+
+	if (argc > 1 && strcmp(argv[1], "-b") == 0) /* 批量编译模式 */
+	{
+		return batch_main(argc - 1, argv + 1);
+	}
+	if (argc > 1 && strcmp(argv[1], "-x") == 0) /* 执行服务模式 */
+	{
+		return exec_main(argc - 1, argv + 1);
+	}
+	if (argc > 1) /* 由命令行参数给出全部选项 */
+	{
+		return cli_main(argc, argv);
+	}
+
+	printf("Input l25 file?   ");
+	scanf("%255s", fname); /* 输入文件名 */
+
+	if ((ctx.fin = fopen(fname, "r")) == NULL)
+	{
+		printf("Can't open the input file!\n");
+		exit(1);
+	}
+
+	if (fgetc(ctx.fin) == EOF)
+	{
+		printf("The input file is empty!\n");
+		fclose(ctx.fin);
+		exit(1);
+	}
+	rewind(ctx.fin);
+
+	if ((ctx.foutput = fopen("foutput.txt", "w")) == NULL)
+	{
+		printf("Can't open the output file!\n");
+		exit(1);
+	}
+
+	if ((ctx.ftable = fopen("ftable.txt", "w")) == NULL)
+	{
+		printf("Can't open ftable.txt file!\n");
+		exit(1);
+	}
+
+	printf("List object codes?(Y/N)"); /* 是否输出虚拟机代码 */
+	scanf("%255s", fname);
+	ctx.listswitch = (fname[0] == 'y' || fname[0] == 'Y');
+
+	printf("List symbol table?(Y/N)"); /* 是否输出符号表 */
+	scanf("%255s", fname);
+	ctx.tableswitch = (fname[0] == 'y' || fname[0] == 'Y');
+
+	ctx.echo = true;
+	if (compile(&ctx) < 0) /* 无法继续编译 */
+	{
+		exit(1);
+	}
+
+	if (ctx.err == 0)
+	{
+		printf("\n===Parsing success!===\n");
+		fprintf(ctx.foutput, "\n===Parsing success!===\n");
+
+		if ((ctx.fcode = fopen("fcode.txt", "w")) == NULL)
+		{
+			printf("Can't open fcode.txt file!\n");
+			exit(1);
+		}
+
+		vminit(&vm, ctx.code);
+		vm.stackswitch = true;
+		vm.echo = true;
+		if ((vm.fresult = fopen("fresult.txt", "w")) == NULL)
+		{
+			printf("Can't open fresult.txt file!\n");
+			exit(1);
+		}
+
+		listall(&ctx); /* 输出所有代码 */
+		fclose(ctx.fcode);
+
+		if (interpret(&vm) != vm_ok) /* 调用解释执行程序 */
+		{
+			exit(1);
+		}
+		fclose(vm.fresult);
+	}
+	else
+	{
+		printf("\n%d errors in l25 program!\n", ctx.err);
+		fprintf(ctx.foutput, "\n%d errors in l25 program!\n", ctx.err);
+	}
+
+	fclose(ctx.ftable);
+	fclose(ctx.foutput);
+	fclose(ctx.fin);
+
+	return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * l25Perf.c
+ * 硬件性能计数器：用 Linux 的 perf_event_open 统计本线程的周期数、指令数、分支预测失败数和 L1d 缺失数
+ *
+ * 每个事件单独打开，打不开的事件（内核不支持、虚拟机中没有 PMU、perf_event_paranoid 限制等）
+ * 标记为不可用，其余事件照常计数；一个都打不开时 perf_open() 返回 -1，调用者照常运行。
+ * 只统计用户态；事件被分时复用时按 enabled/running 的时间比例放大。
+ * 非 Linux 平台上所有事件都不可用。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "l25.h"
+
+const char *const perfname[perfevents] = {"cycles", "instructions", "branch-misses", "L1d-misses"};
+
+#ifdef __linux__
+/* 各事件的类型和配置，顺序与 perfname[] 一致 */
+static const struct
+{
+	int type;
+	unsigned long long config;
+} events[perfevents] = {
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	{PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+							 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+static int openevent(int type, unsigned long long config)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1; /* perf_event_paranoid 为 2 时普通用户也能打开 */
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static const char *reason(int err)
+{
+	switch (err)
+	{
+	case ENOENT:
+	case ENODEV:
+	case EOPNOTSUPP:
+		return "no hardware PMU available (virtual machine?)";
+	case EACCES:
+	case EPERM:
+		return "permission denied (see /proc/sys/kernel/perf_event_paranoid)";
+	case ENOSYS:
+		return "perf_event_open not supported by the kernel";
+	}
+	return strerror(err);
+}
+#endif
+
+/*
+ * 打开全部事件，返回可用的事件数；一个都不可用时返回 -1，原因存入 pc->why
+ */
+int perf_open(struct perfctr *pc)
+{
+	int i, n = 0;
+
+	memset(pc, 0, sizeof(*pc));
+	for (i = 0; i < perfevents; i++)
+		pc->fd[i] = -1;
+#ifdef __linux__
+	for (i = 0; i < perfevents; i++)
+	{
+		if ((pc->fd[i] = openevent(events[i].type, events[i].config)) >= 0)
+			n++;
+		else if (pc->why == NULL)
+			pc->why = reason(errno);
+	}
+#else
+	pc->why = "hardware counters are only supported on Linux";
+#endif
+	return n > 0 ? n : -1;
+}
+
+void perf_close(struct perfctr *pc)
+{
+	int i;
+
+	for (i = 0; i < perfevents; i++)
+	{
+		if (pc->fd[i] >= 0)
+			close(pc->fd[i]);
+		pc->fd[i] = -1;
+	}
+}
+
+/* 开始计数：清零并打开所有可用的事件 */
+void perf_start(struct perfctr *pc)
+{
+#ifdef __linux__
+	int i;
+
+	for (i = 0; i < perfevents; i++)
+	{
+		if (pc->fd[i] >= 0)
+		{
+			ioctl(pc->fd[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(pc->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+#else
+	(void)pc;
+#endif
+}
+
+/*
+ * 停止计数，把本次的计数存入 v[]，不可用的事件记为 -1
+ */
+void perf_stop(struct perfctr *pc, long long v[perfevents])
+{
+	int i;
+
+	for (i = 0; i < perfevents; i++)
+	{
+		v[i] = -1;
+#ifdef __linux__
+		if (pc->fd[i] >= 0)
+		{
+			unsigned long long buf[3]; /* 计数、enabled 时间、running 时间 */
+
+			ioctl(pc->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+			if (read(pc->fd[i], buf, sizeof(buf)) == (ssize_t)sizeof(buf))
+			{
+				if (buf[2] > 0 && buf[2] < buf[1]) /* 分时复用 */
+					buf[0] = (unsigned long long)((double)buf[0] * buf[1] / buf[2]);
+				v[i] = (long long)buf[0];
+			}
+		}
+#endif
+	}
+}
+
+/* 把一次的计数加到累计值上 */
+void perf_add(long long sum[perfevents], const long long v[perfevents])
+{
+	int i;
+
+	for (i = 0; i < perfevents; i++)
+		sum[i] = v[i] < 0 ? -1 : (sum[i] < 0 ? 0 : sum[i]) + v[i];
+}
+
+/*
+ * 输出一行计数：标签、各事件的值、IPC，ops > 0 时再给出平均每条虚拟机指令的值
+ */
+void perf_report(FILE *f, const char *label, const long long v[perfevents], long long ops)
+{
+	int i;
+
+	fprintf(f, "%-10s", label);
+	for (i = 0; i < perfevents; i++)
+	{
+		if (v[i] < 0)
+			fprintf(f, " %s n/a", perfname[i]);
+		else
+			fprintf(f, " %s %lld", perfname[i], v[i]);
+	}
+	if (v[0] > 0 && v[1] >= 0)
+		fprintf(f, " IPC %.2f", (double)v[1] / v[0]);
+	fprintf(f, "\n");
+	if (ops > 0)
+	{
+		fprintf(f, "%-10s", "  per op");
+		for (i = 0; i < perfevents; i++)
+			if (v[i] >= 0)
+				fprintf(f, " %s %.3f", perfname[i], (double)v[i] / ops);
+		fprintf(f, " (%lld VM instructions)\n", ops);
+	}
+}
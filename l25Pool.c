@@ -0,0 +1,267 @@
+/*
+ * l25Pool.c
+ * work-stealing 线程池
+ *
+ * 每个工作线程有一个双端队列：本线程从队尾取任务（后进先出，局部性好），
+ * 空闲的线程从其他队列的队头窃取任务（先进先出，窃取到的通常是较大的任务）。
+ * 在工作线程中提交的任务进入本线程的队列，外部线程提交的任务轮流放入各队列。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "l25.h"
+
+struct wstask
+{
+	void (*fn)(void *arg, int worker);
+	void *arg;
+};
+
+/* 双端队列，[head, tail) 为有效任务，下标对 cap 取模 */
+struct wsdeque
+{
+	pthread_mutex_t lock;
+	struct wstask *buf;
+	int cap;
+	long head;
+	long tail;
+};
+
+struct wspool
+{
+	int n;				  /* 工作线程数 */
+	pthread_t *tids;
+	struct wsdeque *q;	  /* 每个工作线程一个队列 */
+	atomic_int pending;	  /* 已提交但尚未执行完的任务数 */
+	atomic_int queued;	  /* 仍在队列中等待领取的任务数 */
+	atomic_uint rr;		  /* 外部提交时轮流选择队列 */
+	pthread_mutex_t lock; /* 保护下面两个条件变量和 stop */
+	pthread_cond_t work;  /* 有新任务 */
+	pthread_cond_t done;  /* pending 变为 0 */
+	bool stop;
+};
+
+static _Thread_local struct wspool *curpool = NULL; /* 本线程所属的线程池 */
+static _Thread_local int curworker = -1;			/* 本线程在池中的编号 */
+
+static void dq_push(struct wsdeque *q, struct wstask t)
+{
+	pthread_mutex_lock(&q->lock);
+	if (q->tail - q->head == q->cap)
+	{ /* 队列满，扩容并按顺序搬移 */
+		int ncap = q->cap ? q->cap * 2 : 64;
+		struct wstask *nbuf = malloc(sizeof(struct wstask) * ncap);
+		long i;
+		for (i = q->head; i < q->tail; i++)
+			nbuf[i - q->head] = q->buf[i % q->cap];
+		free(q->buf);
+		q->buf = nbuf;
+		q->tail -= q->head;
+		q->head = 0;
+		q->cap = ncap;
+	}
+	q->buf[q->tail % q->cap] = t;
+	q->tail++;
+	pthread_mutex_unlock(&q->lock);
+}
+
+/* 本线程从队尾取任务 */
+static bool dq_pop(struct wsdeque *q, struct wstask *t)
+{
+	bool ok = false;
+	pthread_mutex_lock(&q->lock);
+	if (q->tail > q->head)
+	{
+		q->tail--;
+		*t = q->buf[q->tail % q->cap];
+		ok = true;
+	}
+	pthread_mutex_unlock(&q->lock);
+	return ok;
+}
+
+/* 其他线程从队头窃取任务 */
+static bool dq_steal(struct wsdeque *q, struct wstask *t)
+{
+	bool ok = false;
+	if (pthread_mutex_trylock(&q->lock) != 0)
+		return false; /* 队列正忙，换一个队列窃取 */
+	if (q->tail > q->head)
+	{
+		*t = q->buf[q->head % q->cap];
+		q->head++;
+		ok = true;
+	}
+	pthread_mutex_unlock(&q->lock);
+	return ok;
+}
+
+static bool findtask(struct wspool *pool, int self, struct wstask *t)
+{
+	int i, start = self >= 0 ? self : 0;
+
+	if (self >= 0 && dq_pop(&pool->q[self], t))
+		return true;
+	for (i = 1; i <= pool->n; i++)
+	{
+		if (dq_steal(&pool->q[(start + i) % pool->n], t))
+			return true;
+	}
+	return false;
+}
+
+static void runtask(struct wspool *pool, struct wstask *t, int self)
+{
+	atomic_fetch_sub(&pool->queued, 1);
+	t->fn(t->arg, self);
+	if (atomic_fetch_sub(&pool->pending, 1) == 1)
+	{
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_broadcast(&pool->done);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+struct workerarg
+{
+	struct wspool *pool;
+	int self;
+};
+
+static void *wsworker(void *arg)
+{
+	struct workerarg wa = *(struct workerarg *)arg;
+	struct wspool *pool = wa.pool;
+	struct wstask t;
+
+	free(arg);
+	curpool = pool;
+	curworker = wa.self;
+	for (;;)
+	{
+		if (findtask(pool, wa.self, &t))
+		{
+			runtask(pool, &t, wa.self);
+			continue;
+		}
+		pthread_mutex_lock(&pool->lock);
+		while (atomic_load(&pool->queued) == 0 && !pool->stop)
+			pthread_cond_wait(&pool->work, &pool->lock);
+		if (pool->stop && atomic_load(&pool->queued) == 0)
+		{
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+	return NULL;
+}
+
+/*
+ * 建立有 n 个工作线程的线程池
+ */
+struct wspool *wspool_create(int n)
+{
+	struct wspool *pool = calloc(1, sizeof(struct wspool));
+	int i;
+
+	if (n < 1)
+		n = 1;
+	pool->n = n;
+	pool->tids = malloc(sizeof(pthread_t) * n);
+	pool->q = calloc(n, sizeof(struct wsdeque));
+	atomic_init(&pool->pending, 0);
+	atomic_init(&pool->queued, 0);
+	atomic_init(&pool->rr, 0);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	for (i = 0; i < n; i++)
+		pthread_mutex_init(&pool->q[i].lock, NULL);
+	for (i = 0; i < n; i++)
+	{
+		struct workerarg *wa = malloc(sizeof(struct workerarg));
+		wa->pool = pool;
+		wa->self = i;
+		pthread_create(&pool->tids[i], NULL, wsworker, wa);
+	}
+	return pool;
+}
+
+int wspool_size(const struct wspool *pool)
+{
+	return pool->n;
+}
+
+/*
+ * 提交任务 fn(arg, 执行它的工作线程编号)
+ */
+void wspool_submit(struct wspool *pool, void (*fn)(void *arg, int worker), void *arg)
+{
+	struct wstask t = {fn, arg};
+	int qi = (curpool == pool) ? curworker : (int)(atomic_fetch_add(&pool->rr, 1) % pool->n);
+
+	atomic_fetch_add(&pool->pending, 1);
+	dq_push(&pool->q[qi], t);
+	atomic_fetch_add(&pool->queued, 1);
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_signal(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * 等待所有已提交的任务执行完，不能在工作线程中调用
+ */
+void wspool_wait(struct wspool *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	while (atomic_load(&pool->pending) > 0)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * 等待 *done 变为非零，期间执行池中的任务（最先取到的通常就是所等的那个），可以在工作线程中调用
+ */
+void wspool_join(struct wspool *pool, atomic_int *done)
+{
+	int self = curpool == pool ? curworker : -1;
+	struct wstask t;
+
+	while (atomic_load_explicit(done, memory_order_acquire) == 0)
+	{
+		if (findtask(pool, self, &t))
+			runtask(pool, &t, self);
+		else
+			sched_yield();
+	}
+}
+
+void wspool_destroy(struct wspool *pool)
+{
+	int i;
+
+	wspool_wait(pool);
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = true;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+	for (i = 0; i < pool->n; i++)
+		pthread_join(pool->tids[i], NULL);
+	for (i = 0; i < pool->n; i++)
+	{
+		pthread_mutex_destroy(&pool->q[i].lock);
+		free(pool->q[i].buf);
+	}
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work);
+	pthread_cond_destroy(&pool->done);
+	free(pool->q);
+	free(pool->tids);
+	free(pool);
+}
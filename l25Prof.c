@@ -0,0 +1,246 @@
+/*
+ * l25Prof.c
+ * 指令级剖析：每条指令的执行次数、每个函数的调用次数以及包含/不含被调函数的时间
+ *
+ * 虚拟机在 vm->prof 不为 NULL 时每条指令计数一次，在 cal 和返回时调用 prof_enter()/prof_leave()。
+ * 函数用入口地址（table[].adr，主程序为 code[0] 的跳转目标）区分，
+ * 报告时按入口地址划分 code[] 的范围，再用 codeline[] 映射回源程序行。
+ * 时间在 x86 上用 rdtsc 读时间戳计数器（周期），其他平台用 clock_gettime（纳秒）；编译统计也用这个时钟。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "l25.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PROF_UNIT "cycles"
+unsigned long long profclock(void)
+{
+	return __rdtsc();
+}
+#else
+#define PROF_UNIT "ns"
+unsigned long long profclock(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+struct profile *prof_create(int cx)
+{
+	struct profile *prof = calloc(1, sizeof(struct profile));
+
+	prof->cx = cx;
+	prof->count = calloc(cx, sizeof(long long));
+	prof->calls = calloc(cx, sizeof(long long));
+	prof->incl = calloc(cx, sizeof(unsigned long long));
+	prof->excl = calloc(cx, sizeof(unsigned long long));
+	prof->active = calloc(cx, sizeof(int));
+	return prof;
+}
+
+void prof_destroy(struct profile *prof)
+{
+	free(prof->count);
+	free(prof->calls);
+	free(prof->incl);
+	free(prof->excl);
+	free(prof->active);
+	free(prof);
+}
+
+/*
+ * 一次运行开始：丢弃上次运行（可能出错中止）残留的活动记录，进入主程序
+ */
+void prof_start(struct profile *prof, int entry)
+{
+	prof->depth = 0;
+	memset(prof->active, 0, sizeof(int) * prof->cx);
+	prof_enter(prof, entry);
+}
+
+void prof_enter(struct profile *prof, int entry)
+{
+	struct profframe *fr;
+
+	if (prof->depth >= stacksize)
+		return; /* 不会发生：每层调用至少占三个栈单元 */
+	fr = &prof->frames[prof->depth++];
+	if (prof->depth > prof->maxdepth)
+		prof->maxdepth = prof->depth;
+	fr->entry = entry;
+	fr->child = 0;
+	prof->calls[entry]++;
+	prof->active[entry]++;
+	fr->start = profclock();
+}
+
+void prof_leave(struct profile *prof)
+{
+	unsigned long long now = profclock(), incl;
+	struct profframe *fr;
+
+	if (prof->depth == 0)
+		return;
+	fr = &prof->frames[--prof->depth];
+	incl = now - fr->start;
+	prof->excl[fr->entry] += incl - fr->child;
+	if (--prof->active[fr->entry] == 0) /* 递归时只计最外层 */
+		prof->incl[fr->entry] += incl;
+	if (prof->depth > 0)
+		prof->frames[prof->depth - 1].child += incl;
+}
+
+/* 报告中的一个函数 */
+struct proffunc
+{
+	const char *name;
+	int entry; /* 入口地址，也是范围的起点 */
+	int end;   /* 范围的终点（不含） */
+	long long insns;
+};
+
+static int cmpentry(const void *x, const void *y)
+{
+	return ((const struct proffunc *)x)->entry - ((const struct proffunc *)y)->entry;
+}
+
+/* 按 key 降序排列的下标 */
+static const long long *sortkey;
+static int cmpkey(const void *x, const void *y)
+{
+	long long a = sortkey[*(const int *)x], b = sortkey[*(const int *)y];
+	return (a < b) - (a > b);
+}
+
+/* 读源程序的第 n 行（从 1 开始），读不到时返回空串 */
+static const char *srcline(char **lines, int nlines, int n)
+{
+	return (lines && n >= 1 && n <= nlines) ? lines[n - 1] : "";
+}
+
+static int readlines(const char *path, char ***plines)
+{
+	FILE *f;
+	char buf[4096], **lines = NULL;
+	int n = 0, cap = 0;
+
+	*plines = NULL;
+	if (path == NULL || (f = fopen(path, "r")) == NULL)
+		return 0;
+	while (fgets(buf, sizeof(buf), f) != NULL)
+	{
+		buf[strcspn(buf, "\r\n")] = 0;
+		if (n == cap)
+		{
+			cap = cap ? cap * 2 : 64;
+			lines = realloc(lines, sizeof(char *) * cap);
+		}
+		lines[n++] = strdup(buf);
+	}
+	fclose(f);
+	*plines = lines;
+	return n;
+}
+
+/*
+ * 输出剖析报告：函数、热点行和热点指令
+ * srcpath 不为 NULL 时在热点行后面附上源程序文本
+ */
+void prof_report(FILE *f, const struct compiler *ctx, const struct profile *prof, const char *srcpath)
+{
+	struct proffunc *funcs = malloc(sizeof(struct proffunc) * (ctx->tx + 1));
+	long long total = 0, *linecount;
+	int nfunc = 0, maxline = 0, i, j, *order, nlines;
+	unsigned long long totaltime;
+	char **lines;
+
+	/* 各函数的范围：从入口地址到下一个函数的入口地址 */
+	funcs[nfunc].name = "main";
+	funcs[nfunc].entry = ctx->code[0].a;
+	nfunc++;
+	for (i = 1; i <= ctx->tx; i++)
+	{
+		if (ctx->table[i].kind == function)
+		{
+			funcs[nfunc].name = ctx->table[i].name;
+			funcs[nfunc].entry = ctx->table[i].adr;
+			nfunc++;
+		}
+	}
+	qsort(funcs, nfunc, sizeof(struct proffunc), cmpentry);
+	for (i = 0; i < nfunc; i++)
+	{
+		funcs[i].end = i + 1 < nfunc ? funcs[i + 1].entry : ctx->cx;
+		funcs[i].insns = 0;
+		for (j = funcs[i].entry; j < funcs[i].end; j++)
+			funcs[i].insns += prof->count[j];
+	}
+	for (i = 0; i < ctx->cx; i++)
+	{
+		total += prof->count[i];
+		if (ctx->codeline[i] > maxline)
+			maxline = ctx->codeline[i];
+	}
+	totaltime = prof->incl[ctx->code[0].a];
+	if (totaltime == 0)
+		totaltime = 1;
+
+	fprintf(f, "== functions (%lld instructions, %llu %s, peak stack %d, max call depth %d) ==\n",
+			total, prof->incl[ctx->code[0].a], PROF_UNIT, prof->maxt, prof->maxdepth);
+	fprintf(f, "%-10s %10s %14s %7s %16s %7s %16s %7s\n", "function", "calls", "instructions", "%",
+			"inclusive", "%", "exclusive", "%");
+	for (i = 0; i < nfunc; i++)
+	{
+		int e = funcs[i].entry;
+		fprintf(f, "%-10.*s %10lld %14lld %6.2f%% %16llu %6.2f%% %16llu %6.2f%%\n", al, funcs[i].name,
+				prof->calls[e], funcs[i].insns, total ? 100.0 * funcs[i].insns / total : 0.0,
+				prof->incl[e], 100.0 * prof->incl[e] / totaltime,
+				prof->excl[e], 100.0 * prof->excl[e] / totaltime);
+	}
+
+	/* 按行累计 */
+	linecount = calloc(maxline + 1, sizeof(long long));
+	for (i = 0; i < ctx->cx; i++)
+		linecount[ctx->codeline[i]] += prof->count[i];
+	nlines = readlines(srcpath, &lines);
+	order = malloc(sizeof(int) * (maxline + 1 > ctx->cx ? maxline + 1 : ctx->cx));
+	for (i = 0; i <= maxline; i++)
+		order[i] = i;
+	sortkey = linecount;
+	qsort(order, maxline + 1, sizeof(int), cmpkey);
+	fprintf(f, "\n== hot lines ==\n");
+	fprintf(f, "%6s %14s %7s  %s\n", "line", "instructions", "%", "source");
+	for (i = 0; i <= maxline && i < 20 && linecount[order[i]] > 0; i++)
+		fprintf(f, "%6d %14lld %6.2f%%  %s\n", order[i], linecount[order[i]],
+				100.0 * linecount[order[i]] / total, srcline(lines, nlines, order[i]));
+
+	/* 热点指令 */
+	for (i = 0; i < ctx->cx; i++)
+		order[i] = i;
+	sortkey = prof->count;
+	qsort(order, ctx->cx, sizeof(int), cmpkey);
+	fprintf(f, "\n== hot instructions ==\n");
+	fprintf(f, "%6s %-4s %6s %14s %7s %6s\n", "addr", "op", "a", "count", "%", "line");
+	for (i = 0; i < ctx->cx && i < 20 && prof->count[order[i]] > 0; i++)
+	{
+		int a = order[i];
+		fprintf(f, "%6d %-4s %6d %14lld %6.2f%% %6d\n", a, mnemonic[ctx->code[a].f], ctx->code[a].a,
+				prof->count[a], 100.0 * prof->count[a] / total, ctx->codeline[a]);
+	}
+
+	for (i = 0; i < nlines; i++)
+		free(lines[i]);
+	free(lines);
+	free(order);
+	free(linecount);
+	free(funcs);
+}
@@ -0,0 +1,195 @@
+/*
+ * l25Sample.c
+ * 采样剖析：SIGPROF 定时置位标志，虚拟机在下一个安全点（调用和向后跳转）记录 L25 调用栈
+ *
+ * 调用栈沿动态链取得：当前函数由 p 确定，调用者由返回地址 s[b+1] 确定，再令 b = s[b]，
+ * 直到主程序（b == 1）。结果按 folded-stack 格式输出（"main;f;g 次数"），
+ * 可以直接交给 flamegraph.pl 等火焰图工具。
+ * 同一时刻只能有一个采样器在计时。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include "l25.h"
+
+static struct sampler *cursampler = NULL; /* 正在计时的采样器，信号处理函数使用 */
+
+static void onsigprof(int sig)
+{
+	(void)sig;
+	if (cursampler)
+		cursampler->pending = 1;
+}
+
+/*
+ * 建立采样器，函数名取自 ctx 的符号表
+ */
+struct sampler *sampler_create(const struct compiler *ctx)
+{
+	struct sampler *smp = calloc(1, sizeof(struct sampler));
+	int *entry, i, j;
+
+	smp->nfunc = 1;
+	for (i = 1; i <= ctx->tx; i++)
+		if (ctx->table[i].kind == function)
+			smp->nfunc++;
+	smp->names = malloc(sizeof(char *) * smp->nfunc);
+	entry = malloc(sizeof(int) * smp->nfunc);
+	smp->names[0] = strdup("main");
+	entry[0] = ctx->code[0].a;
+	for (i = 1, j = 1; i <= ctx->tx; i++)
+	{
+		if (ctx->table[i].kind == function)
+		{
+			smp->names[j] = strndup(ctx->table[i].name, al);
+			entry[j] = ctx->table[i].adr;
+			j++;
+		}
+	}
+
+	/* 每条指令属于入口地址不大于它的最近的函数 */
+	smp->cx = ctx->cx;
+	smp->funcof = malloc(sizeof(int) * ctx->cx);
+	for (i = 0; i < ctx->cx; i++)
+	{
+		int best = 0, bestentry = -1; /* code[0] 的跳转算作主程序 */
+		for (j = 0; j < smp->nfunc; j++)
+		{
+			if (entry[j] <= i && entry[j] > bestentry)
+			{
+				best = j;
+				bestentry = entry[j];
+			}
+		}
+		smp->funcof[i] = best;
+	}
+	free(entry);
+	return smp;
+}
+
+void sampler_destroy(struct sampler *smp)
+{
+	int i;
+
+	for (i = 0; i < smp->nfunc; i++)
+		free(smp->names[i]);
+	free(smp->names);
+	free(smp->funcof);
+	free(smp->buf);
+	free(smp);
+}
+
+/*
+ * 开始以每秒 hz 次的频率采样（按进程占用的 CPU 时间计时）
+ */
+int sampler_start(struct sampler *smp, int hz)
+{
+	struct sigaction sa;
+	struct itimerval it;
+
+	if (hz < 1)
+		hz = 1;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = onsigprof;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGPROF, &sa, NULL) != 0)
+		return -1;
+	cursampler = smp;
+	memset(&it, 0, sizeof(it));
+	it.it_interval.tv_sec = 0;
+	it.it_interval.tv_usec = hz > 1 ? 1000000 / hz : 999999;
+	it.it_value = it.it_interval;
+	if (setitimer(ITIMER_PROF, &it, NULL) != 0)
+	{
+		cursampler = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+void sampler_stop(struct sampler *smp)
+{
+	struct itimerval it;
+
+	memset(&it, 0, sizeof(it));
+	setitimer(ITIMER_PROF, &it, NULL);
+	if (cursampler == smp)
+		cursampler = NULL;
+	smp->pending = 0;
+}
+
+/*
+ * 在安全点记录一个样本：p 为下一条要执行的指令，b 为当前基址
+ * 样本以 [深度, 最内层函数, ..., main] 追加到 buf 中
+ */
+void sampler_take(struct sampler *smp, int p, int b, const int *s)
+{
+	int n0, depth = 0;
+
+	smp->pending = 0;
+	if (smp->nbuf + stacksize + 1 > smp->capbuf)
+	{
+		smp->capbuf = smp->capbuf ? smp->capbuf * 2 : 4096;
+		while (smp->capbuf < smp->nbuf + stacksize + 1)
+			smp->capbuf *= 2;
+		smp->buf = realloc(smp->buf, sizeof(int) * smp->capbuf);
+	}
+	n0 = smp->nbuf++;
+	for (;;)
+	{
+		smp->buf[smp->nbuf++] = (p >= 0 && p < smp->cx) ? smp->funcof[p] : 0;
+		depth++;
+		if (b <= 1 || depth >= stacksize)
+			break;
+		p = s[b + 1] - 1; /* 调用者中 cal 指令的地址 */
+		b = s[b];
+	}
+	smp->buf[n0] = depth;
+	smp->nsamples++;
+}
+
+/* 一个样本在 buf 中的位置，用于排序合并相同的调用栈 */
+static const int *sortbuf;
+static int cmpsample(const void *x, const void *y)
+{
+	const int *a = sortbuf + *(const int *)x, *b = sortbuf + *(const int *)y;
+	int i;
+
+	if (a[0] != b[0])
+		return a[0] - b[0];
+	for (i = 1; i <= a[0]; i++)
+		if (a[i] != b[i])
+			return a[i] - b[i];
+	return 0;
+}
+
+/*
+ * 按 folded-stack 格式输出：每种调用栈一行，从 main 到最内层用 ';' 连接，后跟样本数
+ */
+void sampler_write(FILE *f, const struct sampler *smp)
+{
+	int *pos = malloc(sizeof(int) * (smp->nsamples > 0 ? smp->nsamples : 1));
+	int i, j, n = 0;
+
+	for (i = 0; i < smp->nbuf; i += smp->buf[i] + 1)
+		pos[n++] = i;
+	sortbuf = smp->buf;
+	qsort(pos, n, sizeof(int), cmpsample);
+	for (i = 0; i < n;)
+	{
+		const int *st = smp->buf + pos[i];
+		int first = i;
+
+		while (i < n && cmpsample(&pos[i], &pos[first]) == 0)
+			i++;
+		for (j = st[0]; j >= 1; j--)
+			fprintf(f, j == st[0] ? "%s" : ";%s", smp->names[st[j]]);
+		fprintf(f, " %d\n", i - first);
+	}
+	free(pos);
+}
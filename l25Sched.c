@@ -0,0 +1,78 @@
+/*
+ * l25Sched.c
+ * 时间片调度：在一个线程上轮流执行多个虚拟机
+ *
+ * 每个虚拟机每次最多执行 slice 条指令（vmrun() 在调用和向后跳转处让出），
+ * 所以一个死循环的程序（例如一直猜不中的 Guess）不会饿死其他程序。
+ * 每个运行可以限定总指令数和墙钟时间，超出时以 vm_nofuel / vm_timeout 结束。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "l25.h"
+
+static double now_msec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/*
+ * 执行一个时间片：最多 slice 条指令，同时不超过总指令数上限 fuel（<= 0 不限）
+ * deadline 为墙钟时间的截止时刻（CLOCK_MONOTONIC 毫秒，<= 0 不限），在时间片结束时检查
+ * 返回 vm_yield 表示可以继续执行，其余为运行结束的状态
+ */
+int vmslice(struct vm *vm, long long slice, long long fuel, double deadline)
+{
+	long long budget = slice;
+	int status;
+
+	if (fuel > 0)
+	{
+		if (vm->steps >= fuel)
+			return vm_nofuel;
+		if (budget < 0 || fuel - vm->steps < budget)
+			budget = fuel - vm->steps;
+	}
+	status = vmrun(vm, budget);
+	if (status != vm_yield)
+		return status;
+	if (fuel > 0 && vm->steps >= fuel)
+		return vm_nofuel;
+	if (deadline > 0 && now_msec() >= deadline)
+		return vm_timeout;
+	return vm_yield;
+}
+
+/*
+ * 轮转调度 jobs 中的所有虚拟机直到全部结束，每轮每个虚拟机执行一个时间片
+ */
+void schedule(struct schedjob *jobs, int njobs, long long slice)
+{
+	int *active = malloc(sizeof(int) * (njobs > 0 ? njobs : 1));
+	int nactive = njobs, i, j;
+	double start = now_msec();
+
+	for (i = 0; i < njobs; i++)
+		active[i] = i;
+	while (nactive > 0)
+	{
+		for (i = j = 0; i < nactive; i++)
+		{
+			struct schedjob *job = &jobs[active[i]];
+			double deadline = job->timeout > 0 ? start + job->timeout : 0;
+
+			job->status = vmslice(job->vm, slice, job->fuel, deadline);
+			if (job->status == vm_yield)
+				active[j++] = active[i]; /* 还没结束，留到下一轮 */
+			else
+				job->msec = now_msec() - start;
+		}
+		nactive = j;
+	}
+	free(active);
+}
@@ -0,0 +1,93 @@
+/*
+ * l25Snap.c
+ * 虚拟机快照：把正在执行的虚拟机的寄存器、s[0..t] 和输入输出的位置写入文件，以后（可以在另一个进程中）从快照继续执行
+ *
+ * 文件格式见 l25.h 中的 struct snapheader。快照只保存到栈顶为止，与程序的大小无关；
+ * 停在函数入口时 opr 17 传入的实参还在 t 之上，保存到被调函数的栈帧末尾。
+ * 快照应在 vmrun() 返回 vm_yield 之后保存，此时虚拟机停在调用入口或循环开头。
+ * 文件头中有代码散列，恢复时确认快照属于同一份代码；同一个快照可以恢复多次，作为多次运行的共同起点。
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "l25.h"
+
+_Static_assert(sizeof(struct snapheader) == 64, "快照文件头应为 64 字节");
+
+/*
+ * 保存快照，先写临时文件再改名，保存中途出错不会破坏已有的快照；返回 0 表示成功
+ */
+int snap_save(const char *path, const struct vm *vm, int cx)
+{
+	struct snapheader hdr;
+	char tmp[4096];
+	FILE *f;
+
+	if (vm->coros || vm->arrays)
+		return -1; /* 生成器的栈段和数组堆不在快照中 */
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp) || (f = fopen(tmp, "wb")) == NULL)
+		return -1;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = L25S_MAGIC;
+	hdr.version = L25S_VERSION;
+	hdr.codehash = codehash(vm->code, cx);
+	hdr.cx = cx;
+	hdr.p = vm->p;
+	hdr.b = vm->b;
+	hdr.t = vm->t;
+	hdr.k = vm->k;
+	hdr.depth = vm->depth;
+	hdr.steps = vm->steps;
+	hdr.inpos = vm->inpos;
+	hdr.nout = vm->nout;
+	hdr.ncells = vm->t + 1;
+	if (vm->code[vm->p].f == ini && vm->b + iniframe(vm->code[vm->p].a) > hdr.ncells)
+		hdr.ncells = vm->b + iniframe(vm->code[vm->p].a);
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 || fwrite(vm->s, sizeof(int), hdr.ncells, f) != (size_t)hdr.ncells)
+	{
+		fclose(f);
+		remove(tmp);
+		return -1;
+	}
+	if (fclose(f) != 0 || rename(tmp, path) != 0)
+	{
+		remove(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 从快照恢复已由 vminit() 准备好的虚拟机，输入输出的设置不变，只恢复位置
+ * 返回 0 表示成功，-1 表示文件打不开或不是快照，-2 表示快照不属于 vm->code
+ */
+int snap_load(const char *path, struct vm *vm, int cx)
+{
+	struct snapheader hdr;
+	FILE *f;
+	int ret = 0;
+
+	if ((f = fopen(path, "rb")) == NULL)
+		return -1;
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != L25S_MAGIC || hdr.version != L25S_VERSION ||
+		hdr.t < 0 || hdr.ncells <= hdr.t || hdr.ncells > stacksize || hdr.b < 1 || hdr.b > hdr.t + 1)
+		ret = -1;
+	else if (hdr.cx != cx || hdr.p < 0 || hdr.p >= cx || hdr.codehash != codehash(vm->code, cx))
+		ret = -2;
+	else if (fread(vm->s, sizeof(int), hdr.ncells, f) != (size_t)hdr.ncells)
+		ret = -1;
+	fclose(f);
+	if (ret != 0)
+		return ret;
+	vm->p = hdr.p;
+	vm->b = hdr.b;
+	vm->t = hdr.t;
+	vm->k = hdr.k;
+	vm->depth = vm->maxdepth = hdr.depth;
+	vm->maxt = hdr.t;
+	vm->steps = hdr.steps;
+	vm->inpos = hdr.inpos;
+	vm->nout = hdr.nout;
+	return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * l25Stats.c
+ * 作业统计：各阶段的墙钟时间和 CPU 时间、编译与执行的计数器、内存高水位，写成 JSON 文件
+ *
+ * 阶段用 phase_begin()/phase_end() 括起来，同一阶段多次进入时累计。
+ * 编译时令 ctx->stats = &js->comp，编译后调用 stats_compiled()，每次执行后调用 stats_ran()。
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "l25.h"
+
+static double clockmsec(clockid_t id)
+{
+	struct timespec ts;
+	clock_gettime(id, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static long maxrsskb()
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_SELF, &ru) != 0)
+		return 0;
+	return ru.ru_maxrss;
+}
+
+void phase_begin(struct phasetime *pt)
+{
+	pt->wall -= clockmsec(CLOCK_MONOTONIC);
+	pt->cpu -= clockmsec(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+void phase_end(struct phasetime *pt)
+{
+	pt->wall += clockmsec(CLOCK_MONOTONIC);
+	pt->cpu += clockmsec(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+/* 按比例 share 从 whole 中分出一部分 */
+static void portion(struct phasetime *part, const struct phasetime *whole, double share)
+{
+	part->wall = whole->wall * share;
+	part->cpu = whole->cpu * share;
+}
+
+/*
+ * 编译结束后记录结果，并按各部分的时钟把编译的耗时分摊到词法分析、语法分析和代码生成
+ * 语法分析的份额是除去 getsym() 和 gen() 以外的全部（包括 position()）
+ */
+void stats_compiled(struct jobstats *js, const struct compiler *ctx, int err)
+{
+	double total = js->comp.clock ? (double)js->comp.clock : 1;
+	double lexshare = js->comp.lexclock / total, genshare = js->comp.genclock / total;
+
+	if (lexshare + genshare > 1)
+		lexshare = genshare = 0.5; /* 不会发生 */
+	portion(&js->lex, &js->compile, lexshare);
+	portion(&js->codegen, &js->compile, genshare);
+	portion(&js->parse, &js->compile, 1 - lexshare - genshare);
+	js->errors = err;
+	js->instructions = ctx->cx;
+	js->symbols = ctx->tx;
+	js->compilerss = maxrsskb();
+}
+
+/*
+ * 一次执行结束后累计执行的指令数，更新虚拟机的高水位
+ * vm->steps 是逐条分派的指令数（与 -p 剖析的总数相同），-J 时包括分叉和 parfor 分段中执行的指令
+ */
+void stats_ran(struct jobstats *js, const struct vm *vm, int status)
+{
+	js->runs++;
+	js->status = status;
+	js->steps += vm->steps;
+	if (vm->maxt > js->maxt)
+		js->maxt = vm->maxt;
+	if (vm->maxdepth > js->maxdepth)
+		js->maxdepth = vm->maxdepth;
+}
+
+static void writephase(FILE *f, const char *name, const struct phasetime *pt, const char *sep)
+{
+	fprintf(f, "    \"%s\": {\"wall_ms\": %.6f, \"cpu_ms\": %.6f}%s\n", name, pt->wall, pt->cpu, sep);
+}
+
+/*
+ * 把统计写成 JSON，返回 0 表示成功
+ */
+int stats_write(const char *path, const struct jobstats *js)
+{
+	FILE *f = fopen(path, "w");
+
+	if (f == NULL)
+		return -1;
+	fprintf(f, "{\n  \"phases\": {\n");
+	writephase(f, "compile", &js->compile, ",");
+	writephase(f, "lex", &js->lex, ",");
+	writephase(f, "parse", &js->parse, ",");
+	writephase(f, "codegen", &js->codegen, ",");
+	writephase(f, "list", &js->list, ",");
+	writephase(f, "exec", &js->exec, "");
+	fprintf(f, "  },\n  \"compile\": {\"errors\": %d, \"tokens\": %lld, \"symbols_entered\": %lld, "
+			   "\"symbols\": %d, \"instructions\": %d, \"lookups\": %lld, \"lookup_probes\": %lld},\n",
+			js->errors, js->comp.tokens, js->comp.symbols, js->symbols, js->instructions, js->comp.lookups,
+			js->comp.probes);
+	fprintf(f, "  \"exec\": {\"runs\": %d, \"status\": \"%s\", \"instructions\": %lld, \"max_t\": %d, "
+			   "\"max_call_depth\": %d},\n",
+			js->runs, js->runs ? vmstatusname(js->status) : "not run", js->steps, js->maxt, js->maxdepth);
+	fprintf(f, "  \"memory\": {\"compiler_bytes\": %zu, \"vm_bytes\": %zu, \"compile_maxrss_kb\": %ld, "
+			   "\"maxrss_kb\": %ld}\n}\n",
+			sizeof(struct compiler), sizeof(struct vm), js->compilerss, maxrsskb());
+	return fclose(f) == 0 ? 0 : -1;
+}
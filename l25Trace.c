@@ -0,0 +1,81 @@
+/*
+ * l25Trace.c
+ * 二进制执行轨迹：虚拟机每执行一条指令向映射到内存的环形缓冲区写一条定长记录
+ *
+ * 文件格式见 l25.h 中的 struct traceheader。记录直接写入共享映射，由内核写回文件，
+ * 运行中不做格式化和系统调用；文件头中的总记录数在每次 vmrun() 结束时更新。
+ * 记录用 l25dump 对照源程序解码。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "l25.h"
+
+_Static_assert(sizeof(struct traceheader) == 64, "轨迹文件头应为 64 字节");
+
+/*
+ * 建立轨迹文件，保留最后 capacity 条记录（向上取为 2 的幂），失败时返回 NULL
+ */
+struct tracer *trace_create(const char *path, long long capacity, const struct instruction *code, int cx)
+{
+	struct tracer *tr;
+	unsigned long long cap = 1;
+	size_t size;
+	void *map;
+	int fd;
+
+	while (cap < (unsigned long long)capacity)
+		cap *= 2;
+	size = sizeof(struct traceheader) + cap * sizeof(struct tracerec);
+	if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+		return NULL;
+	if (ftruncate(fd, (off_t)size) != 0)
+	{
+		close(fd);
+		return NULL;
+	}
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	tr = calloc(1, sizeof(struct tracer));
+	tr->hdr = map;
+	tr->ring = (struct tracerec *)(tr->hdr + 1);
+	tr->mask = cap - 1;
+	tr->size = size;
+	tr->fd = fd;
+	tr->hdr->magic = L25T_MAGIC;
+	tr->hdr->version = L25T_VERSION;
+	tr->hdr->capacity = cap;
+	tr->hdr->count = 0;
+	tr->hdr->codehash = codehash(code, cx);
+	tr->hdr->cx = cx;
+	tr->hdr->recsize = sizeof(struct tracerec);
+	return tr;
+}
+
+/*
+ * 写回总记录数并解除映射；没有写满的文件截去多余的部分
+ */
+void trace_close(struct tracer *tr)
+{
+	unsigned long long used = tr->n < tr->mask + 1 ? tr->n : tr->mask + 1;
+	int shrink = used < tr->hdr->capacity;
+
+	tr->hdr->count = tr->n;
+	if (shrink)
+		tr->hdr->capacity = used; /* 没有回绕，第 k 条记录仍在 k 处 */
+	munmap(tr->hdr, tr->size);
+	if (shrink && ftruncate(tr->fd, (off_t)(sizeof(struct traceheader) + used * sizeof(struct tracerec))) != 0)
+		perror("ftruncate");
+	close(tr->fd);
+	free(tr);
+}
@@ -0,0 +1,78 @@
+/*
+ * l25api.h
+ * 嵌入用的库接口：从内存中的源程序编译，用调用者提供的回调做输入输出
+ *
+ * 不创建任何文件，不读写标准输入输出，出错时返回错误码而不调用 exit()。
+ * 编译得到的程序只读，可以在多个线程中同时执行。
+ */
+
+#ifndef L25API_H
+#define L25API_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 返回码，l25_run() 的返回值与虚拟机的 enum vmstatus 一致 */
+#define L25_OK 0		 /* 成功 */
+#define L25_EDIVZERO 1	 /* 除零且没有 catch 可以处理 */
+#define L25_ENOINPUT 2	 /* 输入回调没有提供更多输入 */
+#define L25_EOVERFLOW 3	 /* 数据栈溢出 */
+#define L25_ENOFUEL 5	 /* 超出指令数上限 */
+#define L25_EBADJOIN 7	 /* join 的句柄无效或已经 join 过 */
+#define L25_EBADNEXT 8	 /* next 的句柄无效，或生成器正在执行 */
+#define L25_EBOUNDS 9	 /* 数组下标越界，或不是数组 */
+#define L25_EHEAP 10	 /* 数组长度为负，或数组堆已满 */
+#define L25_ECOMPILE -1	 /* 源程序有错 */
+#define L25_ENOMEM -2	 /* 内存不足 */
+#define L25_EINVAL -3	 /* 参数不正确 */
+
+struct l25_program; /* 编译得到的程序 */
+
+/* 编译错误信息 */
+struct l25_diag
+{
+	int count;		   /* 错误个数，无法继续编译时为 -1 */
+	int line;		   /* 第一个错误所在的行，从 1 开始 */
+	int column;		   /* 第一个错误所在的列，从 1 开始 */
+	int code;		   /* 第一个错误的编码 */
+	char message[128]; /* 可读的错误描述 */
+};
+
+/* 输入输出回调，均可为 NULL */
+struct l25_io
+{
+	int (*input)(void *user, int *value);  /* 读一个整数，返回 0 表示读到，否则运行以 L25_ENOINPUT 结束 */
+	void (*output)(void *user, int value); /* 输出一个整数 */
+	void (*newline)(void *user);		   /* 一条 output 语句结束 */
+	void *user;							   /* 传给各回调的参数 */
+};
+
+/*
+ * 编译 src 开始的 len 个字符，成功时 *prog 指向新的程序并返回 L25_OK
+ * 失败时返回 L25_ECOMPILE 等错误码，diag 不为 NULL 时填写错误信息
+ */
+int l25_compile(const char *src, size_t len, struct l25_program **prog, struct l25_diag *diag);
+
+/*
+ * 执行程序一次，io 可以为 NULL（没有输入，丢弃输出）
+ * fuel > 0 时最多执行约 fuel 条指令，超出返回 L25_ENOFUEL
+ * 虚拟机放在调用者的栈上；数组、生成器和 spawn 的任务在执行中分配，返回之前全部释放
+ */
+int l25_run(const struct l25_program *prog, const struct l25_io *io, long long fuel);
+
+/* 程序的指令条数 */
+int l25_size(const struct l25_program *prog);
+
+void l25_free(struct l25_program *prog);
+
+/* 返回码的可读描述 */
+const char *l25_strerror(int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* L25API_H */
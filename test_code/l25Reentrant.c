@@ -0,0 +1,182 @@
+/*
+ * l25Reentrant.c
+ * 可重入测试：两个线程同时编译、执行不同的程序，清单和输出必须与顺序执行时相同
+ *
+ * 使用方法：
+ * l25reentrant 目录
+ * 目录下各子目录中的每个 .l25 程序先顺序编译一次，记下源程序清单、虚拟机代码清单和执行结果（输入为 5 7 3，
+ * 最多执行 budget 条指令）；再由两个线程各自从两端交替编译、执行全部程序若干遍，每次都与顺序执行的结果比较。
+ * 全部相同时返回 0，否则输出不同的程序并返回 1。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+
+#include "l25.h"
+
+#define maxprog 256
+#define rounds 20
+#define budget 10000000
+
+/* 一个程序顺序执行的结果 */
+struct result
+{
+	char *listing; /* 源程序清单和错误（foutput） */
+	char *code;	   /* 虚拟机代码清单（fcode） */
+	int err;
+	int status;
+	int nout;
+	int out[256];
+};
+
+static char *paths[maxprog];
+static struct result expect[maxprog];
+static int nprog;
+
+/* 编译并执行一个程序，结果放在 r 中 */
+static int runone(const char *path, struct result *r)
+{
+	static const int in[] = {5, 7, 3};
+	struct compiler *ctx = calloc(1, sizeof(struct compiler)); /* 上下文较大，不放在栈上 */
+	struct vm *vm = malloc(sizeof(struct vm));
+	size_t n1, n2;
+
+	memset(r, 0, sizeof(*r));
+	if ((ctx->fin = fopen(path, "r")) == NULL)
+	{
+		free(ctx);
+		free(vm);
+		return -1;
+	}
+	ctx->foutput = open_memstream(&r->listing, &n1);
+	ctx->fcode = open_memstream(&r->code, &n2);
+	ctx->listswitch = true;
+	r->err = compile(ctx);
+	if (r->err == 0)
+		listall(ctx);
+	fclose(ctx->fin);
+	fclose(ctx->foutput);
+	fclose(ctx->fcode);
+	r->status = -1;
+	if (r->err == 0)
+	{
+		vminit(vm, ctx->code);
+		vm->in = in;
+		vm->nin = sizeof(in) / sizeof(in[0]);
+		vm->out = r->out;
+		vm->outcap = sizeof(r->out) / sizeof(r->out[0]);
+		r->status = vmrun(vm, budget);
+		vmrelease(vm);
+		r->nout = vm->nout < vm->outcap ? vm->nout : vm->outcap;
+	}
+	free(vm);
+	free(ctx);
+	return 0;
+}
+
+static bool same(const struct result *a, const struct result *b)
+{
+	return a->err == b->err && a->status == b->status && a->nout == b->nout &&
+		   strcmp(a->listing, b->listing) == 0 && strcmp(a->code, b->code) == 0 &&
+		   memcmp(a->out, b->out, sizeof(int) * a->nout) == 0;
+}
+
+/* 线程：reverse 为真时从最后一个程序开始，两个线程大多同时编译不同的程序 */
+static void *worker(void *arg)
+{
+	bool reverse = *(bool *)arg;
+	long bad = 0;
+	int round, i;
+
+	for (round = 0; round < rounds; round++)
+	{
+		for (i = 0; i < nprog; i++)
+		{
+			int j = reverse ? nprog - 1 - i : i;
+			struct result r;
+
+			if (runone(paths[j], &r) != 0 || !same(&r, &expect[j]))
+			{
+				fprintf(stderr, "%s differs from the sequential compile\n", paths[j]);
+				bad++;
+			}
+			free(r.listing);
+			free(r.code);
+		}
+	}
+	return (void *)bad;
+}
+
+static int cmppath(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* 收集 dir 下各子目录中的 .l25 程序 */
+static void collect(const char *dir)
+{
+	DIR *d = opendir(dir), *sd;
+	struct dirent *e, *f;
+	char sub[4096];
+
+	if (d == NULL)
+		return;
+	while ((e = readdir(d)) != NULL)
+	{
+		if (e->d_name[0] == '.')
+			continue;
+		snprintf(sub, sizeof(sub), "%s/%s", dir, e->d_name);
+		if ((sd = opendir(sub)) == NULL)
+			continue;
+		while ((f = readdir(sd)) != NULL && nprog < maxprog)
+		{
+			size_t n = strlen(f->d_name);
+
+			if (n > 4 && strcmp(f->d_name + n - 4, ".l25") == 0)
+			{
+				paths[nprog] = malloc(strlen(sub) + n + 2);
+				sprintf(paths[nprog++], "%s/%s", sub, f->d_name);
+			}
+		}
+		closedir(sd);
+	}
+	closedir(d);
+	qsort(paths, nprog, sizeof(char *), cmppath);
+}
+
+int main(int argc, char **argv)
+{
+	static bool dir[2] = {false, true};
+	pthread_t th[2];
+	void *bad[2];
+	int i;
+
+	if (argc != 2)
+	{
+		fprintf(stderr, "usage: l25reentrant directory\n");
+		return 1;
+	}
+	collect(argv[1]);
+	if (nprog < 2)
+	{
+		fprintf(stderr, "need at least two programs under %s\n", argv[1]);
+		return 1;
+	}
+	for (i = 0; i < nprog; i++)
+	{
+		if (runone(paths[i], &expect[i]) != 0)
+		{
+			fprintf(stderr, "Can't open %s!\n", paths[i]);
+			return 1;
+		}
+	}
+	for (i = 0; i < 2; i++)
+		pthread_create(&th[i], NULL, worker, &dir[i]);
+	for (i = 0; i < 2; i++)
+		pthread_join(th[i], &bad[i]);
+	printf("%d programs, %d rounds on 2 threads: %ld differ\n", nprog, rounds, (long)bad[0] + (long)bad[1]);
+	return bad[0] || bad[1] ? 1 : 0;
+}